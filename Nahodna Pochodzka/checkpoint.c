@@ -0,0 +1,220 @@
+// checkpoint.c - priebežné ukladanie stavu počas sim_run a obnova po páde
+#include "checkpoint.h"
+#include "state.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECKPOINT_ARRAYS 4
+
+struct Checkpoint {
+    Sim snap;                       // skalárne polia + vlastné sumy; obstacle a rank sa zdieľajú so Sim (počas behu sa nemenia)
+    uint64_t *arrays[CHECKPOINT_ARRAYS];
+    double *m2;
+    char path[PATH_MAX];
+    int everyReps, everySecs;
+    int lastRep;
+    double lastTime;
+    int slot;                       // do ktorého z dvoch súborov ide ďalší zápis
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool busy;                      // snímka čaká na zápis alebo sa zapisuje
+    bool quit;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void slot_path(char *out, size_t len, const char *path, int slot) {
+    snprintf(out, len, "%s.ckpt%d", path, slot);
+}
+
+// DWALK2 má kontrolný súčet, takže nedopísaný súbor sa pri obnove odmietne;
+// druhý slot ostáva celý. fsync, aby checkpoint prežil aj pád celého stroja.
+static void write_slot(Checkpoint *c) {
+    char file[PATH_MAX + 8];
+    slot_path(file, sizeof(file), c->path, c->slot);
+    if (!state_save_dwalk2(&c->snap, file)) {
+        fprintf(stderr, "checkpoint: zapis %s zlyhal\n", file);
+        return;
+    }
+    int fd = open(file, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static void *writer_main(void *arg) {
+    Checkpoint *c = (Checkpoint*)arg;
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (!c->busy && !c->quit) pthread_cond_wait(&c->cond, &c->lock);
+        if (!c->busy) break;
+        pthread_mutex_unlock(&c->lock);
+        write_slot(c);
+        pthread_mutex_lock(&c->lock);
+        c->slot ^= 1;
+        c->busy = false;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+Checkpoint *checkpoint_start(const Sim *s) {
+    if (!s->ResultFilePath[0] || (s->CheckpointReps <= 0 && s->CheckpointSecs <= 0)) return NULL;
+    size_t n = s->FreeCells ? s->FreeCells : 1;
+
+    Checkpoint *c = (Checkpoint*)calloc(1, sizeof(Checkpoint));
+    if (!c) return NULL;
+    c->snap = *s;
+    c->snap.moves = NULL;
+    c->snap.exact_avg = NULL;
+    c->snap.exact_prob = NULL;
+    bool ok = true;
+    // samples a censored až v checkpoint_due, kým ich Sim nemá, snímka má implicitné hodnoty
+    for (int a = 0; a < 2; a++) {
+        c->arrays[a] = (uint64_t*)malloc(n * sizeof(uint64_t));
+        if (!c->arrays[a]) ok = false;
+    }
+    if (s->VarValid) {
+        c->m2 = (double*)malloc(n * sizeof(double));
+        if (!c->m2) ok = false;
+    }
+    c->snap.steps_sum = c->arrays[0];
+    c->snap.hits_sum = c->arrays[1];
+    c->snap.samples = c->arrays[2];
+    c->snap.censored = c->arrays[3];
+    c->snap.m2 = c->m2;
+    snprintf(c->path, sizeof(c->path), "%s", s->ResultFilePath);
+    c->everyReps = s->CheckpointReps;
+    c->everySecs = s->CheckpointSecs;
+    c->lastRep = s->ActRep;
+    c->lastTime = now_sec();
+
+    // začne sa slotom so starším checkpointom, novší ostáva ako záloha
+    char file[PATH_MAX + 8];
+    Sim h0, h1;
+    slot_path(file, sizeof(file), c->path, 0);
+    bool have0 = state_peek_dwalk2(file, &h0);
+    slot_path(file, sizeof(file), c->path, 1);
+    bool have1 = state_peek_dwalk2(file, &h1);
+    c->slot = (have0 && (!have1 || h0.ActRep > h1.ActRep)) ? 1 : 0;
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    if (ok && pthread_create(&c->thread, NULL, writer_main, c) != 0) ok = false;
+    if (!ok) {
+        pthread_mutex_destroy(&c->lock);
+        pthread_cond_destroy(&c->cond);
+        for (int a = 0; a < CHECKPOINT_ARRAYS; a++) free(c->arrays[a]);
+        free(c->m2);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+bool checkpoint_due(Checkpoint *c, const Sim *s) {
+    pthread_mutex_lock(&c->lock);
+    bool busy = c->busy;
+    pthread_mutex_unlock(&c->lock);
+    if (busy) return false;
+    bool due = (c->everyReps > 0 && s->ActRep - c->lastRep >= c->everyReps) ||
+               (c->everySecs > 0 && now_sec() - c->lastTime >= (double)c->everySecs);
+    if (!due) return false;
+    // zapisovač stojí, snímku možno meniť
+    size_t n = s->FreeCells ? s->FreeCells : 1;
+    if (s->samples && !c->arrays[2]) c->arrays[2] = (uint64_t*)malloc(n * sizeof(uint64_t));
+    if (s->censored && !c->arrays[3]) c->arrays[3] = (uint64_t*)malloc(n * sizeof(uint64_t));
+    c->snap.samples = c->arrays[2];
+    c->snap.censored = c->arrays[3];
+    // bez pamäte sa checkpoint preskočí (implicitné hodnoty by tu neplatili)
+    return (!s->samples || c->arrays[2]) && (!s->censored || c->arrays[3]);
+}
+
+uint64_t **checkpoint_arrays(Checkpoint *c) {
+    return c->arrays;
+}
+
+double *checkpoint_m2(Checkpoint *c) {
+    return c->m2;
+}
+
+void checkpoint_submit(Checkpoint *c, const Sim *s) {
+    pthread_mutex_lock(&c->lock);
+    c->snap.ActRep = s->ActRep;
+    c->snap.MaxReps = s->MaxReps;
+    c->lastRep = s->ActRep;
+    c->lastTime = now_sec();
+    c->busy = true;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void checkpoint_stop(Checkpoint *c) {
+    if (!c) return;
+    pthread_mutex_lock(&c->lock);
+    c->quit = true;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->cond);
+    for (int a = 0; a < CHECKPOINT_ARRAYS; a++) free(c->arrays[a]);
+    free(c->m2);
+    free(c);
+}
+
+void checkpoint_discard(const char *path) {
+    char file[PATH_MAX + 8];
+    for (int slot = 0; slot < 2; slot++) {
+        slot_path(file, sizeof(file), path, slot);
+        unlink(file);
+    }
+}
+
+bool checkpoint_recover(Sim *s, const char *path, char *recovered, size_t recoveredLen) {
+    if (recovered && recoveredLen) recovered[0] = '\0';
+    bool haveMain = sim_load_state(s, path);
+
+    // kandidáti podľa ActRep z hlavičky, novší prvý
+    char file[2][PATH_MAX + 8];
+    Sim h[2];
+    bool have[2];
+    for (int slot = 0; slot < 2; slot++) {
+        slot_path(file[slot], sizeof(file[slot]), path, slot);
+        have[slot] = state_peek_dwalk2(file[slot], &h[slot]);
+        // checkpoint inej simulácie (iný seed alebo rozmery) sa nepoužije
+        if (have[slot] && haveMain && (h[slot].Seed != s->Seed || h[slot].WorldHeight != s->WorldHeight ||
+                                       h[slot].WorldWidth != s->WorldWidth || h[slot].ActRep <= s->ActRep)) {
+            have[slot] = false;
+        }
+    }
+    int order[2] = {0, 1};
+    if (have[0] && have[1] && h[1].ActRep > h[0].ActRep) { order[0] = 1; order[1] = 0; }
+
+    for (int k = 0; k < 2; k++) {
+        int slot = order[k];
+        if (!have[slot]) continue;
+        Sim tmp;
+        memset(&tmp, 0, sizeof(tmp));
+        if (!state_load_dwalk2(&tmp, file[slot])) { sim_free(&tmp); continue; } // nedopísaný/poškodený
+        sim_free(s);
+        *s = tmp;
+        if (recovered && recoveredLen) snprintf(recovered, recoveredLen, "%s", file[slot]);
+        return true;
+    }
+    return haveMain;
+}
@@ -0,0 +1,37 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sim.h"
+
+// Priebežné ukladanie počas sim_run: vlákna na hranici replikácie zrátajú svoje
+// súkromné sumy do snímky (každé svoj úsek buniek) a samostatné vlákno ju zapíše
+// ako DWALK2 striedavo do <path>.ckpt0 / <path>.ckpt1. Simulácia na disk nečaká;
+// ak predchádzajúci zápis ešte beží, checkpoint sa preskočí.
+typedef struct Checkpoint Checkpoint;
+
+// NULL ak je checkpointing vypnutý (CheckpointReps aj CheckpointSecs 0, bez ResultFilePath) alebo chyba
+Checkpoint *checkpoint_start(const Sim *s);
+// volá jedno vlákno na hranici replikácie: je čas na checkpoint a zapisovač je voľný?
+// Snímka dostane samples a censored, až keď ich má s.
+bool checkpoint_due(Checkpoint *c, const Sim *s);
+// polia snímky (steps_sum, hits_sum, samples, censored; FreeCells prvkov, posledné dve môžu
+// byť NULL), do ktorých vlákna sčítajú svoje úseky
+uint64_t **checkpoint_arrays(Checkpoint *c);
+// ... a m2 snímky (spája sa pred sčítaním súm); NULL, ak sa rozptyl nevedie
+double *checkpoint_m2(Checkpoint *c);
+// snímka je úplná -> zapisovač ju uloží v pozadí
+void checkpoint_submit(Checkpoint *c, const Sim *s);
+// počká na rozbehnutý zápis a ukončí zapisovač
+void checkpoint_stop(Checkpoint *c);
+
+// zmaže <path>.ckpt0/1 (po úspešnom uložení výsledku alebo pred novou simuláciou)
+void checkpoint_discard(const char *path);
+// Načíta path; ak vedľa neho leží platný checkpoint tej istej simulácie s vyšším
+// ActRep (napr. po páde servera pred END_SIM), použije ten. recovered dostane názov
+// použitého checkpointu alebo "".
+bool checkpoint_recover(Sim *s, const char *path, char *recovered, size_t recoveredLen);
+
+#endif
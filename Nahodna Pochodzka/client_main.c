@@ -1,224 +1,364 @@
-// client_main.c
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdbool.h>
-#include <unistd.h>
-
-#include "socket.h"
-
-#define BUF_SIZE 4096
-
-static void trim_newline(char *s) {
-    if (!s) return;
-    size_t n = strlen(s);
-    while (n > 0 && (s[n-1] == '\n' || s[n-1] == '\r')) {
-        s[n-1] = '\0';
-        n--;
-    }
-}
-
-static int send_all(int sock, const char *data) {
-    size_t len = strlen(data);
-    size_t sent = 0;
-    while (sent < len) {
-        ssize_t n = send(sock, data + sent, len - sent, 0);
-        if (n <= 0) return -1;
-        sent += (size_t)n;
-    }
-    return 0;
-}
-
-static ssize_t recv_line(int sock, char *buf, size_t maxlen) {
-    size_t pos = 0;
-    while (pos + 1 < maxlen) {
-        char c;
-        ssize_t n = recv(sock, &c, 1, 0);
-        if (n <= 0) {
-            if (pos == 0) return n;
-            break;
-        }
-        if (c == '\n') {
-            buf[pos] = '\0';
-            return (ssize_t)pos;
-        }
-        buf[pos++] = c;
-    }
-    buf[pos] = '\0';
-    return (ssize_t)pos;
-}
-
-static void menu() {
-    printf("\n--- Random Walk CLIENT ---\n");
-    printf("1) Nova simulacia\n");
-    printf("2) Obnovit simulaciu zo suboru\n");
-    printf("3) Spustit dalsie replikacie\n");
-    printf("4) Zobrazit priemer krokov\n");
-    printf("5) Zobrazit pravdepodobnost do K\n");
-    printf("6) Nastavit mod (0=sumar,1=interaktivny)\n");
-    printf("0) Koniec (QUIT)\n");
-    printf("Volba: ");
-    fflush(stdout);
-}
-
-int main(int argc, char *argv[]) {
-    const char *serverName = "127.0.0.1";
-    int port = 5555;
-
-    if (argc >= 2) serverName = argv[1];
-    if (argc >= 3) {
-        port = atoi(argv[2]);
-        if (port <= 0) port = 5555;
-    }
-
-    int sock = connect_to_server(serverName, port);
-    if (sock < 0) {
-        fprintf(stderr, "Neviem sa pripojit na server %s:%d\n", serverName, port);
-        return 1;
-    }
-
-    char buf[BUF_SIZE];
-
-    ssize_t n = recv_line(sock, buf, sizeof(buf));
-    if (n > 0) {
-        printf("%s\n", buf);
-    }
-
-    for (;;) {
-        menu();
-        int choice = -1;
-        if (scanf("%d", &choice) != 1) break;
-
-        int ch;
-        while ((ch = getchar()) != '\n' && ch != EOF) {}
-
-        if (choice == 0) {
-            send_all(sock, "QUIT\n");
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n > 0) printf("%s\n", buf);
-            break;
-        } else if (choice == 1) {
-            int H,W,wt,reps,K;
-            double pU,pD,pL,pR;
-            char out[256];
-
-            printf("WorldHeight: "); scanf("%d", &H);
-            printf("WorldWidth: "); scanf("%d", &W);
-            printf("WorldType (0=bez,1=prekazky): "); scanf("%d", &wt);
-            printf("MoveProbs U D L R (sum=1): "); scanf("%lf %lf %lf %lf", &pU,&pD,&pL,&pR);
-            printf("K (max krokov): "); scanf("%d", &K);
-            printf("Pocet replikacii: "); scanf("%d", &reps);
-            int c;
-            while ((c = getchar()) != '\n' && c != EOF) {}
-            printf("Subor pre ulozenie stavu: ");
-            if (!fgets(out, sizeof(out), stdin)) continue;
-            trim_newline(out);
-
-            char cmd[BUF_SIZE];
-            snprintf(cmd, sizeof(cmd),
-                     "NEW_SIM %d %d %d %f %f %f %f %d %d %s\n",
-                     H, W, wt, pU, pD, pL, pR, K, reps, out);
-            send_all(sock, cmd);
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n > 0) printf("%s\n", buf);
-
-        } else if (choice == 2) {
-            char inFile[256], outFile[256];
-            int reps;
-
-            printf("Subor s ulozenou simulaciou: ");
-            if (!fgets(inFile, sizeof(inFile), stdin)) continue;
-            trim_newline(inFile);
-            printf("Pocet replikacii navyse: ");
-            scanf("%d", &reps);
-            int c;
-            while ((c = getchar()) != '\n' && c != EOF) {}
-            printf("Subor pre ulozenie vysledku: ");
-            if (!fgets(outFile, sizeof(outFile), stdin)) continue;
-            trim_newline(outFile);
-
-            char cmd[BUF_SIZE];
-            snprintf(cmd, sizeof(cmd),
-                     "RESUME_SIM %s %d %s\n",
-                     inFile, reps, outFile);
-            send_all(sock, cmd);
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n > 0) printf("%s\n", buf);
-
-        } else if (choice == 3) {
-            int reps;
-            printf("Kolko dalsich replikacii: ");
-            scanf("%d", &reps);
-            int c;
-            while ((c = getchar()) != '\n' && c != EOF) {}
-
-            char cmd[128];
-            snprintf(cmd, sizeof(cmd),
-                     "RUN_MORE %d\n", reps);
-            send_all(sock, cmd);
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n > 0) printf("%s\n", buf);
-
-        } else if (choice == 4) {
-            send_all(sock, "GET_SUMMARY_AVG\n");
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n <= 0) {
-                printf("Chyba odpovede\n");
-                continue;
-            }
-            printf("%s\n", buf);
-
-            int H=0,W=0;
-            sscanf(buf, "OK SUMMARY_AVG H=%d W=%d", &H, &W);
-
-            for (int r = 0; r < H; r++) {
-                n = recv_line(sock, buf, sizeof(buf));
-                if (n <= 0) break;
-                printf("%s\n", buf);
-            }
-
-        } else if (choice == 5) {
-            send_all(sock, "GET_SUMMARY_PROB\n");
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n <= 0) {
-                printf("Chyba odpovede\n");
-                continue;
-            }
-            printf("%s\n", buf);
-
-            int H=0,W=0;
-            sscanf(buf, "OK SUMMARY_PROB H=%d W=%d", &H, &W);
-
-            for (int r = 0; r < H; r++) {
-                n = recv_line(sock, buf, sizeof(buf));
-                if (n <= 0) break;
-                printf("%s\n", buf);
-            }
-
-        } else if (choice == 6) {
-            int m;
-            printf("Zadaj mod (0=sumar,1=interaktivny): ");
-            scanf("%d", &m);
-            int c;
-            while ((c = getchar()) != '\n' && c != EOF) {}
-
-            char cmd[64];
-            snprintf(cmd, sizeof(cmd),
-                     "SET_MODE %d\n", m);
-            send_all(sock, cmd);
-
-            n = recv_line(sock, buf, sizeof(buf));
-            if (n > 0) printf("%s\n", buf);
-        } else {
-            printf("Neznama volba.\n");
-        }
-    }
-
-    close(sock);
-    return 0;
-}
+// client_main.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "rwclient.h"
+
+#define BUF_SIZE 4096
+
+static void trim_newline(char *s) {
+    if (!s) return;
+    size_t n = strlen(s);
+    while (n > 0 && (s[n-1] == '\n' || s[n-1] == '\r')) {
+        s[n-1] = '\0';
+        n--;
+    }
+}
+
+static void print_grid(const RwSummary *s, const double *val, const char *fmt) {
+    size_t n = (size_t)s->H * (size_t)s->W;
+    for (size_t i = 0; i < n; i++) {
+        if (s->obstacle[i]) printf("X ");
+        else printf(fmt, val[i]);
+        if ((i + 1) % (size_t)s->W == 0) printf("\n");
+    }
+}
+
+// druh odpovede
+enum {
+    REPLY_LINE = 0,                 // len stavový riadok
+    REPLY_SUMMARY,                  // GET_SUMMARY_*
+    REPLY_FRAMES,                   // WATCH, behy v interaktívnom móde
+    REPLY_STATS,                    // STATS (stavový riadok a Lines= riadkov)
+    REPLY_STATE                     // EXPORT_STATE (stavový riadok a prúd codec)
+};
+
+#define FRAME_PRINT_MOVES 48        // koľko pohybov záberu sa vypíše
+
+// jeden záber: kde prechádzka začala a skončila a jej prvé pohyby
+static void print_frame(const RwFrame *f) {
+    static const char dirs[4] = {'U', 'D', 'L', 'R'};
+    char path[FRAME_PRINT_MOVES + 4];
+    uint32_t n = f->moves < FRAME_PRINT_MOVES ? f->moves : FRAME_PRINT_MOVES;
+    for (uint32_t k = 0; k < n; k++) path[k] = dirs[(f->code[k >> 2] >> ((k & 3) * 2)) & 3];
+    path[n] = '\0';
+    if (n < f->moves) strcat(path, "...");
+    printf("[%llu] rep %llu: (%d,%d) -> (%d,%d) krokov=%u%s %s\n",
+           (unsigned long long)f->seq, (unsigned long long)f->rep,
+           f->fromRow, f->fromCol, f->toRow, f->toCol, f->steps, f->hit ? " stred" : "", path);
+}
+
+// stavový riadok, pri sumári aj mriežky, pri záberoch každý záber; false ak sa spojenie pokazilo
+static bool print_reply(RwClient *c, int kind) {
+    RwReply r;
+    if (kind == REPLY_FRAMES) {
+        RwFrame f;
+        int got;
+        while ((got = rwc_read_frame(c, &f, &r)) == 1) {
+            print_frame(&f);
+            fflush(stdout);
+        }
+        if (got < 0) return false;
+        printf("%s\n", r.line);
+        return true;
+    }
+    if (kind == REPLY_LINE) {
+        if (!rwc_reply(c, &r)) return false;
+        printf("%s\n", r.line);
+        return true;
+    }
+    if (kind == REPLY_STATS) {
+        char text[16 * 1024];
+        if (!rwc_read_stats(c, &r, text, sizeof(text))) return false;
+        printf("%s\n%s", r.line, text);
+        return true;
+    }
+    if (kind == REPLY_STATE) {
+        RwState st;
+        bool ok = rwc_read_state(c, &st, &r);
+        printf("%s\n", r.line);
+        if (!ok) {
+            printf("Poskodeny prenos stavu\n");
+            return false;
+        }
+        if (!r.ok) return true;
+        size_t n = (size_t)st.H * (size_t)st.W;
+        uint64_t samples = 0, censored = 0;
+        for (size_t i = 0; i < n; i++) {
+            samples += st.samples[i];
+            censored += st.censored[i];
+        }
+        printf("Replikacie %d..%d, vzoriek %llu, cenzurovanych %llu\n", st.rep0, st.actRep,
+               (unsigned long long)samples, (unsigned long long)censored);
+        rwc_state_free(&st);
+        return true;
+    }
+    RwSummary s;
+    bool ok = rwc_read_summary(c, &s, &r);
+    printf("%s\n", r.line);
+    if (!ok) {
+        printf("Poskodeny prenos sumaru\n");
+        return false;
+    }
+    if (!r.ok) return true;
+    if (s.avg && s.prob) printf("Prijatych bajtov: %llu\n", (unsigned long long)s.bytes);
+    if (s.avg) {
+        if (s.prob) printf("Priemer krokov:\n");
+        print_grid(&s, s.avg, "%.1f ");
+    }
+    if (s.prob) {
+        if (s.avg) printf("Pravdepodobnost do K=%d:\n", s.K);
+        print_grid(&s, s.prob, "%.2f ");
+    }
+    rwc_summary_free(&s);
+    return true;
+}
+
+static bool is_run_command(const char *line) {
+    return strncmp(line, "NEW_SIM ", 8) == 0 || strncmp(line, "RESUME_SIM ", 11) == 0 ||
+           strncmp(line, "RUN_MORE ", 9) == 0 || strncmp(line, "RUN_UNTIL ", 10) == 0;
+}
+
+// Dávkový režim (tretí argument "-"): príkazy zo stdin odídu naraz (pipelining),
+// odpovede sa vypíšu v rovnakom poradí.
+static int run_script(RwClient *c) {
+    char line[BUF_SIZE];
+    int kind[BUF_SIZE];             // pre každý zaradený príkaz druh odpovede
+    int count = 0;
+    bool quit = false, interactive = false;
+    while (!quit && count < BUF_SIZE && fgets(line, sizeof(line), stdin)) {
+        trim_newline(line);
+        if (line[0] == '\0') continue;
+        if (!rwc_send(c, line)) return 1;
+        if (strncmp(line, "SET_MODE ", 9) == 0) interactive = atoi(line + 9) == 1;
+        kind[count++] = strncmp(line, "GET_SUMMARY_", 12) == 0 ? REPLY_SUMMARY
+                      : strcmp(line, "STATS") == 0 ? REPLY_STATS
+                      : strcmp(line, "EXPORT_STATE") == 0 ? REPLY_STATE
+                      : (strncmp(line, "WATCH", 5) == 0 || (interactive && is_run_command(line))) ? REPLY_FRAMES
+                      : REPLY_LINE;
+        quit = strcmp(line, "QUIT") == 0;
+    }
+    if (!rwc_flush(c)) return 1;
+    for (int k = 0; k < count; k++) {
+        if (!print_reply(c, kind[k])) return 1;
+    }
+    return 0;
+}
+
+static void menu() {
+    printf("\n--- Random Walk CLIENT ---\n");
+    printf("1) Nova simulacia\n");
+    printf("2) Obnovit simulaciu zo suboru\n");
+    printf("3) Spustit dalsie replikacie\n");
+    printf("4) Zobrazit priemer krokov\n");
+    printf("5) Zobrazit pravdepodobnost do K\n");
+    printf("6) Nastavit mod (0=sumar,1=interaktivny)\n");
+    printf("7) Kompaktny sumar (priemer aj pravdepodobnost naraz)\n");
+    printf("8) Binarny sumar (float32)\n");
+    printf("9) Stav behu (JOB_STATUS)\n");
+    printf("10) Zrusit beh (CANCEL)\n");
+    printf("11) Nova relacia (OPEN)\n");
+    printf("12) Pripojit sa k relacii (ATTACH)\n");
+    printf("13) Zatvorit relaciu (CLOSE)\n");
+    printf("14) Sledovat beh (WATCH)\n");
+    printf("15) Replikacie do presnosti (RUN_UNTIL)\n");
+    printf("16) Statistiky servera (STATS)\n");
+    printf("17) Zlucit replikacie z ineho servera (MERGE_STATE)\n");
+    printf("0) Koniec (QUIT)\n");
+    printf("Volba: ");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    const char *serverName = "127.0.0.1";
+    int port = 5555;
+
+    if (argc >= 2) serverName = argv[1];
+    if (argc >= 3) {
+        port = atoi(argv[2]);
+        if (port <= 0) port = 5555;
+    }
+
+    RwClient c;
+    if (!rwc_connect(&c, serverName, port)) {
+        fprintf(stderr, "Neviem sa pripojit na server %s:%d\n", serverName, port);
+        return 1;
+    }
+    if (argc >= 4 && strcmp(argv[3], "-") == 0) {
+        int rc = run_script(&c);
+        rwc_close(&c);
+        return rc;
+    }
+
+    printf("%s\n", c.hello);
+    bool interactive = false;       // SET_MODE 1: behy posielajú zábery
+
+    for (;;) {
+        menu();
+        int choice = -1;
+        if (scanf("%d", &choice) != 1) break;
+
+        int ch;
+        while ((ch = getchar()) != '\n' && ch != EOF) {}
+
+        int kind = REPLY_LINE;
+        if (choice == 0) {
+            rwc_quit(&c);
+            print_reply(&c, REPLY_LINE);
+            break;
+        } else if (choice == 1) {
+            RwNewSim p;
+            int wt;
+            char out[256];
+
+            printf("WorldHeight: "); scanf("%d", &p.H);
+            printf("WorldWidth: "); scanf("%d", &p.W);
+            printf("WorldType (0=bez,1=prekazky): "); scanf("%d", &wt);
+            printf("MoveProbs U D L R (sum=1): ");
+            scanf("%lf %lf %lf %lf", &p.moveProbs[0], &p.moveProbs[1], &p.moveProbs[2], &p.moveProbs[3]);
+            printf("K (max krokov): "); scanf("%d", &p.K);
+            printf("Pocet replikacii: "); scanf("%d", &p.reps);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+            printf("Subor pre ulozenie stavu: ");
+            if (!fgets(out, sizeof(out), stdin)) continue;
+            trim_newline(out);
+            char opts[256];
+            printf("Volitelne parametre (napr. threads=4 seed=42 density=0.3 world=mapa.pgm mode=exact estimator=recycle maxsteps=100000 probonly=1 format=text wait=1), Enter=ziadne: ");
+            if (!fgets(opts, sizeof(opts), stdin)) continue;
+            trim_newline(opts);
+
+            p.obstacles = wt != 0;
+            p.resultFile = out;
+            p.opts = opts;
+            rwc_new_sim(&c, &p);
+            if (interactive) kind = REPLY_FRAMES;
+        } else if (choice == 2) {
+            char inFile[256], outFile[256];
+            int reps;
+
+            printf("Subor s ulozenou simulaciou: ");
+            if (!fgets(inFile, sizeof(inFile), stdin)) continue;
+            trim_newline(inFile);
+            printf("Pocet replikacii navyse (0=len ulozit v novom formate): ");
+            scanf("%d", &reps);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+            printf("Subor pre ulozenie vysledku: ");
+            if (!fgets(outFile, sizeof(outFile), stdin)) continue;
+            trim_newline(outFile);
+            char opts[256];
+            printf("Volitelne parametre (napr. threads=4 format=text|bin|z ckpt_reps=100 wait=1), Enter=ziadne: ");
+            if (!fgets(opts, sizeof(opts), stdin)) continue;
+            trim_newline(opts);
+
+            rwc_resume_sim(&c, inFile, reps, outFile, opts);
+            if (interactive) kind = REPLY_FRAMES;
+        } else if (choice == 3) {
+            int reps;
+            printf("Kolko dalsich replikacii: ");
+            scanf("%d", &reps);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+            char opts[256];
+            printf("Volitelne parametre (napr. threads=4 estimator=recycle maxsteps=100000 probonly=1 wait=1), Enter=ziadne: ");
+            if (!fgets(opts, sizeof(opts), stdin)) continue;
+            trim_newline(opts);
+
+            rwc_run_more(&c, reps, opts);
+            if (interactive) kind = REPLY_FRAMES;
+        } else if (choice == 4) {
+            rwc_get_summary_avg(&c);
+            kind = REPLY_SUMMARY;
+        } else if (choice == 5) {
+            rwc_get_summary_prob(&c);
+            kind = REPLY_SUMMARY;
+        } else if (choice == 6) {
+            int m;
+            printf("Zadaj mod (0=sumar,1=interaktivny): ");
+            scanf("%d", &m);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+
+            rwc_set_mode(&c, m);
+            RwReply r;
+            if (!rwc_reply(&c, &r)) break;
+            printf("%s\n", r.line);
+            if (r.ok) interactive = m == 1;
+            continue;
+        } else if (choice == 7) {
+            rwc_get_summary_z(&c);
+            kind = REPLY_SUMMARY;
+        } else if (choice == 8) {
+            rwc_get_summary_bin(&c, true);
+            kind = REPLY_SUMMARY;
+        } else if (choice == 9) {
+            rwc_job_status(&c);
+        } else if (choice == 10) {
+            rwc_cancel(&c);
+        } else if (choice == 11) {
+            rwc_open(&c);
+        } else if (choice == 12 || choice == 13) {
+            int id;
+            printf(choice == 12 ? "Cislo relacie: " : "Cislo relacie (0=aktualna): ");
+            scanf("%d", &id);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+
+            if (choice == 12) rwc_attach(&c, id);
+            else rwc_close_session(&c, id);
+        } else if (choice == 14) {
+            int frames;
+            printf("Pocet zaberov (0=do konca behu): ");
+            scanf("%d", &frames);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+
+            rwc_watch(&c, frames);
+            kind = REPLY_FRAMES;
+        } else if (choice == 15) {
+            double precision;
+            printf("Presnost (polovica 95%% intervalu, napr. 0.02): ");
+            scanf("%lf", &precision);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+            char opts[256];
+            printf("Volitelne parametre (napr. metric=prob maxreps=10000 threads=4 wait=1), Enter=ziadne: ");
+            if (!fgets(opts, sizeof(opts), stdin)) continue;
+            trim_newline(opts);
+
+            rwc_run_until(&c, precision, opts);
+            if (interactive) kind = REPLY_FRAMES;
+        } else if (choice == 16) {
+            rwc_stats(&c);
+            kind = REPLY_STATS;
+        } else if (choice == 17) {
+            char host[64];
+            int fromPort, id;
+            printf("Server (host port relacia, relacia 0=spolocna): ");
+            int got = scanf("%63s %d %d", host, &fromPort, &id);
+            int ch2;
+            while ((ch2 = getchar()) != '\n' && ch2 != EOF) {}
+            if (got != 3) {
+                printf("Neplatny vstup.\n");
+                continue;
+            }
+
+            rwc_merge_state(&c, host, fromPort, id);
+        } else {
+            printf("Neznama volba.\n");
+            continue;
+        }
+
+        if (!print_reply(&c, kind)) {
+            printf("Chyba odpovede\n");
+            break;
+        }
+    }
+
+    rwc_close(&c);
+    return 0;
+}
@@ -0,0 +1,343 @@
+// codec.c - delta/varint kódovanie počítadiel s rANS entropickým stupňom
+#include "codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define CODEC_MODE_RAW 0
+#define CODEC_MODE_RANS 1
+
+#define RANS_L (1u << 23)           // dolná hranica stavu (bajtové renormalizovanie)
+#define RANS_BITS 12
+#define RANS_SCALE (1u << RANS_BITS)
+
+#define CODEC_TABLE_MAX (32 + 256 * 2)  // bitmapa prítomných symbolov + u16 frekvencie
+#define CODEC_OUT_MAX (CODEC_TABLE_MAX + 4 + CODEC_BLOCK + CODEC_BLOCK / 2)
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// --- rANS rádu 0 (bajtový, podľa F. Giesena), frekvencie normalizované na 2^12 ---
+
+static void rans_freqs(const uint8_t *in, size_t n, uint32_t freq[256]) {
+    uint32_t cnt[256] = {0};
+    for (size_t i = 0; i < n; i++) cnt[in[i]]++;
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = cnt[s] ? (uint32_t)((uint64_t)cnt[s] * RANS_SCALE / n) : 0;
+        if (cnt[s] && freq[s] == 0) freq[s] = 1;
+        sum += freq[s];
+    }
+    // dorovnanie na presne RANS_SCALE na účet najčastejších symbolov
+    while (sum != RANS_SCALE) {
+        int best = 0;
+        for (int s = 1; s < 256; s++) if (freq[s] > freq[best]) best = s;
+        if (sum < RANS_SCALE) {
+            freq[best] += RANS_SCALE - sum;
+            sum = RANS_SCALE;
+        } else {
+            freq[best]--; // zaokrúhľovanie nadol + minimum 1 -> prebytok je najviac 256
+            sum--;
+        }
+    }
+}
+
+// vráti dĺžku payloadu (tabuľka + stav + prúd) alebo 0, ak sa to neoplatí
+static size_t rans_encode(const uint8_t *in, size_t n, uint8_t *out) {
+    uint32_t freq[256], start[256];
+    rans_freqs(in, n, freq);
+    uint32_t c = 0;
+    for (int s = 0; s < 256; s++) { start[s] = c; c += freq[s]; }
+
+    size_t t = 32;
+    memset(out, 0, 32);
+    for (int s = 0; s < 256; s++) {
+        if (!freq[s]) continue;
+        out[s >> 3] |= (uint8_t)(1u << (s & 7));
+        out[t++] = (uint8_t)freq[s];
+        out[t++] = (uint8_t)(freq[s] >> 8);
+    }
+
+    // kóduje sa odzadu do konca buffra, dekóduje sa spredu
+    uint8_t *end = out + CODEC_OUT_MAX, *p = end;
+    uint8_t *limit = out + t + 4;
+    uint32_t x = RANS_L;
+    for (size_t i = n; i-- > 0;) {
+        uint32_t f = freq[in[i]];
+        uint32_t xMax = ((RANS_L >> RANS_BITS) << 8) * f;
+        while (x >= xMax) {
+            if (p <= limit) return 0;
+            *--p = (uint8_t)x;
+            x >>= 8;
+        }
+        x = ((x / f) << RANS_BITS) + (x % f) + start[in[i]];
+    }
+    p -= 4;
+    if (p < out + t) return 0;
+    put_u32(p, x);
+
+    size_t len = (size_t)(end - p);
+    if (t + len >= n) return 0;
+    memmove(out + t, p, len);
+    return t + len;
+}
+
+static bool rans_decode(const uint8_t *in, size_t len, uint8_t *out, size_t n) {
+    if (len < 32) return false;
+    uint32_t freq[256] = {0}, start[256];
+    size_t t = 32;
+    for (int s = 0; s < 256; s++) {
+        if (!(in[s >> 3] & (1u << (s & 7)))) continue;
+        if (t + 2 > len) return false;
+        freq[s] = (uint32_t)in[t] | (uint32_t)in[t + 1] << 8;
+        t += 2;
+    }
+    uint8_t sym[RANS_SCALE];
+    uint32_t c = 0;
+    for (int s = 0; s < 256; s++) {
+        start[s] = c;
+        if (freq[s] > RANS_SCALE - c) return false;
+        memset(sym + c, s, freq[s]);
+        c += freq[s];
+    }
+    if (c != RANS_SCALE || t + 4 > len) return false;
+
+    const uint8_t *p = in + t, *end = in + len;
+    uint32_t x = get_u32(p);
+    p += 4;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t slot = x & (RANS_SCALE - 1);
+        uint8_t s = sym[slot];
+        out[i] = s;
+        x = freq[s] * (x >> RANS_BITS) + slot - start[s];
+        while (x < RANS_L) {
+            if (p >= end) return false;
+            x = (x << 8) | *p++;
+        }
+    }
+    return true;
+}
+
+// --- zápis ---
+
+static void flush_block(CodecWriter *w, bool last) {
+    if (!w->ok) return;
+    uint8_t head[9];
+    if (w->fill > 0) {
+        // hash je zo surových bajtov (pred entropickým stupňom)
+        h64_update(&w->hash, w->raw, w->fill);
+        size_t len = rans_encode(w->raw, w->fill, w->out);
+        uint8_t mode = len ? CODEC_MODE_RANS : CODEC_MODE_RAW;
+        const uint8_t *payload = len ? w->out : w->raw;
+        if (!len) len = w->fill;
+        put_u32(head, (uint32_t)w->fill);
+        head[4] = mode;
+        put_u32(head + 5, (uint32_t)len);
+        w->ok = w->sink(w->ctx, head, sizeof(head)) && w->sink(w->ctx, payload, len);
+        w->bytesOut += sizeof(head) + len;
+        w->fill = 0;
+    }
+    if (last && w->ok) {
+        uint8_t tail[12];
+        uint64_t h = h64_final(&w->hash);
+        put_u32(tail, 0);
+        put_u32(tail + 4, (uint32_t)h);
+        put_u32(tail + 8, (uint32_t)(h >> 32));
+        w->ok = w->sink(w->ctx, tail, sizeof(tail));
+        w->bytesOut += sizeof(tail);
+    }
+}
+
+static inline void put_varint(CodecWriter *w, uint64_t v) {
+    if (CODEC_BLOCK - w->fill < 10) flush_block(w, false);
+    uint8_t *p = w->raw + w->fill;
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    w->fill = (size_t)(p - w->raw);
+}
+
+bool codec_writer_init(CodecWriter *w, CodecSink sink, void *ctx) {
+    memset(w, 0, sizeof(*w));
+    w->sink = sink;
+    w->ctx = ctx;
+    w->raw = (uint8_t*)malloc(CODEC_BLOCK);
+    w->out = (uint8_t*)malloc(CODEC_OUT_MAX);
+    h64_init(&w->hash);
+    w->ok = w->raw && w->out;
+    return w->ok;
+}
+
+void codec_put_bits(CodecWriter *w, const bool *a, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+        uint8_t b = 0;
+        for (size_t k = 0; k < 8 && i + k < n; k++) b |= (uint8_t)((a[i + k] ? 1u : 0u) << k);
+        if (w->fill == CODEC_BLOCK) flush_block(w, false);
+        w->raw[w->fill++] = b;
+    }
+}
+
+void codec_put_row(CodecWriter *w, const uint64_t *row, const uint64_t *up, int W) {
+    for (int c = 0; c < W; c++) {
+        int64_t d = (int64_t)(row[c] - (up ? up[c] : 0));
+        uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+        put_varint(w, z);
+    }
+}
+
+void codec_put_rows(CodecWriter *w, const uint64_t *a, int H, int W) {
+    for (int r = 0; r < H; r++) {
+        const uint64_t *row = a + (size_t)r * W;
+        codec_put_row(w, row, r > 0 ? row - W : NULL, W);
+    }
+}
+
+bool codec_writer_finish(CodecWriter *w) {
+    flush_block(w, true);
+    bool ok = w->ok;
+    free(w->raw);
+    free(w->out);
+    w->raw = w->out = NULL;
+    return ok;
+}
+
+// --- čítanie ---
+
+static bool read_exact(CodecReader *r, void *data, size_t len) {
+    r->bytesIn += len;
+    return r->source(r->ctx, data, len);
+}
+
+static bool next_block(CodecReader *r) {
+    if (!r->ok || r->end) return false;
+    uint8_t head[9];
+    if (!read_exact(r, head, 4)) return r->ok = false;
+    uint32_t rawLen = get_u32(head);
+    if (rawLen == 0) {
+        uint8_t h[8];
+        if (!read_exact(r, h, 8)) return r->ok = false;
+        uint64_t expect = (uint64_t)get_u32(h) | (uint64_t)get_u32(h + 4) << 32;
+        r->end = true;
+        if (h64_final(&r->hash) != expect) r->ok = false;
+        return false;
+    }
+    if (!read_exact(r, head + 4, 5)) return r->ok = false;
+    uint8_t mode = head[4];
+    uint32_t len = get_u32(head + 5);
+    if (rawLen > CODEC_BLOCK || len > CODEC_OUT_MAX) return r->ok = false;
+    if (mode == CODEC_MODE_RAW) {
+        if (len != rawLen || !read_exact(r, r->raw, len)) return r->ok = false;
+    } else if (mode == CODEC_MODE_RANS) {
+        if (!read_exact(r, r->in, len) || !rans_decode(r->in, len, r->raw, rawLen)) return r->ok = false;
+    } else {
+        return r->ok = false;
+    }
+    h64_update(&r->hash, r->raw, rawLen);
+    r->fill = rawLen;
+    r->pos = 0;
+    return true;
+}
+
+static inline uint8_t get_byte(CodecReader *r) {
+    if (r->pos == r->fill && !next_block(r)) {
+        r->ok = false;
+        return 0;
+    }
+    return r->raw[r->pos++];
+}
+
+static inline uint64_t get_varint(CodecReader *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = get_byte(r);
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->ok = false;
+    return 0;
+}
+
+bool codec_reader_init(CodecReader *r, CodecSource source, void *ctx) {
+    memset(r, 0, sizeof(*r));
+    r->source = source;
+    r->ctx = ctx;
+    r->raw = (uint8_t*)malloc(CODEC_BLOCK);
+    r->in = (uint8_t*)malloc(CODEC_OUT_MAX);
+    h64_init(&r->hash);
+    r->ok = r->raw && r->in;
+    return r->ok;
+}
+
+void codec_get_bits(CodecReader *r, bool *a, size_t n) {
+    for (size_t i = 0; i < n && r->ok; i += 8) {
+        uint8_t b = get_byte(r);
+        for (size_t k = 0; k < 8 && i + k < n; k++) a[i + k] = (b >> k) & 1u;
+    }
+}
+
+void codec_get_row(CodecReader *r, uint64_t *row, const uint64_t *up, int W) {
+    for (int c = 0; c < W; c++) {
+        uint64_t z = get_varint(r);
+        uint64_t d = (z >> 1) ^ (0 - (z & 1));
+        row[c] = (up ? up[c] : 0) + d;
+    }
+}
+
+void codec_get_rows(CodecReader *r, uint64_t *a, int H, int W) {
+    for (int row = 0; row < H && r->ok; row++) {
+        uint64_t *cur = a + (size_t)row * W;
+        codec_get_row(r, cur, row > 0 ? cur - W : NULL, W);
+    }
+}
+
+bool codec_reader_finish(CodecReader *r) {
+    // zvyšok bloku musí byť prázdny a ďalej musí prísť koniec prúdu s kontrolným súčtom
+    bool ok = r->ok && r->pos == r->fill;
+    if (ok && !r->end) {
+        next_block(r);
+        ok = r->ok && r->end;
+    }
+    free(r->raw);
+    free(r->in);
+    r->raw = r->in = NULL;
+    return ok;
+}
+
+bool codec_file_sink(void *f, const void *data, size_t len) {
+    return fwrite(data, 1, len, (FILE*)f) == len;
+}
+
+bool codec_file_source(void *f, void *data, size_t len) {
+    return fread(data, 1, len, (FILE*)f) == len;
+}
+
+bool codec_socket_sink(void *sock, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(*(int*)sock, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool codec_socket_source(void *sock, void *data, size_t len) {
+    char *p = (char*)data;
+    while (len > 0) {
+        ssize_t n = recv(*(int*)sock, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
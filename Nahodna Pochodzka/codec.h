@@ -0,0 +1,69 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash64.h"
+
+// Kompaktné kódovanie počítadiel (bez externých knižníc), prúdovo po blokoch:
+//   u64 polia: rozdiel voči bunke o riadok vyššie -> zigzag -> varint (LEB128)
+//   prekážky:  8 buniek na bajt
+// Surové bajty idú po blokoch CODEC_BLOCK cez rANS rádu 0 (ak blok nezmenší, uloží sa
+// nezmenený). Pamäť kódovača aj dekódovača je len jeden blok - polia sa čítajú a plnia
+// priamo, predchádzajúci riadok je už v nich.
+//
+// Prúd: bloky [u32 rawLen][u8 mode][u32 payloadLen][payload], koniec = rawLen 0 + u64 hash surových bajtov.
+
+#define CODEC_BLOCK (1u << 16)
+
+// zápis / čítanie presne len bajtov (súbor, socket)
+typedef bool (*CodecSink)(void *ctx, const void *data, size_t len);
+typedef bool (*CodecSource)(void *ctx, void *data, size_t len);
+
+typedef struct CodecWriter {
+    CodecSink sink;
+    void *ctx;
+    uint8_t *raw;                   // CODEC_BLOCK
+    uint8_t *out;                   // zakódovaný blok
+    size_t fill;
+    Hash64 hash;
+    uint64_t bytesOut;              // koľko bajtov odišlo do sink
+    bool ok;
+} CodecWriter;
+
+typedef struct CodecReader {
+    CodecSource source;
+    void *ctx;
+    uint8_t *raw;
+    uint8_t *in;
+    size_t fill, pos;
+    bool end;                       // prečítaný koncový blok
+    uint64_t bytesIn;               // koľko bajtov prišlo zo source
+    Hash64 hash;
+    bool ok;
+} CodecReader;
+
+bool codec_writer_init(CodecWriter *w, CodecSink sink, void *ctx);
+void codec_put_bits(CodecWriter *w, const bool *a, size_t n);
+void codec_put_rows(CodecWriter *w, const uint64_t *a, int H, int W);
+// jeden riadok voči riadku up (NULL = prvý riadok); pre polia, ktoré nie sú celé v pamäti
+void codec_put_row(CodecWriter *w, const uint64_t *row, const uint64_t *up, int W);
+// dopíše posledný blok a koniec prúdu; vráti, či celý zápis prešiel
+bool codec_writer_finish(CodecWriter *w);
+
+bool codec_reader_init(CodecReader *r, CodecSource source, void *ctx);
+void codec_get_bits(CodecReader *r, bool *a, size_t n);
+void codec_get_rows(CodecReader *r, uint64_t *a, int H, int W);
+void codec_get_row(CodecReader *r, uint64_t *row, const uint64_t *up, int W);
+// overí koniec prúdu a kontrolný súčet
+bool codec_reader_finish(CodecReader *r);
+
+// sink/source pre FILE* a pre socket (ctx je int *)
+bool codec_file_sink(void *f, const void *data, size_t len);
+bool codec_file_source(void *f, void *data, size_t len);
+bool codec_socket_sink(void *sock, const void *data, size_t len);
+bool codec_socket_source(void *sock, void *data, size_t len);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Prúdový 64-bitový kontrolný súčet (4 nezávislé akumulátory, kolo ako v xxHash64).
+// Používa ho DWALK2 (celý súbor) aj kódovač codec.c (surové bajty prúdu).
+#define H64_P1 0x9E3779B185EBCA87ull
+#define H64_P2 0xC2B2AE3D27D4EB4Full
+#define H64_P3 0x165667B19E3779F9ull
+
+typedef struct Hash64 {
+    uint64_t acc[4];
+    unsigned char buf[32];
+    size_t fill;
+    uint64_t total;
+} Hash64;
+
+static inline uint64_t h64_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t h64_round(uint64_t acc, uint64_t w) {
+    return h64_rotl(acc + w * H64_P2, 31) * H64_P1;
+}
+
+static inline void h64_block(Hash64 *h, const unsigned char *p) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t w;
+        memcpy(&w, p + 8 * i, 8);
+        h->acc[i] = h64_round(h->acc[i], w);
+    }
+}
+
+static inline void h64_init(Hash64 *h) {
+    memset(h, 0, sizeof(*h));
+    h->acc[0] = H64_P1 + H64_P2;
+    h->acc[1] = H64_P2;
+    h->acc[2] = 0;
+    h->acc[3] = 0 - H64_P1;
+}
+
+static inline void h64_update(Hash64 *h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    h->total += len;
+    if (h->fill) {
+        size_t take = 32 - h->fill < len ? 32 - h->fill : len;
+        memcpy(h->buf + h->fill, p, take);
+        h->fill += take;
+        p += take;
+        len -= take;
+        if (h->fill < 32) return;
+        h64_block(h, h->buf);
+        h->fill = 0;
+    }
+    for (; len >= 32; p += 32, len -= 32) h64_block(h, p);
+    memcpy(h->buf, p, len);
+    h->fill = len;
+}
+
+static inline uint64_t h64_final(Hash64 *h) {
+    uint64_t r = h64_rotl(h->acc[0], 1) + h64_rotl(h->acc[1], 7) + h64_rotl(h->acc[2], 12) + h64_rotl(h->acc[3], 18);
+    r ^= h->total;
+    for (size_t i = 0; i < h->fill; i++) r = h64_rotl(r ^ (h->buf[i] * H64_P3), 11) * H64_P1;
+    r ^= r >> 33;
+    r *= H64_P2;
+    r ^= r >> 29;
+    r *= H64_P3;
+    return r ^ (r >> 32);
+}
+
+#endif
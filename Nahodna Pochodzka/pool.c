@@ -0,0 +1,92 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define POOL_MAX_THREADS 256
+
+struct Pool {
+    int size;
+    PoolFn fn;
+    void *arg;
+    pthread_barrier_t barrier;
+
+    pthread_mutex_t gateLock;       // štart až keď je známy počet spustených vlákien
+    pthread_cond_t gateCond;
+    bool gateOpen;
+    bool failed;
+};
+
+typedef struct PoolThread {
+    Pool *p;
+    int tid;
+    pthread_t handle;
+} PoolThread;
+
+static void *pool_main(void *arg) {
+    PoolThread *t = (PoolThread*)arg;
+    Pool *p = t->p;
+
+    pthread_mutex_lock(&p->gateLock);
+    while (!p->gateOpen) pthread_cond_wait(&p->gateCond, &p->gateLock);
+    pthread_mutex_unlock(&p->gateLock);
+    if (!p->failed) p->fn(p, t->tid, p->arg);
+    return NULL;
+}
+
+int pool_run(int nthreads, PoolFn fn, void *arg) {
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > POOL_MAX_THREADS) nthreads = POOL_MAX_THREADS;
+
+    Pool p = {0};
+    p.fn = fn;
+    p.arg = arg;
+    pthread_mutex_init(&p.gateLock, NULL);
+    pthread_cond_init(&p.gateCond, NULL);
+
+    PoolThread *threads = (PoolThread*)calloc((size_t)nthreads, sizeof(PoolThread));
+    if (!threads) return 0;
+
+    int started = 1;
+    for (; started < nthreads; started++) {
+        threads[started].p = &p;
+        threads[started].tid = started;
+        if (pthread_create(&threads[started].handle, NULL, pool_main, &threads[started]) != 0) break;
+    }
+    p.size = started;
+    if (pthread_barrier_init(&p.barrier, NULL, (unsigned)started) != 0) p.failed = true;
+
+    pthread_mutex_lock(&p.gateLock);
+    p.gateOpen = true;
+    pthread_cond_broadcast(&p.gateCond);
+    pthread_mutex_unlock(&p.gateLock);
+
+    if (!p.failed) fn(&p, 0, arg);
+    for (int t = 1; t < started; t++) pthread_join(threads[t].handle, NULL);
+
+    if (!p.failed) pthread_barrier_destroy(&p.barrier);
+    pthread_cond_destroy(&p.gateCond);
+    pthread_mutex_destroy(&p.gateLock);
+    free(threads);
+    return p.failed ? 0 : started;
+}
+
+int pool_size(const Pool *p) {
+    return p->size;
+}
+
+bool pool_barrier(Pool *p) {
+    return pthread_barrier_wait(&p->barrier) == PTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+int pool_threads(int requested, int maxUseful) {
+    int t = requested;
+    if (t <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        t = n > 0 ? (int)n : 1;
+    }
+    if (t > POOL_MAX_THREADS) t = POOL_MAX_THREADS;
+    if (maxUseful > 0 && t > maxUseful) t = maxUseful;
+    return t < 1 ? 1 : t;
+}
@@ -0,0 +1,21 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+
+// Jednorazová skupina vlákien s bariérou pre sim_run a stencilové riešiče.
+// Volajúce vlákno beží ako tid 0; ak sa niektoré vlákno nepodarí spustiť,
+// skupina beží s menším počtom (pool_size vráti skutočný počet).
+typedef struct Pool Pool;
+typedef void (*PoolFn)(Pool *p, int tid, void *arg);
+
+// vráti počet vlákien, ktoré fn naozaj vykonali (0 pri chybe)
+int pool_run(int nthreads, PoolFn fn, void *arg);
+int pool_size(const Pool *p);
+// všetky vlákna skupiny počkajú na seba; práve jednému vráti true
+bool pool_barrier(Pool *p);
+
+// počet vlákien: requested > 0 alebo počet CPU, obmedzené na maxUseful
+int pool_threads(int requested, int maxUseful);
+
+#endif
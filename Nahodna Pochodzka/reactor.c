@@ -0,0 +1,607 @@
+// reactor.c - epoll slučka spojení a skupina pracovných vlákien pre príkazy
+#include "reactor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REACTOR_EVENTS 256
+#define REACTOR_INBUF_MIN 512           // nečinné spojenie drží len malý buffer
+#define REACTOR_OUTBUF_MIN 4096         // výstupný sa alokuje až pri prvom čakaní a po odoslaní uvoľní
+#define REACTOR_SWEEP_MS 1000           // kontrola zatvorených spojení, ktoré ešte dobiehajú výstup
+
+typedef struct Reactor Reactor;
+
+struct ReactorConn {
+    Reactor *r;
+    int fd;
+    void *user;
+    char *in;                       // prijaté, zatiaľ nevykonané bajty
+    size_t len, cap;
+    char *line;                     // práve vykonávaný príkaz (pracovné vlákno)
+    bool busy;                      // príkaz je u pracovného vlákna
+    bool keep;                      // výsledok príkazu (false = zavrieť)
+    bool eof;                       // klient už nič nepošle, zvyšné riadky sa dokončia
+    bool closed;                    // zavrieť hneď, ako nebude busy (a dobehne výstup)
+    uint32_t events;                // udalosti v epoll (0 = nie je v ňom)
+    bool dead;                      // zatvorené, uvoľní sa po spracovaní dávky udalostí
+    bool draining;                  // zatvorené, čaká sa na odoslanie výstupu (najviac do drainUntil)
+    double drainUntil;
+    bool flushQueued;               // je vo fronte flushHead (pod r->lock)
+    struct ReactorConn *next;       // fronta úloh / hotových príkazov / uvoľnenie
+    struct ReactorConn *flushNext;
+    struct ReactorConn *drainNext;
+
+    // výstup: pridáva pracovné vlákno, posiela reaktor pri EPOLLOUT (všetko pod outLock)
+    pthread_mutex_t outLock;
+    pthread_cond_t outCond;         // výstup ubudol alebo spojenie padlo
+    char *out;
+    size_t outHead, outLen, outCap;
+    uint64_t outSent;               // odoslané spolu (postup pre časový limit)
+    bool gone;                      // spojenie zlyhalo, ďalší výstup sa zahodí
+};
+
+typedef ReactorConn Conn;
+
+struct Reactor {
+    int epfd;
+    int listenFd;
+    int wakeFd;                     // eventfd: pracovné vlákno dokončilo príkaz alebo má výstup
+    const ReactorOps *ops;
+    bool acceptPaused;              // došli deskriptory, čaká sa na zatvorenie spojenia
+
+    pthread_mutex_t lock;           // fronty úloh, hotových a výstupu
+    pthread_cond_t taskCond;
+    Conn *taskHead, *taskTail;
+    Conn *doneHead;
+    Conn *flushHead;                // výstup čaká na EPOLLOUT
+    Conn *drainHead;                // zatvorené, dobiehajú výstup (len vlákno reaktora)
+    Conn *graveyard;                // zatvorené v tejto dávke (môžu mať v nej ešte udalosť)
+};
+
+// značky v epoll_event.data.ptr pre deskriptory, ktoré nie sú spojenia
+static char LISTEN_TAG, WAKE_TAG;
+
+static __thread bool t_worker;      // vlákno skupiny (reactor_detach ho z nej môže vyradiť)
+static __thread bool t_detached;    // ... už vyradené, po príkaze skončí
+
+static void *worker_main(void *arg);
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void wake(Reactor *r) {
+    uint64_t one = 1;
+    ssize_t w = write(r->wakeFd, &one, sizeof(one));
+    (void)w;                        // pri pretečení eventfd je reaktor aj tak zobudený
+}
+
+static size_t out_pending(Conn *c) {
+    pthread_mutex_lock(&c->outLock);
+    size_t n = c->outLen;
+    pthread_mutex_unlock(&c->outLock);
+    return n;
+}
+
+static bool out_gone(Conn *c) {
+    pthread_mutex_lock(&c->outLock);
+    bool gone = c->gone;
+    pthread_mutex_unlock(&c->outLock);
+    return gone;
+}
+
+// pod outLock: spojenie padlo, výstup sa zahodí a čakajúci príkaz sa zobudí
+static void out_fail_locked(Conn *c) {
+    c->gone = true;
+    c->outLen = 0;
+    c->outHead = 0;
+    pthread_cond_broadcast(&c->outCond);
+}
+
+static void out_fail(Conn *c) {
+    pthread_mutex_lock(&c->outLock);
+    out_fail_locked(c);
+    pthread_mutex_unlock(&c->outLock);
+}
+
+// pod outLock
+static bool out_append(Conn *c, const char *data, size_t len) {
+    if (c->outHead > 0 && c->outHead + c->outLen + len > c->outCap) {
+        memmove(c->out, c->out + c->outHead, c->outLen);
+        c->outHead = 0;
+    }
+    if (c->outLen + len > c->outCap) {
+        size_t cap = c->outCap ? c->outCap : REACTOR_OUTBUF_MIN;
+        while (cap < c->outLen + len) cap *= 2;
+        char *out = (char*)realloc(c->out, cap);
+        if (!out) return false;
+        c->out = out;
+        c->outCap = cap;
+    }
+    memcpy(c->out + c->outHead + c->outLen, data, len);
+    c->outLen += len;
+    return true;
+}
+
+// reaktor má zaradiť EPOLLOUT (pracovné vlákno, bez outLock)
+static void flush_request(Conn *c) {
+    Reactor *r = c->r;
+    pthread_mutex_lock(&r->lock);
+    bool queue = !c->flushQueued;
+    if (queue) {
+        c->flushQueued = true;
+        c->flushNext = r->flushHead;
+        r->flushHead = c;
+    }
+    pthread_mutex_unlock(&r->lock);
+    if (queue) wake(r);
+}
+
+bool reactor_send(ReactorConn *c, const void *data, size_t len) {
+    const char *p = (const char*)data;
+    bool queued = false;
+    pthread_mutex_lock(&c->outLock);
+    while (len > 0 && !c->gone) {
+        // kým nič nečaká, ide sa rovno do soketu (poradie bajtov ostane)
+        if (c->outLen == 0) {
+            ssize_t n = send(c->fd, p, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0) {
+                p += n;
+                len -= (size_t)n;
+                c->outSent += (uint64_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                out_fail_locked(c);
+                break;
+            }
+        }
+        if (c->outLen < REACTOR_OUT_HIGH) {
+            size_t k = REACTOR_OUT_HIGH - c->outLen;
+            if (k > len) k = len;
+            if (!out_append(c, p, k)) {
+                out_fail_locked(c);
+                break;
+            }
+            p += k;
+            len -= k;
+            queued = true;
+            continue;
+        }
+
+        // plný buffer: čaká sa, kým klient prevezme aspoň polovicu; medzitým
+        // vlákno neblokuje skupinu, bez postupu do časového limitu spojenie padne
+        pthread_mutex_unlock(&c->outLock);
+        if (queued) flush_request(c);
+        queued = false;
+        reactor_detach(c);
+        pthread_mutex_lock(&c->outLock);
+        uint64_t seen = c->outSent;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += REACTOR_SEND_TIMEOUT_SEC;
+        while (!c->gone && c->outLen > REACTOR_OUT_HIGH / 2) {
+            if (pthread_cond_timedwait(&c->outCond, &c->outLock, &until) != ETIMEDOUT) continue;
+            if (c->outSent == seen) {
+                out_fail_locked(c);
+                break;
+            }
+            seen = c->outSent;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += REACTOR_SEND_TIMEOUT_SEC;
+        }
+    }
+    bool ok = !c->gone;
+    pthread_mutex_unlock(&c->outLock);
+    if (queued) flush_request(c);
+    // reaktor sa o páde dozvie z HUP a spojenie zavrie
+    if (!ok) shutdown(c->fd, SHUT_RDWR);
+    return ok;
+}
+
+size_t reactor_pending(ReactorConn *c) {
+    return out_pending(c);
+}
+
+bool reactor_gone(ReactorConn *c) {
+    if (out_gone(c)) return true;
+    // polovičné zatvorenie nevadí, odpovede klient ešte prevezme
+    struct pollfd pfd = {c->fd, 0, 0};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP));
+}
+
+void reactor_detach(ReactorConn *c) {
+    if (!t_worker || t_detached) return;
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, worker_main, c->r) != 0) return; // ostane v skupine
+    pthread_detach(tid);
+    t_detached = true;
+}
+
+// Udalosti spojenia podľa stavu: čítať, kým je miesto na vstup aj výstup pod
+// REACTOR_OUT_HIGH, písať, kým niečo čaká. Zatvorené spojenie len dobieha výstup.
+static void conn_watch(Reactor *r, Conn *c) {
+    size_t pending = out_pending(c);
+    uint32_t ev = 0;
+    if (!c->closed && !c->eof) {
+        ev |= EPOLLRDHUP;
+        if (c->len < REACTOR_LINE_MAX && pending < REACTOR_OUT_HIGH) ev |= EPOLLIN;
+    }
+    if (pending > 0) ev |= EPOLLOUT;
+    if (ev == c->events) return;
+    if (ev == 0) {
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        c->events = 0;
+        return;
+    }
+    struct epoll_event e = {0};
+    e.events = ev;
+    e.data.ptr = c;
+    if (epoll_ctl(r->epfd, c->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, c->fd, &e) == 0) c->events = ev;
+    else if (!c->events) out_fail(c); // bez epoll by sa o spojení nedozvedel
+}
+
+static void conn_free(Reactor *r, Conn *c) {
+    if (c->events) epoll_ctl(r->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    c->events = 0;
+    r->ops->close(c->user);
+    close(c->fd);
+    c->dead = true;
+    pthread_mutex_lock(&r->lock);
+    // výstup z open (HELLO) mohol ostať vo fronte
+    if (c->flushQueued) {
+        Conn **pp = &r->flushHead;
+        while (*pp != c) pp = &(*pp)->flushNext;
+        *pp = c->flushNext;
+        c->flushQueued = false;
+    }
+    pthread_mutex_unlock(&r->lock);
+    if (c->draining) {
+        Conn **pp = &r->drainHead;
+        while (*pp != c) pp = &(*pp)->drainNext;
+        *pp = c->drainNext;
+    }
+    c->next = r->graveyard;
+    r->graveyard = c;
+    if (r->acceptPaused) {
+        struct epoll_event ev = {0};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &LISTEN_TAG;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_MOD, r->listenFd, &ev) == 0) r->acceptPaused = false;
+    }
+}
+
+// zatvorené a voľné spojenie: uvoľní sa, keď odíde výstup (napr. OK BYE), najviac po časovom limite
+static void conn_close(Reactor *r, Conn *c) {
+    if (out_pending(c) == 0) {
+        conn_free(r, c);
+        return;
+    }
+    if (!c->draining) {
+        c->draining = true;
+        c->drainUntil = now_sec() + REACTOR_SEND_TIMEOUT_SEC;
+        c->drainNext = r->drainHead;
+        r->drainHead = c;
+    }
+    conn_watch(r, c);
+}
+
+// vyberie z buffra jeden neprázdny riadok (bez \r\n); NULL ak ešte nie je celý
+static char *take_line(Conn *c) {
+    for (;;) {
+        char *nl = memchr(c->in, '\n', c->len);
+        if (!nl) return NULL;
+        size_t n = (size_t)(nl - c->in);
+        size_t len = n;
+        while (len > 0 && c->in[len - 1] == '\r') len--;
+        char *line = NULL;
+        if (len > 0) {
+            line = (char*)malloc(len + 1);
+            if (line) {
+                memcpy(line, c->in, len);
+                line[len] = '\0';
+            }
+        }
+        memmove(c->in, nl + 1, c->len - n - 1);
+        c->len -= n + 1;
+        if (line) return line;
+    }
+}
+
+// Posunie spojenie ďalej: ďalší príkaz pracovnému vláknu, alebo zatvorenie.
+// Číta sa len vtedy, keď je v buffri miesto (inak čaká klient v TCP); kým klient
+// neprevezme výstup nad REACTOR_OUT_HIGH, ďalší príkaz sa nespustí.
+static void conn_pump(Reactor *r, Conn *c) {
+    if (c->busy) {
+        conn_watch(r, c);
+        return;
+    }
+    if (c->closed) {
+        conn_close(r, c);
+        return;
+    }
+    char *line = out_pending(c) < REACTOR_OUT_HIGH ? take_line(c) : NULL;
+    if (line) {
+        c->line = line;
+        c->busy = true;
+        pthread_mutex_lock(&r->lock);
+        c->next = NULL;
+        if (r->taskTail) r->taskTail->next = c;
+        else r->taskHead = c;
+        r->taskTail = c;
+        pthread_cond_signal(&r->taskCond);
+        pthread_mutex_unlock(&r->lock);
+        conn_watch(r, c);
+        return;
+    }
+    if (c->eof && !memchr(c->in, '\n', c->len)) {
+        c->closed = true;
+        conn_close(r, c);
+        return;
+    }
+    if (c->len >= REACTOR_LINE_MAX && !memchr(c->in, '\n', c->len)) {
+        static const char msg[] = "ERR Line too long\n";
+        reactor_send(c, msg, sizeof(msg) - 1);
+        c->closed = true;
+        conn_close(r, c);
+        return;
+    }
+    conn_watch(r, c);
+}
+
+static void conn_readable(Conn *c) {
+    while (!c->eof && c->len < REACTOR_LINE_MAX) {
+        if (c->len == c->cap) {
+            size_t cap = c->cap * 2;
+            if (cap > REACTOR_LINE_MAX) cap = REACTOR_LINE_MAX;
+            char *in = (char*)realloc(c->in, cap);
+            if (!in) {
+                c->closed = true;
+                out_fail(c);
+                break;
+            }
+            c->in = in;
+            c->cap = cap;
+        }
+        ssize_t n = recv(c->fd, c->in + c->len, c->cap - c->len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->len += (size_t)n;
+        } else if (n == 0) {
+            c->eof = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                c->closed = true;
+                out_fail(c);
+            }
+            break;
+        }
+    }
+}
+
+// odošle, koľko soket prijme; pod polovicou limitu zobudí čakajúci príkaz
+static void conn_writable(Conn *c) {
+    pthread_mutex_lock(&c->outLock);
+    while (c->outLen > 0) {
+        ssize_t n = send(c->fd, c->out + c->outHead, c->outLen, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            c->outHead += (size_t)n;
+            c->outLen -= (size_t)n;
+            c->outSent += (uint64_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) out_fail_locked(c);
+            break;
+        }
+    }
+    if (c->outLen == 0) {
+        c->outHead = 0;
+        // nečinné spojenie nedrží veľký buffer po dlhej odpovedi
+        if (c->outCap > REACTOR_OUTBUF_MIN) {
+            free(c->out);
+            c->out = NULL;
+            c->outCap = 0;
+        }
+    }
+    pthread_cond_broadcast(&c->outCond);
+    pthread_mutex_unlock(&c->outLock);
+}
+
+static void conn_event(Reactor *r, Conn *c, uint32_t events) {
+    if (events & EPOLLOUT) conn_writable(c);
+    if (events & (EPOLLIN | EPOLLRDHUP)) conn_readable(c);
+    // spojenie je preč (nie len polovičné zatvorenie): zvyšok vstupu už nemá komu odpovedať
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        c->closed = true;
+        out_fail(c);
+    }
+    if (out_gone(c)) c->closed = true;
+    conn_pump(r, c);
+}
+
+static void accept_all(Reactor *r) {
+    for (;;) {
+        int fd = accept(r->listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE) {
+                // bez voľného deskriptora by úroveňový epoll točil naprázdno
+                struct epoll_event ev = {0};
+                ev.data.ptr = &LISTEN_TAG;
+                if (epoll_ctl(r->epfd, EPOLL_CTL_MOD, r->listenFd, &ev) == 0) r->acceptPaused = true;
+                fprintf(stderr, "accept: došli deskriptory, prijímanie pozastavené\n");
+            }
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Conn *c = (Conn*)calloc(1, sizeof(Conn));
+        char *in = (char*)malloc(REACTOR_INBUF_MIN);
+        if (!c || !in) {
+            free(in);
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->r = r;
+        c->fd = fd;
+        c->in = in;
+        c->cap = REACTOR_INBUF_MIN;
+        pthread_mutex_init(&c->outLock, NULL);
+        pthread_cond_init(&c->outCond, NULL);
+        c->user = r->ops->open(c);
+        if (!c->user) {
+            pthread_mutex_destroy(&c->outLock);
+            pthread_cond_destroy(&c->outCond);
+            free(c->out);
+            free(in);
+            free(c);
+            close(fd);
+            continue;
+        }
+        conn_watch(r, c);
+        if (!c->events) conn_free(r, c);
+    }
+}
+
+static void *worker_main(void *arg) {
+    Reactor *r = (Reactor*)arg;
+    t_worker = true;
+    while (!t_detached) {
+        pthread_mutex_lock(&r->lock);
+        while (!r->taskHead) pthread_cond_wait(&r->taskCond, &r->lock);
+        Conn *c = r->taskHead;
+        r->taskHead = c->next;
+        if (!r->taskHead) r->taskTail = NULL;
+        pthread_mutex_unlock(&r->lock);
+
+        c->keep = r->ops->command(c->user, c, c->line);
+        free(c->line);
+        c->line = NULL;
+
+        pthread_mutex_lock(&r->lock);
+        c->next = r->doneHead;
+        r->doneHead = c;
+        pthread_mutex_unlock(&r->lock);
+        wake(r);
+    }
+    // za vyradené vlákno už v skupine beží náhradné
+    return NULL;
+}
+
+static void drain_done(Reactor *r) {
+    uint64_t cnt;
+    ssize_t n = read(r->wakeFd, &cnt, sizeof(cnt));
+    (void)n;
+    pthread_mutex_lock(&r->lock);
+    Conn *f = r->flushHead;
+    r->flushHead = NULL;
+    for (Conn *c = f; c; c = c->flushNext) c->flushQueued = false;
+    Conn *c = r->doneHead;
+    r->doneHead = NULL;
+    pthread_mutex_unlock(&r->lock);
+    // výstup skôr než hotové príkazy: spojenie vo fronte výstupu sa dovtedy neuvoľní
+    for (; f; f = f->flushNext) {
+        if (!f->dead) conn_watch(r, f);
+    }
+    while (c) {
+        Conn *next = c->next;
+        c->busy = false;
+        // spojenie, ktoré počas príkazu padlo, už ďalšie príkazy nevykonáva
+        if (!c->keep || out_gone(c)) c->closed = true;
+        conn_pump(r, c);
+        c = next;
+    }
+}
+
+// zatvorené spojenia, ktorých výstup klient do limitu neprevzal
+static void sweep_draining(Reactor *r) {
+    double now = now_sec();
+    Conn *c = r->drainHead;
+    while (c) {
+        Conn *next = c->drainNext;
+        if (now >= c->drainUntil) conn_free(r, c);
+        c = next;
+    }
+}
+
+bool reactor_run(int listenFd, int workers, const ReactorOps *ops) {
+    Reactor r;
+    memset(&r, 0, sizeof(r));
+    r.listenFd = listenFd;
+    r.ops = ops;
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.taskCond, NULL);
+
+    r.epfd = epoll_create1(EPOLL_CLOEXEC);
+    r.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r.epfd < 0 || r.wakeFd < 0) {
+        perror("epoll");
+        return false;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &LISTEN_TAG;
+    epoll_ctl(r.epfd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.ptr = &WAKE_TAG;
+    epoll_ctl(r.epfd, EPOLL_CTL_ADD, r.wakeFd, &ev);
+
+    if (workers < 1) workers = 1;
+    int started = 0;
+    for (int k = 0; k < workers; k++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_main, &r) != 0) break;
+        pthread_detach(tid);
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "reactor: nepodarilo sa spustiť pracovné vlákna\n");
+        return false;
+    }
+
+    struct epoll_event events[REACTOR_EVENTS];
+    for (;;) {
+        int n = epoll_wait(r.epfd, events, REACTOR_EVENTS, r.drainHead ? REACTOR_SWEEP_MS : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return false;
+        }
+        for (int k = 0; k < n; k++) {
+            void *tag = events[k].data.ptr;
+            if (tag == &LISTEN_TAG) accept_all(&r);
+            else if (tag == &WAKE_TAG) drain_done(&r);
+            else if (!((Conn*)tag)->dead) conn_event(&r, (Conn*)tag, events[k].events);
+        }
+        if (r.drainHead) sweep_draining(&r);
+        while (r.graveyard) {
+            Conn *c = r.graveyard;
+            r.graveyard = c->next;
+            pthread_mutex_destroy(&c->outLock);
+            pthread_cond_destroy(&c->outCond);
+            free(c->out);
+            free(c->in);
+            free(c);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Jedno vlákno s epoll vlastní všetky spojenia: prijíma, číta a skladá riadky
+// príkazov (aj rozdelené do viacerých recv alebo viac v jednom), hotové riadky
+// vykonáva obmedzená skupina pracovných vlákien. Príkazy jedného spojenia idú
+// postupne v poradí príchodu, rôzne spojenia súbežne.
+//
+// Spätný tlak: odpoveď ide do výstupného buffra spojenia a posiela ju reaktor, keď je
+// soket zapisovateľný (EPOLLOUT). Kým je v buffri viac než REACTOR_OUT_HIGH, zo
+// spojenia sa nečíta a ďalší jeho príkaz sa nespustí; príkaz, ktorý by buffer prepísal,
+// čaká na klienta. Príkaz, ktorý čaká dlho (pomalý čitateľ, WATCH, beh s wait=1),
+// prenechá svoje miesto v skupine novému vláknu (reactor_detach), takže skupina
+// ostáva voľná pre ostatné spojenia a počet vlákien nezávisí od počtu spojení.
+
+#define REACTOR_LINE_MAX (64 * 1024)     // najdlhší riadok príkazu
+#define REACTOR_OUT_HIGH (1024 * 1024)   // výstupný buffer, nad ktorým spojenie čaká na klienta
+#define REACTOR_SEND_TIMEOUT_SEC 30      // odpoveď, ktorú klient dovtedy neprevezme, zruší spojenie
+
+typedef struct ReactorConn ReactorConn;
+
+typedef struct ReactorOps {
+    // nové spojenie (vlákno reaktora); vráti dáta spojenia, NULL = odmietnuť
+    void *(*open)(ReactorConn *conn);
+    // jeden príkaz bez konca riadku (pracovné vlákno); false = zavrieť spojenie
+    bool (*command)(void *user, ReactorConn *conn, char *line);
+    // spojenie sa zatvára, žiadny príkaz už nebeží (vlákno reaktora)
+    void (*close)(void *user);
+} ReactorOps;
+
+// beží, kým nezlyhá epoll; workers = počet pracovných vlákien (>= 1)
+bool reactor_run(int listenFd, int workers, const ReactorOps *ops);
+
+// Pridá bajty odpovede do výstupu spojenia (prázdny buffer skúsi poslať hneď). Nad
+// REACTOR_OUT_HIGH čaká, kým ich klient neprevezme; ak do REACTOR_SEND_TIMEOUT_SEC nič
+// neprevezme alebo spojenie padne, vráti false a spojenie sa zavrie (zvyšok by rozbil
+// protokol). Z vlákna reaktora (open) len krátke správy.
+bool reactor_send(ReactorConn *conn, const void *data, size_t len);
+// koľko bajtov odpovede ešte čaká na odoslanie
+size_t reactor_pending(ReactorConn *conn);
+// klient odišiel alebo spojenie zlyhalo (polovičné zatvorenie nie)
+bool reactor_gone(ReactorConn *conn);
+// Príkaz bude čakať dlho: pracovné vlákno opustí skupinu a spustí sa za neho nové;
+// po príkaze skončí. Viackrát za príkaz nevadí.
+void reactor_detach(ReactorConn *conn);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro256** (Blackman, Vigna) - rýchly 64-bitový generátor bez globálneho stavu.
+// Každá prechádzka má vlastný prúd odvodený z (seed, replikácia, bunka), takže
+// výsledok nezávisí od počtu vlákien ani od poradia, v akom sa bunky spracujú.
+typedef struct Rng {
+    uint64_t s[4];
+} Rng;
+
+static inline uint64_t rng_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline void rng_seed(Rng *g, uint64_t seed) {
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++) g->s[i] = rng_splitmix64(&x);
+}
+
+// nezávislý prúd pre jednu prechádzku: kľúč (seed, rep, cell) sa premieša cez splitmix64
+static inline void rng_seed_walk(Rng *g, uint64_t seed, uint64_t rep, uint64_t cell) {
+    uint64_t x = seed;
+    uint64_t k = rng_splitmix64(&x);
+    x = k ^ rep;
+    k = rng_splitmix64(&x);
+    rng_seed(g, k ^ cell);
+}
+
+static inline uint64_t rng_next(Rng *g) {
+    uint64_t *s = g->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+// rovnomerne v [0,1) s 53-bitovou presnosťou
+static inline double rng_uniform(Rng *g) {
+    return (double)(rng_next(g) >> 11) * 0x1.0p-53;
+}
+
+#endif
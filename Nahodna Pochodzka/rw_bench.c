@@ -0,0 +1,322 @@
+// rw_bench.c - výkon simulačného jadra cez maticu svetov (veľkosť, hustota prekážok,
+// drift MoveProbs, K): prechádzky/s, kroky/s, ns/krok, uloženie/načítanie stavu a
+// špičková pamäť ako JSON; s compare= porovná s uloženým výsledkom a označí zhoršenia
+//
+//   rw_bench [sizes=33,65,97] [density=0,0.2,0.4] [K=50,500] [threads=0] [time=0.5]
+//            [maxsteps=0] [seed=1] [state=rw_bench.dwalk] [out=vysledok.json]
+//            [compare=zaklad.json] [tol=0.10]
+//
+// JSON ide na stdout (alebo do out=), priebeh a porovnanie na stderr. Návratová
+// hodnota je 1, ak porovnanie našlo zhoršenie o viac než tol (relatívne).
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "walk.h"
+
+#define BENCH_MAX_VALUES 16         // najviac hodnôt v jednom zozname (sizes=...)
+#define BENCH_NAME_MAX 64
+
+typedef struct BenchDrift {
+    const char *name;
+    double p[4];                    // U, D, L, R
+} BenchDrift;
+
+static const BenchDrift DRIFTS[] = {
+    {"uniform", {0.25, 0.25, 0.25, 0.25}},
+    {"drift", {0.30, 0.20, 0.25, 0.25}},
+};
+
+typedef struct BenchCase {
+    char name[BENCH_NAME_MAX];
+    int size;
+    double density;
+    const BenchDrift *drift;
+    int K;
+    // výsledky
+    const char *kernel;
+    int reps;
+    double walksPerSec, stepsPerSec, nsPerStep;
+    double stateMB, saveMBs, loadMBs;
+    double peakRssMB;
+    bool ok;
+} BenchCase;
+
+// metrika pre porovnanie: higher = väčšia hodnota je lepšia, slack = absolútna zmena,
+// ktorá sa ešte neráta (RSS malých svetov kolíše o stovky kB podľa alokátora)
+typedef struct BenchMetric {
+    const char *key;
+    size_t offset;
+    bool higher;
+    double slack;
+} BenchMetric;
+
+static const BenchMetric METRICS[] = {
+    {"walks_per_sec", offsetof(BenchCase, walksPerSec), true, 0.0},
+    {"steps_per_sec", offsetof(BenchCase, stepsPerSec), true, 0.0},
+    {"ns_per_step", offsetof(BenchCase, nsPerStep), false, 0.0},
+    {"save_mb_per_sec", offsetof(BenchCase, saveMBs), true, 0.0},
+    {"load_mb_per_sec", offsetof(BenchCase, loadMBs), true, 0.0},
+    {"peak_rss_mb", offsetof(BenchCase, peakRssMB), false, 1.0},
+};
+#define METRIC_COUNT (sizeof(METRICS) / sizeof(METRICS[0]))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// hodnota argumentu key=... alebo NULL
+static const char *arg_get(int argc, char *argv[], const char *key) {
+    size_t klen = strlen(key);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], key, klen) == 0 && argv[i][klen] == '=') return argv[i] + klen + 1;
+    }
+    return NULL;
+}
+
+// zoznam čísel oddelených čiarkou; vráti počet
+static int parse_list(const char *s, double *out, int max) {
+    int n = 0;
+    while (s && *s && n < max) {
+        char *end;
+        out[n] = strtod(s, &end);
+        if (end == s) break;
+        n++;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+static double peak_rss_mb(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+    return (double)ru.ru_maxrss / 1024.0; // Linux: kB
+}
+
+static double file_mb(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (double)st.st_size / (1024.0 * 1024.0) : 0.0;
+}
+
+static uint64_t sum_array(const uint64_t *a, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += a[i];
+    return sum;
+}
+
+// jeden svet: replikácie po dávkach (1, 2, 4, ...), kým beh netrvá aspoň minTime
+static void run_case(BenchCase *bc, int threads, double minTime, uint32_t maxSteps, uint64_t seed, const char *statePath) {
+    Sim s;
+    bool obstacles = bc->density > 0.0;
+    if (!(obstacles ? sim_init_alloc(&s, bc->size, bc->size, true) : sim_init_empty(&s, bc->size, bc->size, false))) return;
+    s.Threads = threads;
+    s.K = bc->K;
+    s.MaxSteps = maxSteps;
+    s.Seed = seed;
+    memcpy(s.MoveProbs, bc->drift->p, sizeof(s.MoveProbs));
+    if (obstacles && !sim_generate_obstacles_connected(&s, bc->density, seed)) {
+        sim_free(&s);
+        return;
+    }
+    bc->kernel = walk_kernel_name(walk_kernel_pick(s.Kernel, s.Tiles * 64));
+
+    double elapsed = 0.0;
+    int batch = 1;
+    bool ok = true;
+    while (ok && elapsed < minTime) {
+        double t0 = now_sec();
+        ok = sim_run(&s, batch, seed);
+        elapsed += now_sec() - t0;
+        bc->reps += batch;
+        batch *= 2;
+    }
+    if (!ok || elapsed <= 0.0) {
+        sim_free(&s);
+        return;
+    }
+    uint64_t walks = 0;
+    uint64_t cens = sim_censored_total(&s, &walks);
+    // utnutá prechádzka urobila cap krokov, do steps_sum sa nepočíta
+    uint64_t steps = sum_array(s.steps_sum, s.FreeCells) + cens * (uint64_t)(maxSteps ? maxSteps : 0);
+    bc->walksPerSec = (double)walks / elapsed;
+    bc->stepsPerSec = (double)steps / elapsed;
+    bc->nsPerStep = steps ? elapsed * 1e9 / (double)steps : 0.0;
+
+    s.StateFormat = SIM_STATE_DWALK2;
+    double t0 = now_sec();
+    bool saved = sim_save_state(&s, statePath);
+    double tSave = now_sec() - t0;
+    bc->stateMB = file_mb(statePath);
+    Sim loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    t0 = now_sec();
+    bool loadedOk = saved && sim_load_state(&loaded, statePath);
+    double tLoad = now_sec() - t0;
+    sim_free(&loaded);
+    unlink(statePath);
+    if (saved && tSave > 0.0) bc->saveMBs = bc->stateMB / tSave;
+    if (loadedOk && tLoad > 0.0) bc->loadMBs = bc->stateMB / tLoad;
+
+    bc->peakRssMB = peak_rss_mb();
+    bc->ok = saved && loadedOk;
+    sim_free(&s);
+}
+
+static void write_json(FILE *f, const BenchCase *cases, int count, int threads, double minTime, uint32_t maxSteps) {
+    fprintf(f, "{\n  \"bench\": \"rw_bench\",\n  \"version\": 1,\n");
+    fprintf(f, "  \"threads\": %d,\n  \"min_time\": %.3f,\n  \"maxsteps\": %u,\n  \"cases\": [\n",
+            threads, minTime, maxSteps);
+    for (int k = 0; k < count; k++) {
+        const BenchCase *bc = &cases[k];
+        fprintf(f, "    {\"name\": \"%s\", \"size\": %d, \"density\": %.3f, \"drift\": \"%s\", "
+                   "\"probs\": [%.4f, %.4f, %.4f, %.4f], \"K\": %d, \"ok\": %s, \"kernel\": \"%s\", \"reps\": %d,\n",
+                bc->name, bc->size, bc->density, bc->drift->name,
+                bc->drift->p[0], bc->drift->p[1], bc->drift->p[2], bc->drift->p[3],
+                bc->K, bc->ok ? "true" : "false", bc->kernel ? bc->kernel : "", bc->reps);
+        fprintf(f, "     \"walks_per_sec\": %.6g, \"steps_per_sec\": %.6g, \"ns_per_step\": %.4f, "
+                   "\"state_mb\": %.3f, \"save_mb_per_sec\": %.6g, \"load_mb_per_sec\": %.6g, \"peak_rss_mb\": %.1f}%s\n",
+                bc->walksPerSec, bc->stepsPerSec, bc->nsPerStep,
+                bc->stateMB, bc->saveMBs, bc->loadMBs, bc->peakRssMB, k + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = len >= 0 ? (char*)malloc((size_t)len + 1) : NULL;
+    if (buf) {
+        size_t got = fread(buf, 1, (size_t)len, f);
+        buf[got] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+// číslo kľúča "key" v objekte [obj, end) zo súboru, ktorý zapísal write_json
+static bool json_number(const char *obj, const char *end, const char *key, double *out) {
+    char pat[BENCH_NAME_MAX];
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    const char *p = strstr(obj, pat);
+    if (!p || p >= end) return false;
+    *out = strtod(p + strlen(pat), NULL);
+    return true;
+}
+
+// porovná prípady so základom; vráti počet zhoršení (-1 = základ sa nedá načítať)
+static int compare(const BenchCase *cases, int count, const char *path, double tol) {
+    char *base = read_file(path);
+    if (!base) return -1;
+    int regressions = 0;
+    fprintf(stderr, "\nporovnanie so %s (tolerancia %.0f %%)\n", path, tol * 100.0);
+    for (int k = 0; k < count; k++) {
+        const BenchCase *bc = &cases[k];
+        char pat[BENCH_NAME_MAX + 16];
+        snprintf(pat, sizeof(pat), "\"name\": \"%s\"", bc->name);
+        const char *obj = strstr(base, pat);
+        if (!obj) {
+            fprintf(stderr, "  %-28s v zaklade chyba\n", bc->name);
+            continue;
+        }
+        const char *end = strchr(obj, '}');
+        if (!end) end = obj + strlen(obj);
+        for (size_t m = 0; m < METRIC_COUNT; m++) {
+            double old;
+            if (!json_number(obj, end, METRICS[m].key, &old) || old <= 0.0) continue;
+            double cur = *(const double*)((const char*)bc + METRICS[m].offset);
+            double change = (cur - old) / old;
+            bool worse = (METRICS[m].higher ? change < -tol : change > tol) && fabs(cur - old) > METRICS[m].slack;
+            if (!worse && fabs(change) <= tol) continue; // vypíšu sa len zmeny nad toleranciu
+            fprintf(stderr, "  %-28s %-16s %12.4g -> %12.4g  %+6.1f %%%s\n", bc->name, METRICS[m].key,
+                    old, cur, change * 100.0, worse ? "  ZHORSENIE" : "");
+            regressions += worse;
+        }
+    }
+    free(base);
+    return regressions;
+}
+
+int main(int argc, char *argv[]) {
+    double sizes[BENCH_MAX_VALUES] = {33, 65, 97};
+    double dens[BENCH_MAX_VALUES] = {0.0, 0.2, 0.4};
+    double Ks[BENCH_MAX_VALUES] = {50, 500};
+    int nSizes = 3, nDens = 3, nK = 2;
+    const char *v;
+    if ((v = arg_get(argc, argv, "sizes"))) nSizes = parse_list(v, sizes, BENCH_MAX_VALUES);
+    if ((v = arg_get(argc, argv, "density"))) nDens = parse_list(v, dens, BENCH_MAX_VALUES);
+    if ((v = arg_get(argc, argv, "K"))) nK = parse_list(v, Ks, BENCH_MAX_VALUES);
+    int threads = (v = arg_get(argc, argv, "threads")) ? atoi(v) : 0;
+    double minTime = (v = arg_get(argc, argv, "time")) ? atof(v) : 0.5;
+    uint32_t maxSteps = (v = arg_get(argc, argv, "maxsteps")) ? (uint32_t)strtoul(v, NULL, 10) : 0;
+    uint64_t seed = (v = arg_get(argc, argv, "seed")) ? strtoull(v, NULL, 10) : 1;
+    const char *statePath = (v = arg_get(argc, argv, "state")) ? v : "rw_bench.dwalk";
+    const char *outPath = arg_get(argc, argv, "out");
+    const char *basePath = arg_get(argc, argv, "compare");
+    double tol = (v = arg_get(argc, argv, "tol")) ? atof(v) : 0.10;
+    if (nSizes <= 0 || nDens <= 0 || nK <= 0 || minTime < 0.0 || seed == 0) {
+        fprintf(stderr, "pouzitie: %s [sizes=33,65,97] [density=0,0.2,0.4] [K=50,500] [threads=0] [time=0.5]\n"
+                        "          [maxsteps=0] [seed=1] [state=rw_bench.dwalk] [out=subor.json] [compare=zaklad.json] [tol=0.10]\n",
+                argv[0]);
+        return 1;
+    }
+
+    int total = nSizes * nDens * (int)(sizeof(DRIFTS) / sizeof(DRIFTS[0])) * nK;
+    BenchCase *cases = (BenchCase*)calloc((size_t)total, sizeof(BenchCase));
+    if (!cases) return 1;
+    int count = 0;
+    // od najmenšieho sveta: peak_rss_mb je špička procesu dovtedy
+    for (int a = 0; a < nSizes; a++)
+        for (int b = 0; b < nDens; b++)
+            for (size_t d = 0; d < sizeof(DRIFTS) / sizeof(DRIFTS[0]); d++)
+                for (int k = 0; k < nK; k++) {
+                    BenchCase *bc = &cases[count++];
+                    bc->size = (int)sizes[a];
+                    bc->density = dens[b];
+                    bc->drift = &DRIFTS[d];
+                    bc->K = (int)Ks[k];
+                    snprintf(bc->name, sizeof(bc->name), "%dx%d_d%.2f_%s_K%d",
+                             bc->size, bc->size, bc->density, bc->drift->name, bc->K);
+                    run_case(bc, threads, minTime, maxSteps, seed, statePath);
+                    fprintf(stderr, "%-28s %-7s reps=%-5d %10.0f walks/s %8.1f Msteps/s %6.2f ns/step  save %7.1f MB/s  load %7.1f MB/s  rss %.0f MB%s\n",
+                            bc->name, bc->kernel ? bc->kernel : "-", bc->reps, bc->walksPerSec, bc->stepsPerSec * 1e-6,
+                            bc->nsPerStep, bc->saveMBs, bc->loadMBs, bc->peakRssMB, bc->ok ? "" : "  CHYBA");
+                }
+
+    FILE *out = stdout;
+    if (outPath && !(out = fopen(outPath, "w"))) {
+        fprintf(stderr, "nejde zapisat %s\n", outPath);
+        free(cases);
+        return 1;
+    }
+    write_json(out, cases, count, threads, minTime, maxSteps);
+    if (out != stdout) fclose(out);
+
+    int rc = 0;
+    for (int k = 0; k < count; k++) if (!cases[k].ok) rc = 1;
+    if (basePath) {
+        int regressions = compare(cases, count, basePath, tol);
+        if (regressions < 0) {
+            fprintf(stderr, "nejde nacitat %s\n", basePath);
+            rc = 1;
+        } else {
+            fprintf(stderr, "zhorsenia: %d\n", regressions);
+            if (regressions > 0) rc = 1;
+        }
+    }
+    free(cases);
+    return rc;
+}
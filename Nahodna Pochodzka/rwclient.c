@@ -0,0 +1,532 @@
+// rwclient.c - klientská knižnica protokolu (bufferované čítanie, pipelining)
+#include "rwclient.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+#include "socket.h"
+
+#define RWC_IN_MIN (64 * 1024)
+
+// GET_SUMMARY_BIN: rámce [u32 typ][u32 veľkosť prvku][u64 dĺžka] + surové pole (ako na serveri)
+typedef struct SummaryFrame {
+    uint32_t type;
+    uint32_t elemSize;
+    uint64_t length;
+} SummaryFrame;
+
+// --- buffre ---
+
+// miesto aspoň pre need ďalších bajtov za inLen (neprečítané sa posunú na začiatok)
+static bool in_reserve(RwClient *c, size_t need) {
+    if (c->inPos > 0) {
+        memmove(c->in, c->in + c->inPos, c->inLen - c->inPos);
+        c->inLen -= c->inPos;
+        c->inPos = 0;
+    }
+    if (c->inCap - c->inLen >= need) return true;
+    size_t cap = c->inCap ? c->inCap : RWC_IN_MIN;
+    while (cap - c->inLen < need) cap *= 2;
+    char *in = (char*)realloc(c->in, cap);
+    if (!in) return false;
+    c->in = in;
+    c->inCap = cap;
+    return true;
+}
+
+// prijme, čo je k dispozícii (block = čakať aspoň na niečo); false pri konci/chybe spojenia
+static bool in_recv(RwClient *c, bool block) {
+    if (!in_reserve(c, RWC_IN_MIN / 4)) return false;
+    for (;;) {
+        ssize_t n = recv(c->fd, c->in + c->inLen, c->inCap - c->inLen, block ? 0 : MSG_DONTWAIT);
+        if (n > 0) {
+            c->inLen += (size_t)n;
+            c->bytesIn += (uint64_t)n;
+            return true;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        return n < 0 && !block && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+bool rwc_flush(RwClient *c) {
+    size_t sent = 0;
+    while (sent < c->outLen) {
+        // kým server nestíha čítať, preberajú sa jeho odpovede (inak by obaja čakali)
+        struct pollfd pfd = {c->fd, POLLIN | POLLOUT, 0};
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if ((pfd.revents & POLLIN) && !in_recv(c, false)) return false;
+        if (pfd.revents & POLLOUT) {
+            ssize_t n = send(c->fd, c->out + sent, c->outLen - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) sent += (size_t)n;
+            else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+        } else if (pfd.revents & (POLLERR | POLLHUP)) {
+            return false;
+        }
+    }
+    c->outLen = 0;
+    return true;
+}
+
+// celý riadok v buffri (bez \n a \r); ukazovateľ platí do ďalšieho čítania
+static bool raw_line(RwClient *c, char **line, size_t *len) {
+    if (c->outLen && !rwc_flush(c)) return false;
+    size_t scanned = 0;
+    for (;;) {
+        char *start = c->in + c->inPos;
+        size_t avail = c->inLen - c->inPos;
+        char *nl = avail > scanned ? (char*)memchr(start + scanned, '\n', avail - scanned) : NULL;
+        if (nl) {
+            size_t n = (size_t)(nl - start);
+            c->inPos += n + 1;
+            while (n > 0 && start[n - 1] == '\r') n--;
+            start[n] = '\0';
+            *line = start;
+            *len = n;
+            return true;
+        }
+        scanned = avail;
+        if (!in_recv(c, true)) return false;
+    }
+}
+
+static bool read_line(RwClient *c, char *buf, size_t bufLen) {
+    char *line;
+    size_t n;
+    if (!raw_line(c, &line, &n)) return false;
+    if (n >= bufLen) n = bufLen - 1;
+    memcpy(buf, line, n);
+    buf[n] = '\0';
+    return true;
+}
+
+// presne len bajtov; veľké zvyšky idú rovno do cieľa bez kopírovania cez buffer
+static bool read_exact(RwClient *c, void *dst, size_t len) {
+    if (c->outLen && !rwc_flush(c)) return false;
+    uint8_t *p = (uint8_t*)dst;
+    size_t have = c->inLen - c->inPos;
+    size_t take = have < len ? have : len;
+    memcpy(p, c->in + c->inPos, take);
+    c->inPos += take;
+    p += take;
+    len -= take;
+    while (len >= RWC_IN_MIN) {
+        ssize_t n = recv(c->fd, p, len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        c->bytesIn += (uint64_t)n;
+        p += n;
+        len -= (size_t)n;
+    }
+    while (len > 0) {
+        if (c->inPos == c->inLen && !in_recv(c, true)) return false;
+        take = c->inLen - c->inPos;
+        if (take > len) take = len;
+        memcpy(p, c->in + c->inPos, take);
+        c->inPos += take;
+        p += take;
+        len -= take;
+    }
+    return true;
+}
+
+static bool codec_client_source(void *ctx, void *data, size_t len) {
+    return read_exact((RwClient*)ctx, data, len);
+}
+
+// --- spojenie ---
+
+bool rwc_connect(RwClient *c, const char *host, int port) {
+    memset(c, 0, sizeof(*c));
+    c->fd = connect_to_server(host, port);
+    if (c->fd < 0) return false;
+    if (!read_line(c, c->hello, sizeof(c->hello))) {
+        rwc_close(c);
+        return false;
+    }
+    return true;
+}
+
+void rwc_close(RwClient *c) {
+    if (c->fd >= 0) active_socket_destroy(c->fd);
+    c->fd = -1;
+    free(c->in);
+    free(c->out);
+    c->in = c->out = NULL;
+    c->inPos = c->inLen = c->inCap = c->outLen = c->outCap = 0;
+}
+
+// --- požiadavky ---
+
+bool rwc_send(RwClient *c, const char *line) {
+    size_t len = strlen(line);
+    if (c->outCap - c->outLen < len + 1) {
+        size_t cap = c->outCap ? c->outCap : 4096;
+        while (cap - c->outLen < len + 1) cap *= 2;
+        char *out = (char*)realloc(c->out, cap);
+        if (!out) return false;
+        c->out = out;
+        c->outCap = cap;
+    }
+    memcpy(c->out + c->outLen, line, len);
+    c->out[c->outLen + len] = '\n';
+    c->outLen += len + 1;
+    c->pending++;
+    return true;
+}
+
+static const char *opt_or_empty(const char *opts) {
+    return opts ? opts : "";
+}
+
+bool rwc_new_sim(RwClient *c, const RwNewSim *p) {
+    char cmd[RWC_LINE_MAX];
+    int n = snprintf(cmd, sizeof(cmd), "NEW_SIM %d %d %d %.17g %.17g %.17g %.17g %d %d %s %s",
+                     p->H, p->W, p->obstacles ? 1 : 0,
+                     p->moveProbs[0], p->moveProbs[1], p->moveProbs[2], p->moveProbs[3],
+                     p->K, p->reps, p->resultFile, opt_or_empty(p->opts));
+    return n > 0 && (size_t)n < sizeof(cmd) && rwc_send(c, cmd);
+}
+
+bool rwc_resume_sim(RwClient *c, const char *inFile, int reps, const char *outFile, const char *opts) {
+    char cmd[RWC_LINE_MAX];
+    int n = snprintf(cmd, sizeof(cmd), "RESUME_SIM %s %d %s %s", inFile, reps, outFile, opt_or_empty(opts));
+    return n > 0 && (size_t)n < sizeof(cmd) && rwc_send(c, cmd);
+}
+
+bool rwc_run_more(RwClient *c, int reps, const char *opts) {
+    char cmd[RWC_LINE_MAX];
+    int n = snprintf(cmd, sizeof(cmd), "RUN_MORE %d %s", reps, opt_or_empty(opts));
+    return n > 0 && (size_t)n < sizeof(cmd) && rwc_send(c, cmd);
+}
+
+bool rwc_run_until(RwClient *c, double precision, const char *opts) {
+    char cmd[RWC_LINE_MAX];
+    int n = snprintf(cmd, sizeof(cmd), "RUN_UNTIL precision=%.17g %s", precision, opt_or_empty(opts));
+    return n > 0 && (size_t)n < sizeof(cmd) && rwc_send(c, cmd);
+}
+
+bool rwc_set_mode(RwClient *c, int mode) {
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "SET_MODE %d", mode);
+    return rwc_send(c, cmd);
+}
+
+bool rwc_get_summary_avg(RwClient *c) { return rwc_send(c, "GET_SUMMARY_AVG"); }
+bool rwc_get_summary_prob(RwClient *c) { return rwc_send(c, "GET_SUMMARY_PROB"); }
+bool rwc_get_summary_bin(RwClient *c, bool f32) { return rwc_send(c, f32 ? "GET_SUMMARY_BIN f32" : "GET_SUMMARY_BIN"); }
+bool rwc_get_summary_z(RwClient *c) { return rwc_send(c, "GET_SUMMARY_Z"); }
+bool rwc_job_status(RwClient *c) { return rwc_send(c, "JOB_STATUS"); }
+bool rwc_cancel(RwClient *c) { return rwc_send(c, "CANCEL"); }
+bool rwc_end_sim(RwClient *c) { return rwc_send(c, "END_SIM"); }
+bool rwc_open(RwClient *c) { return rwc_send(c, "OPEN"); }
+bool rwc_stats(RwClient *c) { return rwc_send(c, "STATS"); }
+bool rwc_export_state(RwClient *c) { return rwc_send(c, "EXPORT_STATE"); }
+bool rwc_quit(RwClient *c) { return rwc_send(c, "QUIT"); }
+
+bool rwc_attach(RwClient *c, int session) {
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "ATTACH %d", session);
+    return rwc_send(c, cmd);
+}
+
+bool rwc_watch(RwClient *c, int frames) {
+    char cmd[32];
+    if (frames > 0) snprintf(cmd, sizeof(cmd), "WATCH frames=%d", frames);
+    else snprintf(cmd, sizeof(cmd), "WATCH");
+    return rwc_send(c, cmd);
+}
+
+bool rwc_merge_state(RwClient *c, const char *host, int port, int session) {
+    char cmd[RWC_LINE_MAX];
+    if (session > 0) snprintf(cmd, sizeof(cmd), "MERGE_STATE %s %d session=%d", host, port, session);
+    else snprintf(cmd, sizeof(cmd), "MERGE_STATE %s %d", host, port);
+    return rwc_send(c, cmd);
+}
+
+bool rwc_close_session(RwClient *c, int session) {
+    char cmd[32];
+    if (session > 0) snprintf(cmd, sizeof(cmd), "CLOSE %d", session);
+    else snprintf(cmd, sizeof(cmd), "CLOSE");
+    return rwc_send(c, cmd);
+}
+
+// --- odpovede ---
+
+// prečítaný stavový riadok uzatvára odpoveď
+static void reply_done(RwClient *c, RwReply *r) {
+    if (c->pending > 0) c->pending--;
+    r->ok = strncmp(r->line, "OK", 2) == 0 && (r->line[2] == ' ' || r->line[2] == '\0');
+}
+
+bool rwc_reply(RwClient *c, RwReply *r) {
+    r->ok = false;
+    r->line[0] = '\0';
+    if (!read_line(c, r->line, sizeof(r->line))) return false;
+    reply_done(c, r);
+    return true;
+}
+
+int rwc_read_frame(RwClient *c, RwFrame *f, RwReply *r) {
+    r->ok = false;
+    r->line[0] = '\0';
+    if (!read_line(c, r->line, sizeof(r->line))) return -1;
+    if (strncmp(r->line, "FRAME ", 6) != 0) {
+        reply_done(c, r);
+        return 0;
+    }
+    unsigned long long seq, rep;
+    int hit;
+    size_t bytes;
+    if (sscanf(r->line, "FRAME Seq=%llu Rep=%llu From=%d,%d To=%d,%d Steps=%u Moves=%u Hit=%d Bytes=%zu",
+               &seq, &rep, &f->fromRow, &f->fromCol, &f->toRow, &f->toCol,
+               &f->steps, &f->moves, &hit, &bytes) != 10) return -1;
+    if (f->moves > RWC_FRAME_MOVES_MAX || bytes != ((size_t)f->moves + 3) / 4) return -1;
+    f->seq = seq;
+    f->rep = rep;
+    f->hit = hit != 0;
+    return read_exact(c, f->code, bytes) ? 1 : -1;
+}
+
+long long rwc_reply_int(const RwReply *r, const char *key, long long def) {
+    size_t klen = strlen(key);
+    for (const char *p = strstr(r->line, key); p; p = strstr(p + 1, key)) {
+        if ((p == r->line || p[-1] == ' ') && p[klen] == '=') return strtoll(p + klen + 1, NULL, 10);
+    }
+    return def;
+}
+
+bool rwc_read_job_status(RwClient *c, RwJobStatus *st, RwReply *r) {
+    memset(st, 0, sizeof(*st));
+    if (!rwc_reply(c, r)) return false;
+    if (!r->ok) return true;
+    if (sscanf(r->line, "OK JOB_STATUS Job=%d State=%15s ActRep=%d Target=%d RepsPerSec=%lf StepsPerSec=%lf ETA=%lf Elapsed=%lf",
+               &st->job, st->state, &st->actRep, &st->target, &st->repsPerSec, &st->stepsPerSec,
+               &st->eta, &st->elapsed) < 2) {
+        st->job = 0;
+        sscanf(r->line, "OK JOB_STATUS State=%15s", st->state);
+    }
+    return true;
+}
+
+bool rwc_read_stats(RwClient *c, RwReply *r, char *text, size_t textLen) {
+    if (textLen) text[0] = '\0';
+    if (!rwc_reply(c, r)) return false;
+    if (!r->ok) return true;
+    long long lines = rwc_reply_int(r, "Lines", 0);
+    size_t pos = 0;
+    for (long long k = 0; k < lines; k++) {
+        char *line;
+        size_t n;
+        if (!raw_line(c, &line, &n)) return false;
+        if (pos + n + 2 > textLen) continue;
+        memcpy(text + pos, line, n);
+        pos += n;
+        text[pos++] = '\n';
+        text[pos] = '\0';
+    }
+    return true;
+}
+
+void rwc_state_free(RwState *st) {
+    free(st->obstacle);
+    free(st->steps);
+    free(st->m2);
+    memset(st, 0, sizeof(*st));
+}
+
+bool rwc_read_state(RwClient *c, RwState *st, RwReply *r) {
+    memset(st, 0, sizeof(*st));
+    if (!rwc_reply(c, r)) return false;
+    if (!r->ok) return true;
+    st->H = (int)rwc_reply_int(r, "H", 0);
+    st->W = (int)rwc_reply_int(r, "W", 0);
+    st->K = (int)rwc_reply_int(r, "K", 0);
+    const char *seed = strstr(r->line, " Seed=");
+    st->seed = seed ? strtoull(seed + 6, NULL, 10) : 0;
+    st->rep0 = (int)rwc_reply_int(r, "Rep0", 0);
+    st->actRep = (int)rwc_reply_int(r, "ActRep", 0);
+    st->maxSteps = (uint32_t)rwc_reply_int(r, "MaxSteps", 0);
+    st->probOnly = rwc_reply_int(r, "ProbOnly", 0) != 0;
+    st->worldType = rwc_reply_int(r, "WorldType", 0) != 0;
+    st->varValid = rwc_reply_int(r, "VarValid", 0) != 0;
+    st->estimator = (int)rwc_reply_int(r, "Estimator", 0);
+    const char *probs = strstr(r->line, " Probs=");
+    if (st->H <= 0 || st->W <= 0 || !probs ||
+        sscanf(probs, " Probs=%lf,%lf,%lf,%lf", &st->moveProbs[0], &st->moveProbs[1],
+               &st->moveProbs[2], &st->moveProbs[3]) != 4) return false;
+
+    size_t n = (size_t)st->H * (size_t)st->W;
+    st->obstacle = (bool*)malloc(n * sizeof(bool));
+    st->steps = (uint64_t*)malloc(4 * n * sizeof(uint64_t));
+    if (st->varValid) st->m2 = (double*)malloc(n * sizeof(double));
+    bool ok = st->obstacle && st->steps && (!st->varValid || st->m2);
+    if (ok) {
+        st->hits = st->steps + n;
+        st->samples = st->steps + 2 * n;
+        st->censored = st->steps + 3 * n;
+        CodecReader cr;
+        ok = codec_reader_init(&cr, codec_client_source, c);
+        if (ok) {
+            codec_get_bits(&cr, st->obstacle, n);
+            codec_get_rows(&cr, st->steps, st->H, st->W);
+            codec_get_rows(&cr, st->hits, st->H, st->W);
+            codec_get_rows(&cr, st->samples, st->H, st->W);
+            codec_get_rows(&cr, st->censored, st->H, st->W);
+            // m2 ako bity double, bez straty
+            uint64_t *bits = st->m2 ? (uint64_t*)malloc(n * sizeof(uint64_t)) : NULL;
+            if (bits) {
+                codec_get_rows(&cr, bits, st->H, st->W);
+                memcpy(st->m2, bits, n * sizeof(double));
+                free(bits);
+            } else if (st->m2) {
+                ok = false;
+            }
+            ok = codec_reader_finish(&cr) && ok;
+        }
+    }
+    if (!ok) rwc_state_free(st);
+    return ok;
+}
+
+void rwc_summary_free(RwSummary *s) {
+    free(s->obstacle);
+    free(s->avg);
+    free(s->prob);
+    memset(s, 0, sizeof(*s));
+}
+
+static bool summary_alloc(RwSummary *s, bool avg, bool prob) {
+    size_t n = (size_t)s->H * (size_t)s->W;
+    s->obstacle = (uint8_t*)calloc(n, 1);
+    if (avg) s->avg = (double*)malloc(n * sizeof(double));
+    if (prob) s->prob = (double*)malloc(n * sizeof(double));
+    return s->obstacle && (!avg || s->avg) && (!prob || s->prob);
+}
+
+// textová mriežka: H riadkov, "X" = prekážka, inak číslo
+static bool summary_text(RwClient *c, RwSummary *s, double *val) {
+    for (int r = 0; r < s->H; r++) {
+        char *line;
+        size_t len;
+        if (!raw_line(c, &line, &len)) return false;
+        char *p = line;
+        for (int col = 0; col < s->W; col++) {
+            size_t i = (size_t)r * (size_t)s->W + (size_t)col;
+            while (*p == ' ') p++;
+            if (*p == 'X') {
+                s->obstacle[i] = 1;
+                val[i] = 0.0;
+                p++;
+                continue;
+            }
+            char *end;
+            val[i] = strtod(p, &end);
+            if (end == p) return false;
+            p = end;
+        }
+    }
+    return true;
+}
+
+static bool summary_bin(RwClient *c, RwSummary *s) {
+    size_t n = (size_t)s->H * (size_t)s->W;
+    bool have[4] = {false, false, false, false};
+    for (;;) {
+        SummaryFrame fr;
+        if (!read_exact(c, &fr, sizeof(fr))) return false;
+        if (fr.type == 0) break;
+        void *data = malloc(fr.length ? fr.length : 1);
+        if (!data || !read_exact(c, data, fr.length)) {
+            free(data);
+            return false;
+        }
+        // rámec musí mať n prvkov známej veľkosti; neznámy typ sa preskočí
+        bool valid = fr.elemSize && fr.length == n * fr.elemSize;
+        if (valid && fr.type == 1 && fr.elemSize == 1) {
+            memcpy(s->obstacle, data, n);
+            have[1] = true;
+        } else if (valid && (fr.type == 2 || fr.type == 3) &&
+                   (fr.elemSize == sizeof(float) || fr.elemSize == sizeof(double))) {
+            double *dst = fr.type == 2 ? s->avg : s->prob;
+            for (size_t i = 0; i < n; i++) {
+                dst[i] = fr.elemSize == sizeof(float) ? (double)((const float*)data)[i] : ((const double*)data)[i];
+            }
+            have[fr.type] = true;
+        }
+        free(data);
+    }
+    return have[1] && have[2] && have[3];
+}
+
+// prúd codec s počítadlami; priemer a pravdepodobnosť sa rátajú ako na serveri
+static bool summary_z(RwClient *c, RwSummary *s) {
+    size_t n = (size_t)s->H * (size_t)s->W;
+    bool *obst = (bool*)malloc(n * sizeof(bool));
+    uint64_t *a = (uint64_t*)malloc(4 * n * sizeof(uint64_t));
+    bool ok = obst && a;
+    if (ok) {
+        uint64_t *steps = a, *hits = a + n, *samples = a + 2 * n, *cens = a + 3 * n;
+        CodecReader r;
+        ok = codec_reader_init(&r, codec_client_source, c);
+        if (ok) {
+            codec_get_bits(&r, obst, n);
+            codec_get_rows(&r, steps, s->H, s->W);
+            codec_get_rows(&r, hits, s->H, s->W);
+            codec_get_rows(&r, samples, s->H, s->W);
+            codec_get_rows(&r, cens, s->H, s->W);
+            ok = codec_reader_finish(&r);
+        }
+        for (size_t i = 0; ok && i < n; i++) {
+            uint64_t done = samples[i] - cens[i];
+            s->obstacle[i] = obst[i];
+            s->avg[i] = obst[i] || !done ? 0.0 : (double)steps[i] / (double)done;
+            s->prob[i] = obst[i] || !samples[i] ? 0.0 : (double)hits[i] / (double)samples[i];
+        }
+    }
+    free(obst);
+    free(a);
+    return ok;
+}
+
+bool rwc_read_summary(RwClient *c, RwSummary *s, RwReply *r) {
+    memset(s, 0, sizeof(*s));
+    uint64_t start = c->bytesIn - (c->inLen - c->inPos);
+    if (!rwc_reply(c, r)) return false;
+    if (!r->ok) return true;
+
+    char kind[16] = {0};
+    if (sscanf(r->line, "OK SUMMARY_%15s", kind) != 1) return false;
+    s->H = (int)rwc_reply_int(r, "H", 0);
+    s->W = (int)rwc_reply_int(r, "W", 0);
+    s->K = (int)rwc_reply_int(r, "K", 0);
+    s->ActRep = (int)rwc_reply_int(r, "ActRep", 0);
+    const char *cens = strstr(r->line, " Censored=");
+    s->censored = cens ? strtod(cens + 10, NULL) : 0.0;
+    if (s->H <= 0 || s->W <= 0) return false;
+
+    bool ok;
+    if (strcmp(kind, "AVG") == 0) {
+        ok = summary_alloc(s, true, false) && summary_text(c, s, s->avg);
+    } else if (strcmp(kind, "PROB") == 0) {
+        ok = summary_alloc(s, false, true) && summary_text(c, s, s->prob);
+    } else if (strcmp(kind, "BIN") == 0) {
+        ok = summary_alloc(s, true, true) && summary_bin(c, s);
+    } else if (strcmp(kind, "Z") == 0) {
+        ok = summary_alloc(s, true, true) && summary_z(c, s);
+    } else {
+        ok = false;
+    }
+    s->bytes = c->bytesIn - (c->inLen - c->inPos) - start;
+    if (!ok) rwc_summary_free(s);
+    return ok;
+}
@@ -0,0 +1,148 @@
+#ifndef RWCLIENT_H
+#define RWCLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Klientská knižnica protokolu servera. Čítanie ide cez vlastný buffer (jeden recv
+// prečíta, čo je k dispozícii, nie po bajtoch). Požiadavky sa len zaradia do výstupného
+// buffra a odídu spolu pri rwc_flush alebo pri čítaní prvej odpovede, takže skript môže
+// poslať veľa príkazov naraz a odpovede potom čítať v rovnakom poradí:
+//
+//   rwc_run_more(&c, 100, "wait=1");
+//   rwc_get_summary_bin(&c, true);
+//   rwc_reply(&c, &r);              // RUN_MORE
+//   rwc_read_summary(&c, &s, &r);   // GET_SUMMARY_BIN
+//
+// Počas odosielania sa zároveň prijíma, takže ani dlhá dávka neuviazne na tom,
+// že server čaká, kým si klient prevezme skoršie odpovede.
+
+#define RWC_LINE_MAX 1024
+
+typedef struct RwClient {
+    int fd;
+    char *in;                       // prijaté, neprečítané bajty
+    size_t inPos, inLen, inCap;
+    char *out;                      // zaradené, neodoslané požiadavky
+    size_t outLen, outCap;
+    int pending;                    // požiadavky bez prečítanej odpovede
+    uint64_t bytesIn;               // koľko bajtov prišlo zo servera
+    char hello[RWC_LINE_MAX];       // uvítací riadok servera
+} RwClient;
+
+// stavový riadok odpovede; ok = začína "OK "
+typedef struct RwReply {
+    bool ok;
+    char line[RWC_LINE_MAX];
+} RwReply;
+
+// JOB_STATUS
+typedef struct RwJobStatus {
+    int job;                        // 0 = ešte žiadny beh
+    char state[16];                 // idle, running, done, cancelled, failed
+    int actRep, target;
+    double repsPerSec, stepsPerSec, eta, elapsed;
+} RwJobStatus;
+
+// sumár v ktoromkoľvek formáte (text, BIN, Z); polia, ktoré odpoveď nemala, sú NULL
+typedef struct RwSummary {
+    int H, W, K, ActRep;
+    double censored;
+    uint8_t *obstacle;              // 1 = prekážka
+    double *avg;
+    double *prob;
+    uint64_t bytes;                 // veľkosť prenosu vrátane hlavičky
+} RwSummary;
+
+// záber interaktívneho módu (FRAME, formát v trace.h servera)
+#define RWC_FRAME_MOVES_MAX 8192
+
+typedef struct RwFrame {
+    uint64_t seq, rep;
+    int fromRow, fromCol;           // štart prehranej prechádzky
+    int toRow, toCol;               // kde skončila (alebo kde sa zápis zastavil)
+    uint32_t steps, moves;
+    bool hit;                       // došla do stredu
+    uint8_t code[RWC_FRAME_MOVES_MAX / 4]; // 2 bity na pohyb od najnižších, 0=U 1=D 2=L 3=R
+} RwFrame;
+
+// EXPORT_STATE: čiastkové sumy simulácie, replikácie [rep0, actRep) so seedom seed
+typedef struct RwState {
+    int H, W, K;
+    uint64_t seed;
+    int rep0, actRep;
+    uint32_t maxSteps;
+    bool probOnly;
+    bool worldType;
+    bool varValid;
+    int estimator;
+    double moveProbs[4];            // U, D, L, R (presne, %.17g)
+    bool *obstacle;
+    uint64_t *steps, *hits, *samples, *censored;
+    double *m2;                     // NULL, ak časť rozptyl nemá (varValid false)
+} RwState;
+
+// NEW_SIM
+typedef struct RwNewSim {
+    int H, W;
+    bool obstacles;
+    double moveProbs[4];            // U, D, L, R
+    int K, reps;
+    const char *resultFile;
+    const char *opts;               // voliteľné kľúč=hodnota (NULL = žiadne)
+} RwNewSim;
+
+// pripojí sa a prečíta uvítanie
+bool rwc_connect(RwClient *c, const char *host, int port);
+void rwc_close(RwClient *c);
+
+// zaradí ľubovoľný riadok príkazu (bez \n); odpoveď treba prečítať ako pri typových volaniach
+bool rwc_send(RwClient *c, const char *line);
+// odošle všetko zaradené
+bool rwc_flush(RwClient *c);
+
+// požiadavky (len zaradia)
+bool rwc_new_sim(RwClient *c, const RwNewSim *p);
+bool rwc_resume_sim(RwClient *c, const char *inFile, int reps, const char *outFile, const char *opts);
+bool rwc_run_more(RwClient *c, int reps, const char *opts);
+// opts napr. "metric=prob maxreps=10000 wait=1"
+bool rwc_run_until(RwClient *c, double precision, const char *opts);
+bool rwc_set_mode(RwClient *c, int mode);
+bool rwc_get_summary_avg(RwClient *c);
+bool rwc_get_summary_prob(RwClient *c);
+bool rwc_get_summary_bin(RwClient *c, bool f32);
+bool rwc_get_summary_z(RwClient *c);
+bool rwc_job_status(RwClient *c);
+bool rwc_cancel(RwClient *c);
+bool rwc_end_sim(RwClient *c);
+bool rwc_open(RwClient *c);
+bool rwc_attach(RwClient *c, int session);
+bool rwc_watch(RwClient *c, int frames);          // 0 = do konca behu
+bool rwc_close_session(RwClient *c, int session); // 0 = aktuálna
+bool rwc_stats(RwClient *c);
+bool rwc_export_state(RwClient *c);
+// MERGE_STATE: server pripočíta časť z iného servera (session 0 = jeho predvolená relácia)
+bool rwc_merge_state(RwClient *c, const char *host, int port, int session);
+bool rwc_quit(RwClient *c);
+
+// odpovede v poradí požiadaviek; false = spojenie zlyhalo (chyba servera je r->ok == false)
+bool rwc_reply(RwClient *c, RwReply *r);
+bool rwc_read_job_status(RwClient *c, RwJobStatus *st, RwReply *r);
+// STATS: stavový riadok do r a za ním Lines= riadkov do text (oddelené \n; čo sa
+// nezmestí, sa prečíta a zahodí)
+bool rwc_read_stats(RwClient *c, RwReply *r, char *text, size_t textLen);
+// EXPORT_STATE; pri ERR ostane st prázdny a r->ok false
+bool rwc_read_state(RwClient *c, RwState *st, RwReply *r);
+void rwc_state_free(RwState *st);
+// odpoveď na ktorýkoľvek GET_SUMMARY_*; pri ERR ostane s prázdny a r->ok false
+bool rwc_read_summary(RwClient *c, RwSummary *s, RwReply *r);
+void rwc_summary_free(RwSummary *s);
+// WATCH a behy v interaktívnom móde: zábery a za nimi stavový riadok;
+// 1 = záber v f, 0 = odpoveď je celá (stavový riadok v r), -1 = spojenie zlyhalo
+int rwc_read_frame(RwClient *c, RwFrame *f, RwReply *r);
+
+// hodnota kľúča Key=... zo stavového riadku (napr. "Session", "Job"); def ak chýba
+long long rwc_reply_int(const RwReply *r, const char *key, long long def);
+
+#endif
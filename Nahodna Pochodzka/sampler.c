@@ -0,0 +1,70 @@
+#include "sampler.h"
+
+#include <math.h>
+#include <string.h>
+
+// skúsi vyjadriť p ako násobky 1/2^b pre čo najmenšie b
+static bool try_dyadic(DirSampler *ds, const double p[4]) {
+    for (int b = 2; b <= DIR_SAMPLER_MAX_BITS; b++) {
+        int slots = 1 << b;
+        int cnt[4], total = 0;
+        bool ok = true;
+        for (int i = 0; i < 4 && ok; i++) {
+            double x = p[i] * slots;
+            cnt[i] = (int)llround(x);
+            if (fabs(x - cnt[i]) > 1e-9) ok = false;
+            total += cnt[i];
+        }
+        if (!ok || total != slots) continue;
+
+        int k = 0;
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < cnt[i]; j++) ds->table[k++] = (uint8_t)i;
+        ds->bits = b;
+        ds->mask = (uint32_t)slots - 1;
+        return true;
+    }
+    return false;
+}
+
+// Vose alias metóda v celých číslach: 4 stĺpce po 2^30, spolu 2^32
+static void build_alias(DirSampler *ds, const double p[4]) {
+    const uint64_t col = 1ull << 30;
+    uint64_t w[4], sum = 0;
+    int big = 0;
+    for (int i = 0; i < 4; i++) {
+        w[i] = (uint64_t)llround(p[i] * 4294967296.0);
+        sum += w[i];
+        if (w[i] > w[big]) big = i;
+    }
+    // zaokrúhľovaciu chybu dorovná najväčšia pravdepodobnosť
+    w[big] += (1ull << 32) - sum;
+
+    int small[4], large[4], ns = 0, nl = 0;
+    for (int i = 0; i < 4; i++) {
+        ds->alias[i] = (uint8_t)i;
+        if (w[i] < col) small[ns++] = i;
+        else large[nl++] = i;
+    }
+    while (ns > 0 && nl > 0) {
+        int sm = small[--ns];
+        int lg = large[--nl];
+        ds->thresh[sm] = (uint32_t)w[sm];
+        ds->alias[sm] = (uint8_t)lg;
+        w[lg] -= col - w[sm];
+        if (w[lg] < col) small[ns++] = lg;
+        else large[nl++] = lg;
+    }
+    while (nl > 0) ds->thresh[large[--nl]] = (uint32_t)col;
+    while (ns > 0) ds->thresh[small[--ns]] = (uint32_t)col; // len pri zaokrúhľovaní
+    ds->bits = 32;
+    ds->mask = 0xFFFFFFFFu;
+}
+
+bool dir_sampler_init(DirSampler *ds, const double p[4]) {
+    if (!ds) return false;
+    memset(ds, 0, sizeof(*ds));
+    for (int i = 0; i < 4; i++) if (p[i] < 0.0) return false;
+    if (!try_dyadic(ds, p)) build_alias(ds, p);
+    return true;
+}
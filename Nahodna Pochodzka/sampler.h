@@ -0,0 +1,41 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+#define DIR_SAMPLER_MAX_BITS 8
+
+// Výber smeru (U, D, L, R) bez pohyblivej čiarky, zostavený raz z MoveProbs.
+//  - dyadické pravdepodobnosti (násobky 1/2^b, b <= 8): priama tabuľka z b bitov,
+//    pri rovnomernom rozdelení sú to 2 bity na krok = 32 krokov z jedného rng_next
+//  - inak alias tabuľka: horné 2 bity vyberú stĺpec, dolných 30 bitov sa porovná s prahom
+typedef struct DirSampler {
+    int bits;                                   // bitov na jeden krok (b alebo 32 pre alias)
+    uint32_t mask;
+    uint32_t thresh[4];                         // alias: prah v rozsahu 0..2^30
+    uint8_t alias[4];
+    uint8_t table[1 << DIR_SAMPLER_MAX_BITS];   // dyadický režim
+} DirSampler;
+
+// zásobník náhodných bitov jednej prechádzky
+typedef struct DirBits {
+    uint64_t word;
+    int left;
+} DirBits;
+
+bool dir_sampler_init(DirSampler *ds, const double p[4]);
+
+static inline int dir_sample(const DirSampler *ds, DirBits *b, Rng *g) {
+    if (b->left < ds->bits) { b->word = rng_next(g); b->left = 64; }
+    uint32_t u = (uint32_t)b->word & ds->mask;
+    b->word >>= ds->bits;
+    b->left -= ds->bits;
+    if (ds->bits <= DIR_SAMPLER_MAX_BITS) return ds->table[u];
+    uint32_t col = u >> 30;
+    return (u & 0x3FFFFFFFu) < ds->thresh[col] ? (int)col : (int)ds->alias[col];
+}
+
+#endif
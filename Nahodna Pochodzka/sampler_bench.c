@@ -0,0 +1,65 @@
+// sampler_bench.c - porovnanie výberu smeru: pôvodný rand()+kumulatívny súčet vs DirSampler
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "rng.h"
+#include "sampler.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// pôvodný sample_dir zo sim.c
+static int sample_dir_rand(const double p[4]) {
+    double r = (double)rand() / (double)RAND_MAX;
+    double c = 0.0;
+    for (int i = 0; i < 4; i++) {
+        c += p[i];
+        if (r <= c) return i;
+    }
+    return 3;
+}
+
+static void bench(const char *name, const double p[4], long steps) {
+    long cnt[4] = {0};
+
+    srand(1);
+    double t0 = now_sec();
+    for (long i = 0; i < steps; i++) cnt[sample_dir_rand(p)]++;
+    double tOld = now_sec() - t0;
+
+    DirSampler ds;
+    dir_sampler_init(&ds, p);
+    Rng g;
+    rng_seed(&g, 1);
+    DirBits bits = {0, 0};
+    long cntNew[4] = {0};
+    t0 = now_sec();
+    for (long i = 0; i < steps; i++) cntNew[dir_sample(&ds, &bits, &g)]++;
+    double tNew = now_sec() - t0;
+
+    printf("%-10s bits=%-2d  rand+cumsum %8.1f Msteps/s   DirSampler %8.1f Msteps/s   x%.1f\n",
+           name, ds.bits, steps / tOld * 1e-6, steps / tNew * 1e-6, tOld / tNew);
+    printf("           p=%.4f %.4f %.4f %.4f   namerané %.4f %.4f %.4f %.4f\n",
+           p[0], p[1], p[2], p[3],
+           (double)cntNew[0] / steps, (double)cntNew[1] / steps,
+           (double)cntNew[2] / steps, (double)cntNew[3] / steps);
+}
+
+int main(int argc, char *argv[]) {
+    long steps = 100000000L;
+    if (argc >= 2) steps = atol(argv[1]);
+    if (steps <= 0) steps = 100000000L;
+
+    const double uniform[4] = {0.25, 0.25, 0.25, 0.25};
+    const double dyadic[4]  = {0.5, 0.125, 0.25, 0.125};
+    const double general[4] = {0.3, 0.2, 0.1, 0.4};
+
+    bench("uniform", uniform, steps);
+    bench("dyadic", dyadic, steps);
+    bench("general", general, steps);
+    return 0;
+}
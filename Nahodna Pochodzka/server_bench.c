@@ -0,0 +1,165 @@
+// server_bench.c - škálovanie spojení servera cez loopback: veľa nečinných spojení,
+// niekoľko aktívnych posiela dávky príkazov naraz (pipelining) a meria odozvu
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "socket.h"
+
+typedef struct BenchConn {
+    int fd;
+    char buf[4096];
+    size_t len, pos;
+} BenchConn;
+
+typedef struct BenchArgs {
+    BenchConn *conn;
+    int rounds;
+    int pipeline;
+    double *lat;                    // čas dávky / pipeline, pre každé kolo
+    int errors;
+} BenchArgs;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// jeden riadok odpovede (bez \n), false pri konci spojenia
+static bool read_line(BenchConn *c, char *out, size_t outLen) {
+    size_t n = 0;
+    for (;;) {
+        if (c->pos == c->len) {
+            ssize_t r = recv(c->fd, c->buf, sizeof(c->buf), 0);
+            if (r <= 0) return false;
+            c->len = (size_t)r;
+            c->pos = 0;
+        }
+        char ch = c->buf[c->pos++];
+        if (ch == '\n') break;
+        if (n + 1 < outLen) out[n++] = ch;
+    }
+    out[n] = '\0';
+    return true;
+}
+
+static bool send_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void *active_main(void *arg) {
+    BenchArgs *a = (BenchArgs*)arg;
+    static const char req[] = "JOB_STATUS\n";
+    size_t reqLen = sizeof(req) - 1;
+    char *batch = (char*)malloc(reqLen * (size_t)a->pipeline);
+    if (!batch) {
+        a->errors++;
+        return NULL;
+    }
+    for (int k = 0; k < a->pipeline; k++) memcpy(batch + k * reqLen, req, reqLen);
+
+    char line[512];
+    for (int r = 0; r < a->rounds; r++) {
+        double t0 = now_sec();
+        if (!send_all(a->conn->fd, batch, reqLen * (size_t)a->pipeline)) {
+            a->errors++;
+            break;
+        }
+        for (int k = 0; k < a->pipeline; k++) {
+            if (!read_line(a->conn, line, sizeof(line)) || strncmp(line, "OK JOB_STATUS", 13) != 0) {
+                a->errors++;
+                break;
+            }
+        }
+        a->lat[r] = (now_sec() - t0) / a->pipeline;
+    }
+    free(batch);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "pouzitie: %s host port [spojenia=1000] [aktivne=8] [kola=200] [pipeline=16]\n", argv[0]);
+        return 1;
+    }
+    const char *host = argv[1];
+    int port = atoi(argv[2]);
+    int conns = argc >= 4 ? atoi(argv[3]) : 1000;
+    int active = argc >= 5 ? atoi(argv[4]) : 8;
+    int rounds = argc >= 6 ? atoi(argv[5]) : 200;
+    int pipeline = argc >= 7 ? atoi(argv[6]) : 16;
+    if (active > conns) active = conns;
+    if (active < 1 || rounds < 1 || pipeline < 1) return 1;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    BenchConn *c = (BenchConn*)calloc((size_t)conns, sizeof(BenchConn));
+    BenchArgs *args = (BenchArgs*)calloc((size_t)active, sizeof(BenchArgs));
+    double *lat = (double*)calloc((size_t)active * (size_t)rounds, sizeof(double));
+    pthread_t *tid = (pthread_t*)calloc((size_t)active, sizeof(pthread_t));
+    if (!c || !args || !lat || !tid) return 1;
+
+    // všetky spojenia sa otvoria a dostanú HELLO, nečinné potom len visia
+    double t0 = now_sec();
+    char line[512];
+    int opened = 0;
+    for (; opened < conns; opened++) {
+        c[opened].fd = connect_to_server(host, port);
+        if (c[opened].fd < 0 || !read_line(&c[opened], line, sizeof(line))) break;
+    }
+    double tConnect = now_sec() - t0;
+    if (opened < active) {
+        fprintf(stderr, "otvorenych len %d spojeni\n", opened);
+        return 1;
+    }
+
+    t0 = now_sec();
+    for (int k = 0; k < active; k++) {
+        args[k].conn = &c[k];
+        args[k].rounds = rounds;
+        args[k].pipeline = pipeline;
+        args[k].lat = lat + (size_t)k * (size_t)rounds;
+        pthread_create(&tid[k], NULL, active_main, &args[k]);
+    }
+    int errors = 0;
+    for (int k = 0; k < active; k++) {
+        pthread_join(tid[k], NULL);
+        errors += args[k].errors;
+    }
+    double tRun = now_sec() - t0;
+
+    size_t nlat = (size_t)active * (size_t)rounds;
+    qsort(lat, nlat, sizeof(double), cmp_double);
+    double reqs = (double)active * rounds * pipeline;
+    printf("spojenia=%d (otvorene za %.3f s)  aktivne=%d  pipeline=%d  kola=%d\n",
+           opened, tConnect, active, pipeline, rounds);
+    printf("  %.0f prikazov/s   odozva na prikaz p50=%.1f us  p99=%.1f us   chyby=%d\n",
+           reqs / tRun, lat[nlat / 2] * 1e6, lat[nlat * 99 / 100] * 1e6, errors);
+
+    for (int k = 0; k < opened; k++) close(c[k].fd);
+    free(tid);
+    free(lat);
+    free(args);
+    free(c);
+    return errors ? 1 : 0;
+}
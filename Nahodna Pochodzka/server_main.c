@@ -1,361 +1,1438 @@
-// server_main.c
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdbool.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <time.h>
-
-#include "sim.h"
-#include "socket.h"
-
-#define DEFAULT_PORT 5555
-#define BUF_SIZE 4096
-
-static Sim g_sim;
-static bool g_sim_initialized = false;
-static bool g_sim_running = false;
-static int  g_mode_interactive = 0;
-
-static pthread_mutex_t g_sim_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-static void trim_newline(char *s) {
-    if (!s) return;
-    size_t n = strlen(s);
-    while (n > 0 && (s[n-1] == '\n' || s[n-1] == '\r')) {
-        s[n-1] = '\0';
-        n--;
-    }
-}
-
-static int send_all(int sock, const char *data) {
-    size_t len = strlen(data);
-    size_t sent = 0;
-    while (sent < len) {
-        ssize_t n = send(sock, data + sent, len - sent, 0);
-        if (n <= 0) return -1;
-        sent += (size_t)n;
-    }
-    return 0;
-}
-
-static void cmd_new_sim(int sock, char *args) {
-    int H, W, wt, reps, K;
-    double pU, pD, pL, pR;
-    char out[256] = {0};
-
-    int n = sscanf(args, "%d %d %d %lf %lf %lf %lf %d %d %255s",
-                   &H, &W, &wt,
-                   &pU, &pD, &pL, &pR,
-                   &K, &reps, out);
-    if (n != 10) {
-        send_all(sock, "ERR Bad NEW_SIM params\n");
-        return;
-    }
-
-    pthread_mutex_lock(&g_sim_mutex);
-
-    sim_free(&g_sim);
-    memset(&g_sim, 0, sizeof(g_sim));
-    if (!sim_init_empty(&g_sim, H, W, (bool)wt)) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR sim_init_empty\n");
-        return;
-    }
-
-    g_sim.K = K;
-    g_sim.MoveProbs[0] = pU;
-    g_sim.MoveProbs[1] = pD;
-    g_sim.MoveProbs[2] = pL;
-    g_sim.MoveProbs[3] = pR;
-    strncpy(g_sim.ResultFilePath, out, sizeof(g_sim.ResultFilePath)-1);
-
-    if (g_sim.WorldType) {
-        double dens = 0.2;
-        if (!sim_generate_obstacles_connected(&g_sim, dens, (uint64_t)time(NULL))) {
-            pthread_mutex_unlock(&g_sim_mutex);
-            send_all(sock, "ERR generate_obstacles\n");
-            return;
-        }
-    }
-
-    if (!sim_run(&g_sim, reps, (uint64_t)time(NULL))) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR sim_run\n");
-        return;
-    }
-
-    g_sim_initialized = true;
-    g_sim_running = true;
-
-    char resp[128];
-    snprintf(resp, sizeof(resp),
-             "OK NEW_SIM ActRep=%d\n", g_sim.ActRep);
-    pthread_mutex_unlock(&g_sim_mutex);
-
-    send_all(sock, resp);
-}
-
-static void cmd_resume_sim(int sock, char *args) {
-    char inFile[256] = {0};
-    int reps;
-    char outFile[256] = {0};
-
-    int n = sscanf(args, "%255s %d %255s", inFile, &reps, outFile);
-    if (n != 3) {
-        send_all(sock, "ERR Bad RESUME_SIM params\n");
-        return;
-    }
-
-    pthread_mutex_lock(&g_sim_mutex);
-
-    sim_free(&g_sim);
-    memset(&g_sim, 0, sizeof(g_sim));
-    if (!sim_load_state(&g_sim, inFile)) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR sim_load_state\n");
-        return;
-    }
-    strncpy(g_sim.ResultFilePath, outFile, sizeof(g_sim.ResultFilePath)-1);
-
-    if (!sim_run(&g_sim, reps, (uint64_t)time(NULL))) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR sim_run\n");
-        return;
-    }
-
-    g_sim_initialized = true;
-    g_sim_running = true;
-
-    char resp[128];
-    snprintf(resp, sizeof(resp),
-             "OK RESUME_SIM ActRep=%d\n", g_sim.ActRep);
-    pthread_mutex_unlock(&g_sim_mutex);
-
-    send_all(sock, resp);
-}
-
-static void cmd_run_more(int sock, char *args) {
-    int reps;
-    if (sscanf(args, "%d", &reps) != 1 || reps <= 0) {
-        send_all(sock, "ERR Bad RUN_MORE params\n");
-        return;
-    }
-
-    pthread_mutex_lock(&g_sim_mutex);
-    if (!g_sim_initialized) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR No simulation\n");
-        return;
-    }
-    if (!sim_run(&g_sim, reps, (uint64_t)time(NULL))) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR sim_run\n");
-        return;
-    }
-
-    char resp[128];
-    snprintf(resp, sizeof(resp),
-             "OK RUN_MORE ActRep=%d\n", g_sim.ActRep);
-    pthread_mutex_unlock(&g_sim_mutex);
-
-    send_all(sock, resp);
-}
-
-static void cmd_set_mode(int sock, char *args) {
-    int m;
-    if (sscanf(args, "%d", &m) != 1 || (m != 0 && m != 1)) {
-        send_all(sock, "ERR Bad SET_MODE\n");
-        return;
-    }
-
-    pthread_mutex_lock(&g_sim_mutex);
-    g_mode_interactive = m;
-    pthread_mutex_unlock(&g_sim_mutex);
-
-    send_all(sock, "OK SET_MODE\n");
-}
-
-static void cmd_get_summary_avg(int sock) {
-    pthread_mutex_lock(&g_sim_mutex);
-    if (!g_sim_initialized) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR No simulation\n");
-        return;
-    }
-
-    int H = g_sim.WorldHeight;
-    int W = g_sim.WorldWidth;
-
-    char line[1024];
-    snprintf(line, sizeof(line),
-             "OK SUMMARY_AVG H=%d W=%d ActRep=%d\n",
-             H, W, g_sim.ActRep);
-    send_all(sock, line);
-
-    for (int r = 0; r < H; r++) {
-        line[0] = '\0';
-        for (int c = 0; c < W; c++) {
-            int i = r * W + c;
-            if (g_sim.WorldType && g_sim.obstacle[i]) {
-                strcat(line, "X ");
-            } else {
-                double avg = (g_sim.ActRep > 0)
-                             ? (double)g_sim.steps_sum[i] / (double)g_sim.ActRep
-                             : 0.0;
-                char buf[32];
-                snprintf(buf, sizeof(buf), "%.1f ", avg);
-                strcat(line, buf);
-            }
-        }
-        strcat(line, "\n");
-        send_all(sock, line);
-    }
-
-    pthread_mutex_unlock(&g_sim_mutex);
-}
-
-static void cmd_get_summary_prob(int sock) {
-    pthread_mutex_lock(&g_sim_mutex);
-    if (!g_sim_initialized) {
-        pthread_mutex_unlock(&g_sim_mutex);
-        send_all(sock, "ERR No simulation\n");
-        return;
-    }
-
-    int H = g_sim.WorldHeight;
-    int W = g_sim.WorldWidth;
-
-    char line[1024];
-    snprintf(line, sizeof(line),
-             "OK SUMMARY_PROB H=%d W=%d K=%d ActRep=%d\n",
-             H, W, g_sim.K, g_sim.ActRep);
-    send_all(sock, line);
-
-    for (int r = 0; r < H; r++) {
-        line[0] = '\0';
-        for (int c = 0; c < W; c++) {
-            int i = r * W + c;
-            if (g_sim.WorldType && g_sim.obstacle[i]) {
-                strcat(line, "X ");
-            } else {
-                double pr = (g_sim.ActRep > 0)
-                            ? (double)g_sim.hits_sum[i] / (double)g_sim.ActRep
-                            : 0.0;
-                char buf[32];
-                snprintf(buf, sizeof(buf), "%.2f ", pr);
-                strcat(line, buf);
-            }
-        }
-        strcat(line, "\n");
-        send_all(sock, line);
-    }
-
-    pthread_mutex_unlock(&g_sim_mutex);
-}
-
-static void cmd_end_sim(int sock) {
-    pthread_mutex_lock(&g_sim_mutex);
-    if (g_sim_initialized) {
-        sim_save_state(&g_sim, g_sim.ResultFilePath[0] ? g_sim.ResultFilePath : "result.txt");
-        sim_free(&g_sim);
-        memset(&g_sim, 0, sizeof(g_sim));
-        g_sim_initialized = false;
-        g_sim_running = false;
-    }
-    pthread_mutex_unlock(&g_sim_mutex);
-
-    send_all(sock, "OK END_SIM\n");
-}
-
-static void *client_thread(void *arg) {
-    int sock = *(int*)arg;
-    free(arg);
-
-    char buf[BUF_SIZE];
-
-    send_all(sock, "HELLO RandomWalkServer\n");
-
-    while (1) {
-        ssize_t n = recv(sock, buf, sizeof(buf)-1, 0);
-        if (n <= 0) break;
-        buf[n] = '\0';
-        trim_newline(buf);
-        if (strlen(buf) == 0) continue;
-
-        char cmd[64] = {0};
-        char *args = NULL;
-
-        char *space = strchr(buf, ' ');
-        if (space) {
-            size_t len = (size_t)(space - buf);
-            if (len >= sizeof(cmd)) len = sizeof(cmd)-1;
-            memcpy(cmd, buf, len);
-            cmd[len] = '\0';
-            args = space + 1;
-        } else {
-            strncpy(cmd, buf, sizeof(cmd)-1);
-            args = buf + strlen(buf);
-        }
-
-        if (strcmp(cmd, "NEW_SIM") == 0) {
-            cmd_new_sim(sock, args);
-        } else if (strcmp(cmd, "RESUME_SIM") == 0) {
-            cmd_resume_sim(sock, args);
-        } else if (strcmp(cmd, "RUN_MORE") == 0) {
-            cmd_run_more(sock, args);
-        } else if (strcmp(cmd, "SET_MODE") == 0) {
-            cmd_set_mode(sock, args);
-        } else if (strcmp(cmd, "GET_SUMMARY_AVG") == 0) {
-            cmd_get_summary_avg(sock);
-        } else if (strcmp(cmd, "GET_SUMMARY_PROB") == 0) {
-            cmd_get_summary_prob(sock);
-        } else if (strcmp(cmd, "END_SIM") == 0) {
-            cmd_end_sim(sock);
-        } else if (strcmp(cmd, "QUIT") == 0) {
-            send_all(sock, "OK BYE\n");
-            break;
-        } else {
-            send_all(sock, "ERR Unknown command\n");
-        }
-    }
-
-    close(sock);
-    return NULL;
-}
-
-int main(int argc, char *argv[]) {
-    int port = DEFAULT_PORT;
-    if (argc >= 2) {
-        port = atoi(argv[1]);
-        if (port <= 0) port = DEFAULT_PORT;
-    }
-
-    int passive = passive_socket_init(port);
-    if (passive < 0) {
-        fprintf(stderr, "Failed to init server socket\n");
-        return 1;
-    }
-
-    printf("Server listening on port %d\n", port);
-
-    for (;;) {
-        int *pSock = malloc(sizeof(int));
-        if (!pSock) continue;
-
-        *pSock = passive_socket_wait_for_client(passive);
-        if (*pSock < 0) {
-            free(pSock);
-            continue;
-        }
-
-        pthread_t tid;
-        pthread_create(&tid, NULL, client_thread, pSock);
-        pthread_detach(tid);
-    }
-
-    passive_socket_destroy(passive);
-    return 0;
-}
-
+// server_main.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+
+#include "checkpoint.h"
+#include "codec.h"
+#include "reactor.h"
+#include "rwclient.h"
+#include "shard.h"
+#include "sim.h"
+#include "session.h"
+#include "snapshot.h"
+#include "socket.h"
+#include "state.h"
+#include "stats.h"
+#include "trace.h"
+#include "world.h"
+
+#define DEFAULT_PORT 5555
+#define SERVER_CKPT_SECS 300 // predvolený checkpoint dlhých behov (ckpt_secs=0 vypne)
+#define SERVER_SNAPSHOT_MS 100 // počas behu sa sumár obnovuje najviac ~10x za sekundu
+#define SERVER_WORKERS 16 // pracovné vlákna reaktora (čakajúci príkaz, napr. wait=1, prenechá miesto novému)
+#define SERVER_EVICT_PREFIX "session_" // odložené relácie: session_<port>_<id>.dwalk
+#define RUN_UNTIL_MAXREPS 100000 // strop kôl RUN_UNTIL bez maxreps=
+#define SERVER_SHARD_PREFIX "rw_shard_" // svet pre pracovné servery: $TMPDIR/rw_shard_<port>_<id>.world
+#define REPLY_INFO_MAX 192 // " Job=<id>" + Job.info (128) + " Frames=<n> Dropped=<n>"
+
+static int  g_threads = 0;          // predvolený počet vlákien pre sim_run (0=auto)
+static double g_start;              // štart servera (Uptime v STATS)
+static int g_port;
+static ShardSet g_shards;           // koordinátor: replikácie behov idú na tieto servery
+
+// Každé spojenie pracuje s jednou reláciou (session.h): bez OPEN/ATTACH so spoločnou
+// reláciou 1. Beh na pozadí: NEW_SIM/RESUME_SIM/RUN_MORE/RUN_UNTIL pripravia sim relácie a spustia
+// job; kým beží, sim patrí jobu (príkazy, ktoré ho menia, skončia s ERR Job running),
+// CANCEL nastaví SimEnd. Sumáre a JOB_STATUS čítajú len snímky, zámok relácie nepotrebujú.
+// Interaktívny mód (SET_MODE 1, po spojeniach) a WATCH posielajú počas behu zábery
+// prechádzky (trace.h). So zoznamom serverov (6. argument) je server koordinátor: replikácie
+// behov NEW_SIM/RESUME_SIM/RUN_MORE rozdelí medzi ne a sumy zlúči (shard.h); exaktný mód
+// a RUN_UNTIL bežia lokálne.
+static const char *const JOB_STATE_NAMES[] = {"idle", "running", "done", "cancelled", "failed"};
+
+// odpoveď ide cez výstupný buffer spojenia (reactor.h); pri chybe je spojenie zavreté
+static int send_bytes(ReactorConn *conn, const void *data, size_t len) {
+    if (!reactor_send(conn, data, len)) return -1;
+    stats_sent(len);
+    return 0;
+}
+
+static int send_all(ReactorConn *conn, const char *data) {
+    return send_bytes(conn, data, strlen(data));
+}
+
+// voliteľné parametre za povinnými v tvare kľúč=hodnota (napr. "threads=8")
+static bool opt_get(const char *opts, const char *key, char *val, size_t valLen) {
+    size_t klen = strlen(key);
+    const char *p = opts;
+    while (p && *p) {
+        while (*p == ' ') p++;
+        const char *end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > klen && strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            size_t vl = len - klen - 1;
+            if (vl >= valLen) vl = valLen - 1;
+            memcpy(val, p + klen + 1, vl);
+            val[vl] = '\0';
+            return true;
+        }
+        p = end;
+    }
+    return false;
+}
+
+static int opt_int(const char *opts, const char *key, int def) {
+    char val[32];
+    if (!opt_get(opts, key, val, sizeof(val))) return def;
+    return atoi(val);
+}
+
+static uint64_t opt_u64(const char *opts, const char *key, uint64_t def) {
+    char val[32];
+    if (!opt_get(opts, key, val, sizeof(val))) return def;
+    return (uint64_t)strtoull(val, NULL, 10);
+}
+
+// kernel=auto|scalar|avx2
+static int opt_kernel(const char *opts, int def) {
+    char val[16];
+    if (!opt_get(opts, "kernel", val, sizeof(val))) return def;
+    if (strcmp(val, "scalar") == 0) return SIM_KERNEL_SCALAR;
+    if (strcmp(val, "avx2") == 0) return SIM_KERNEL_AVX2;
+    return SIM_KERNEL_AUTO;
+}
+
+// estimator=start|recycle
+static int opt_estimator(const char *opts, int def) {
+    char val[16];
+    if (!opt_get(opts, "estimator", val, sizeof(val))) return def;
+    if (strcmp(val, "recycle") == 0) return SIM_EST_RECYCLE;
+    if (strcmp(val, "start") == 0) return SIM_EST_START;
+    return def;
+}
+
+// ckpt_reps=N, ckpt_secs=T (0=vypnuté) pre priebežné ukladanie počas behu
+static void opt_checkpoint(const char *opts, Sim *s, int defReps, int defSecs) {
+    s->CheckpointReps = opt_int(opts, "ckpt_reps", defReps);
+    s->CheckpointSecs = opt_int(opts, "ckpt_secs", defSecs);
+}
+
+// format=bin|text|z pre ukladaný stav
+static int opt_format(const char *opts, int def) {
+    char val[16];
+    if (!opt_get(opts, "format", val, sizeof(val))) return def;
+    if (strcmp(val, "text") == 0) return SIM_STATE_DWALK1;
+    if (strcmp(val, "bin") == 0) return SIM_STATE_DWALK2;
+    if (strcmp(val, "z") == 0) return SIM_STATE_DWALKZ;
+    return def;
+}
+
+// maxsteps=N (0=bez limitu), probonly=0|1; bez kľúča ostáva hodnota simulácie
+static void opt_walk_limits(const char *opts, Sim *s) {
+    s->MaxSteps = (uint32_t)opt_u64(opts, "maxsteps", s->MaxSteps);
+    s->ProbOnly = opt_int(opts, "probonly", s->ProbOnly) != 0;
+}
+
+static double opt_double(const char *opts, const char *key, double def) {
+    char val[32];
+    if (!opt_get(opts, key, val, sizeof(val))) return def;
+    return atof(val);
+}
+
+// exaktný režim: namiesto sim_run sa vyrieši sústava pre očakávanú dobu zásahu
+// a stencilom sa spočíta pravdepodobnosť zásahu do K
+static bool run_exact(Sim *s, const char *opts, char *info, size_t infoLen) {
+    SimSolveInfo si;
+    if (!sim_solve_expected(s, opt_double(opts, "tol", 1e-8), opt_int(opts, "maxiter", 0), &si)) return false;
+    if (!sim_solve_hit_prob(s)) return false;
+    snprintf(info, infoLen, " Mode=exact Iter=%d Residual=%.3g Converged=%d",
+             si.iterations, si.residual, si.converged ? 1 : 0);
+    return true;
+}
+
+// metric=avg|prob pre RUN_UNTIL
+static int opt_metric(const char *opts) {
+    char val[16];
+    if (opt_get(opts, "metric", val, sizeof(val)) && strcmp(val, "prob") == 0) return SIM_CI_PROB;
+    return SIM_CI_AVG;
+}
+
+// RUN_UNTIL: kolá len pre bunky so širokým intervalom; info povie, koľko ich ostalo
+static bool run_until(Sim *s, int maxReps, uint64_t seed, const char *opts, char *info, size_t infoLen) {
+    double precision = opt_double(opts, "precision", 0.0);
+    int metric = opt_metric(opts);
+    if (!sim_run_until(s, precision, metric, maxReps, seed)) return false;
+    snprintf(info, infoLen, " Pending=%zu", sim_ci_pending(s, precision, metric));
+    return true;
+}
+
+// koordinátor: replikácie na pracovných serveroch (shard.h), svet bez receptu ide cez súbor
+// v TMPDIR (cesta v príkaze nesmie mať medzery; pre iné stroje musí byť adresár zdieľaný)
+static bool run_shards(Session *ss, char *info, size_t infoLen) {
+    char world[PATH_MAX], err[RWC_LINE_MAX + 64];
+    const char *dir = getenv("TMPDIR");
+    snprintf(world, sizeof(world), "%s/" SERVER_SHARD_PREFIX "%d_%d.world",
+             dir && dir[0] ? dir : "/tmp", g_port, ss->id);
+    bool ok = shard_run(&ss->sim, &g_shards, ss->job.reps, ss->job.seed, world, err, sizeof(err));
+    unlink(world);                  // pracovné servery ho načítali už pri NEW_SIM
+    if (!ok) {
+        fprintf(stderr, "Koordinátor (relácia %d): %s\n", ss->id, err);
+        return false;
+    }
+    snprintf(info, infoLen, " Shards=%d", g_shards.count < ss->job.reps ? g_shards.count : ss->job.reps);
+    return true;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t steps_total(const Sim *s) {
+    uint64_t sum = 0;
+    for (size_t k = 0; s->steps_sum && k < s->FreeCells; k++) sum += s->steps_sum[k];
+    return sum;
+}
+
+// job drží referenciu relácie, CLOSE ju preto neuvoľní pod ním
+static void *job_main(void *arg) {
+    Session *ss = (Session*)arg;
+    char info[128] = {0};
+    bool ok = ss->job.exact ? run_exact(&ss->sim, ss->job.opts, info, sizeof(info))
+            : ss->job.until ? run_until(&ss->sim, ss->job.reps, ss->job.seed, ss->job.opts, info, sizeof(info))
+            : g_shards.count ? run_shards(ss, info, sizeof(info))
+                            : sim_run(&ss->sim, ss->job.reps, ss->job.seed);
+    snapshots_publish(ss->sim.Publish, &ss->sim); // výsledok celého behu
+    uint64_t steps = steps_total(&ss->sim);
+
+    session_lock(ss);
+    bool cancelled = !ss->job.exact && __atomic_load_n(&ss->sim.SimEnd, __ATOMIC_RELAXED);
+    ss->job.state = !ok ? JOB_FAILED : cancelled ? JOB_CANCELLED : JOB_DONE;
+    ss->job.endRep = ss->sim.ActRep;
+    ss->job.endSteps = steps;
+    ss->job.endTime = now_sec();
+    snprintf(ss->job.info, sizeof(ss->job.info), "%s", info);
+    pthread_cond_broadcast(&ss->jobCond);
+    session_unlock(ss);
+    session_release(ss);
+    return NULL;
+}
+
+// pod ss->lock
+static bool job_running(const Session *ss) {
+    return ss->job.state == JOB_RUNNING;
+}
+
+// pod ss->lock; vráti id jobu alebo 0
+static int job_start(Session *ss, int kind, int reps, uint64_t seed, const char *opts) {
+    if (ss->closed) return 0;       // CLOSE ju práve ukončuje
+    int id = ss->job.id + 1;
+    memset(&ss->job, 0, sizeof(ss->job));
+    ss->job.id = id;
+    ss->job.exact = kind == JOB_KIND_EXACT;
+    ss->job.until = kind == JOB_KIND_UNTIL;
+    ss->job.reps = reps;
+    ss->job.seed = seed;
+    snprintf(ss->job.opts, sizeof(ss->job.opts), "%s", opts);
+    ss->job.startRep = ss->job.endRep = ss->sim.ActRep;
+    ss->job.startSteps = ss->job.endSteps = steps_total(&ss->sim);
+    ss->job.startTime = ss->job.endTime = now_sec();
+    __atomic_store_n(&ss->sim.SimEnd, false, __ATOMIC_RELAXED);
+    ss->sim.Trace = ss->trace;      // sim sa po reset/načítaní nuluje
+
+    ss->job.state = JOB_RUNNING;
+    session_retain(ss);
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, job_main, ss) != 0) {
+        ss->job.state = JOB_FAILED;
+        session_release(ss);
+        return 0;
+    }
+    pthread_detach(tid);
+    return id;
+}
+
+// pod ss->lock: počká na koniec jobu (zámok sa počas čakania uvoľní)
+static void job_wait(Session *ss) {
+    while (job_running(ss)) session_wait(ss);
+}
+
+// Posiela zábery (trace.h), kým beží job id, najviac maxFrames (0 = bez limitu).
+// Nový záber ide len vtedy, keď klient prevzal celý predchádzajúci (výstup spojenia je
+// prázdny), inak sa preskočí (dropped), takže pomalý pozorovateľ nebrzdí simuláciu ani
+// iných pozorovateľov. Bez ss->lock; vráti false, ak sa spojenie pokazilo.
+static bool watch_job(Session *ss, ReactorConn *conn, int id, int maxFrames, int *frames, int *dropped) {
+    char buf[TRACE_FRAME_MAX];
+    uint64_t seq = trace_watch(ss->trace), seen = seq;
+    bool alive = true;
+    *frames = *dropped = 0;
+    double tick = 1.0 / TRACE_FPS, next = now_sec();
+    reactor_detach(conn);           // beží celý job, pracovné vlákno nechá ostatným
+
+    for (;;) {
+        session_lock(ss);
+        bool running = ss->job.id == id && job_running(ss);
+        session_unlock(ss);
+        if (!running || (maxFrames > 0 && *frames >= maxFrames)) break;
+
+        // klient odišiel (polovičné zatvorenie nevadí, zábery ešte prevezme)
+        if (reactor_gone(conn)) {
+            alive = false;
+            break;
+        }
+        size_t n = trace_poll(ss->trace, &seq, buf);
+        if (n > 0 && reactor_pending(conn) == 0) {
+            *dropped += (int)(seq - seen - 1); // zábery, ktoré vyrobili iní pozorovatelia medzi našimi
+            (*frames)++;
+            // záber sa zmestí do buffra celý, takže send nečaká
+            if (send_bytes(conn, buf, n) != 0) alive = false;
+        } else if (n > 0) {
+            *dropped += (int)(seq - seen);
+        }
+        if (n > 0) seen = seq;
+        if (!alive) break;
+
+        next += tick;
+        double wait = next - now_sec();
+        if (wait <= 0) {
+            next = now_sec();       // zaostali sme, interval sa nedobieha
+            continue;
+        }
+        struct timespec ts = {(time_t)wait, (long)((wait - (double)(time_t)wait) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+    trace_unwatch(ss->trace);
+    return alive;
+}
+
+// Spustí beh na pozadí; s wait=1 odpovie až po jeho skončení (ako predtým). Pri
+// watch (interaktívny mód) sa čaká vždy a medzitým idú na conn zábery. Čakanie
+// nezaberá pracovné vlákno reaktora. Pod ss->lock, vráti false ak beh nevznikol
+// alebo (pri wait) zlyhal.
+static bool job_launch(Session *ss, ReactorConn *conn, bool watch, int kind, int reps, uint64_t seed,
+                       const char *opts, int *actRep, char *info, size_t infoLen) {
+    info[0] = '\0';
+    int id = job_start(ss, kind, reps, seed, opts);
+    if (!id) return false;
+    *actRep = ss->job.startRep;
+    if (!watch && opt_int(opts, "wait", 0) == 0) {
+        snprintf(info, infoLen, " Job=%d", id);
+        return true;
+    }
+    reactor_detach(conn);
+    int frames = 0, dropped = 0;
+    if (watch) {
+        session_unlock(ss);
+        watch_job(ss, conn, id, 0, &frames, &dropped);
+        session_lock(ss);
+    }
+    job_wait(ss);
+    if (ss->job.state == JOB_FAILED) return false;
+    *actRep = ss->job.endRep;
+    if (watch) snprintf(info, infoLen, " Job=%d%s Frames=%d Dropped=%d", id, ss->job.info, frames, dropped);
+    else snprintf(info, infoLen, " Job=%d%s", id, ss->job.info);
+    return true;
+}
+
+// NEW_SIM: prázdny svet H x W, alebo s world=<súbor> svet zo súboru (world.h; H W
+// v príkaze 0 0 alebo rovnaké ako v súbore); pri chybe vráti false a v err je odpoveď
+static bool new_sim_world(Session *ss, const char *opts, int H, int W, bool wt, char *err, size_t errLen) {
+    char path[PATH_MAX];
+    if (!opt_get(opts, "world", path, sizeof(path))) {
+        // s prekážkami zostaví prechody až generátor
+        if (wt ? sim_init_alloc(&ss->sim, H, W, wt) : sim_init_empty(&ss->sim, H, W, wt)) return true;
+        snprintf(err, errLen, "ERR sim_init_empty\n");
+        return false;
+    }
+    size_t lost = 0;
+    int res = world_load(&ss->sim, path, opt_int(opts, "threads", g_threads), &lost);
+    if (res == WORLD_ERR_UNREACHABLE) snprintf(err, errLen, "ERR World unreachable Cells=%zu\n", lost);
+    else if (res != WORLD_OK) snprintf(err, errLen, "ERR World %s\n", world_error_name(res));
+    else if ((H || W) && (H != ss->sim.WorldHeight || W != ss->sim.WorldWidth))
+        snprintf(err, errLen, "ERR World size %dx%d\n", ss->sim.WorldHeight, ss->sim.WorldWidth);
+    else return true;
+    sim_free(&ss->sim);
+    memset(&ss->sim, 0, sizeof(ss->sim));
+    return false;
+}
+
+static void cmd_new_sim(Session *ss, ReactorConn *conn, char *args, bool interactive) {
+    int H, W, wt, reps, K;
+    double pU, pD, pL, pR;
+    char out[256] = {0};
+    int used = 0;
+
+    int n = sscanf(args, "%d %d %d %lf %lf %lf %lf %d %d %255s%n",
+                   &H, &W, &wt,
+                   &pU, &pD, &pL, &pR,
+                   &K, &reps, out, &used);
+    if (n != 10) {
+        send_all(conn, "ERR Bad NEW_SIM params\n");
+        return;
+    }
+
+    session_lock(ss);
+    if (job_running(ss)) {
+        session_unlock(ss);
+        send_all(conn, "ERR Job running\n");
+        return;
+    }
+
+    session_reset(ss);
+    char err[64];
+    if (!new_sim_world(ss, args + used, H, W, wt != 0, err, sizeof(err))) {
+        session_unlock(ss);
+        send_all(conn, err);
+        return;
+    }
+
+    ss->sim.K = K;
+    ss->sim.Threads = opt_int(args + used, "threads", g_threads);
+    ss->sim.Kernel = opt_kernel(args + used, SIM_KERNEL_AUTO);
+    ss->sim.Estimator = opt_estimator(args + used, SIM_EST_START);
+    opt_walk_limits(args + used, &ss->sim);
+    ss->sim.StateFormat = opt_format(args + used, SIM_STATE_DWALK2);
+    opt_checkpoint(args + used, &ss->sim, 0, SERVER_CKPT_SECS);
+    char mode[16] = {0};
+    if (opt_get(args + used, "mode", mode, sizeof(mode)) && strcmp(mode, "exact") == 0) ss->sim.Mode = SIM_MODE_EXACT;
+    ss->sim.Seed = opt_u64(args + used, "seed", (uint64_t)time(NULL)); // rovnaký seed = rovnaké výsledky
+    ss->sim.MoveProbs[0] = pU;
+    ss->sim.MoveProbs[1] = pD;
+    ss->sim.MoveProbs[2] = pL;
+    ss->sim.MoveProbs[3] = pR;
+    // "-" = bez výsledkového súboru (časť koordinátora): nič sa neukladá ani necheckpointuje
+    if (strcmp(out, "-") != 0) {
+        strncpy(ss->sim.ResultFilePath, out, sizeof(ss->sim.ResultFilePath)-1);
+        checkpoint_discard(ss->sim.ResultFilePath); // staré checkpointy inej simulácie pod rovnakým menom
+    }
+
+    if (ss->sim.WorldType && !ss->sim.WorldFilePath[0]) {
+        double dens = opt_double(args + used, "density", SIM_OBSTACLE_DENSITY_DEFAULT);
+        if (!sim_generate_obstacles_connected(&ss->sim, dens, ss->sim.Seed)) {
+            session_unlock(ss);
+            send_all(conn, "ERR generate_obstacles\n");
+            return;
+        }
+    }
+
+    // rep0=N: len replikácie od N (časť simulácie rozdelenej koordinátorom, shard.h)
+    int rep0 = opt_int(args + used, "rep0", 0);
+    if (rep0 < 0) {
+        session_unlock(ss);
+        send_all(conn, "ERR Bad NEW_SIM params\n");
+        return;
+    }
+    ss->sim.ActRep = ss->sim.MaxReps = ss->sim.FirstRep = rep0;
+
+    bool exact = ss->sim.Mode == SIM_MODE_EXACT;
+    if (!exact && reps <= 0) {
+        session_unlock(ss);
+        send_all(conn, "ERR sim_run\n");
+        return;
+    }
+    if (!session_snap_new(ss)) {
+        session_unlock(ss);
+        send_all(conn, "ERR Out of memory\n");
+        return;
+    }
+    ss->initialized = true;
+    session_account(ss); // môže odložiť iné nečinné relácie na disk
+
+    char info[REPLY_INFO_MAX];
+    int actRep = 0;
+    if (!job_launch(ss, conn, interactive, exact ? JOB_KIND_EXACT : JOB_KIND_REPS, reps, ss->sim.Seed, args + used, &actRep, info, sizeof(info))) {
+        session_unlock(ss);
+        send_all(conn, exact ? "ERR sim_solve_expected\n" : "ERR sim_run\n");
+        return;
+    }
+
+    char resp[256];
+    snprintf(resp, sizeof(resp),
+             "OK NEW_SIM ActRep=%d Seed=%llu%s\n", actRep, (unsigned long long)ss->sim.Seed, info);
+    session_unlock(ss);
+
+    send_all(conn, resp);
+}
+
+static void cmd_resume_sim(Session *ss, ReactorConn *conn, char *args, bool interactive) {
+    char inFile[256] = {0};
+    int reps;
+    char outFile[256] = {0};
+    int used = 0;
+
+    int n = sscanf(args, "%255s %d %255s%n", inFile, &reps, outFile, &used);
+    if (n != 3) {
+        send_all(conn, "ERR Bad RESUME_SIM params\n");
+        return;
+    }
+
+    session_lock(ss);
+    if (job_running(ss)) {
+        session_unlock(ss);
+        send_all(conn, "ERR Job running\n");
+        return;
+    }
+
+    session_reset(ss);
+    // ak server spadol pred END_SIM, novší stav je v checkpointe vedľa súboru
+    char recovered[PATH_MAX + 8];
+    if (!checkpoint_recover(&ss->sim, inFile, recovered, sizeof(recovered))) {
+        session_unlock(ss);
+        send_all(conn, "ERR sim_load_state\n");
+        return;
+    }
+    strncpy(ss->sim.ResultFilePath, outFile, sizeof(ss->sim.ResultFilePath)-1);
+    ss->sim.Threads = opt_int(args + used, "threads", g_threads);
+    ss->sim.Kernel = opt_kernel(args + used, SIM_KERNEL_AUTO);
+    ss->sim.Estimator = opt_estimator(args + used, ss->sim.Estimator);
+    opt_walk_limits(args + used, &ss->sim);
+    ss->sim.StateFormat = opt_format(args + used, SIM_STATE_DWALK2); // DWALK1 sa tým prevedie na DWALK2
+    opt_checkpoint(args + used, &ss->sim, 0, SERVER_CKPT_SECS);
+
+    if (!session_snap_new(ss)) {
+        session_unlock(ss);
+        send_all(conn, "ERR Out of memory\n");
+        return;
+    }
+    ss->initialized = true;
+    session_account(ss); // môže odložiť iné nečinné relácie na disk
+
+    // exaktný stav sa neukladá, po načítaní sa znova vyrieši; reps=0: len prevod formátu
+    bool exact = ss->sim.Mode == SIM_MODE_EXACT;
+    char info[REPLY_INFO_MAX] = {0};
+    int actRep = ss->sim.ActRep;
+    if ((exact || reps > 0) &&
+        !job_launch(ss, conn, interactive, exact ? JOB_KIND_EXACT : JOB_KIND_REPS, reps, (uint64_t)time(NULL), args + used, &actRep, info, sizeof(info))) {
+        session_unlock(ss);
+        send_all(conn, exact ? "ERR sim_solve_expected\n" : "ERR sim_run\n");
+        return;
+    }
+
+    char resp[PATH_MAX + 256];
+    snprintf(resp, sizeof(resp),
+             "OK RESUME_SIM ActRep=%d%s%s%s\n", actRep, info,
+             recovered[0] ? " Recovered=" : "", recovered);
+    session_unlock(ss);
+
+    send_all(conn, resp);
+}
+
+// pod ss->lock: ďalšie replikácie existujúcej simulácie (RUN_MORE, RUN_UNTIL) a ich voľby;
+// pri chybe pošle ERR, odomkne a vráti false
+static bool run_prepare(Session *ss, ReactorConn *conn, const char *opts) {
+    const char *err = NULL;
+    if (!ss->initialized) err = "ERR No simulation\n";
+    else if (job_running(ss)) err = "ERR Job running\n";
+    else if (!session_resident(ss)) err = "ERR sim_load_state\n";
+    else if (ss->sim.Mode == SIM_MODE_EXACT) err = "ERR Exact mode has no replications\n";
+    if (err) {
+        session_unlock(ss);
+        send_all(conn, err);
+        return false;
+    }
+    ss->sim.Threads = opt_int(opts, "threads", ss->sim.Threads);
+    ss->sim.Kernel = opt_kernel(opts, ss->sim.Kernel);
+    ss->sim.Estimator = opt_estimator(opts, ss->sim.Estimator);
+    opt_walk_limits(opts, &ss->sim);
+    opt_checkpoint(opts, &ss->sim, ss->sim.CheckpointReps, ss->sim.CheckpointSecs);
+    return true;
+}
+
+static void cmd_run_more(Session *ss, ReactorConn *conn, char *args, bool interactive) {
+    int reps;
+    int used = 0;
+    if (sscanf(args, "%d%n", &reps, &used) != 1 || reps <= 0) {
+        send_all(conn, "ERR Bad RUN_MORE params\n");
+        return;
+    }
+
+    session_lock(ss);
+    if (!run_prepare(ss, conn, args + used)) return;
+    char info[REPLY_INFO_MAX];
+    int actRep = 0;
+    if (!job_launch(ss, conn, interactive, JOB_KIND_REPS, reps, (uint64_t)time(NULL), args + used, &actRep, info, sizeof(info))) {
+        session_unlock(ss);
+        send_all(conn, "ERR sim_run\n");
+        return;
+    }
+
+    char resp[256];
+    snprintf(resp, sizeof(resp),
+             "OK RUN_MORE ActRep=%d%s\n", actRep, info);
+    session_unlock(ss);
+
+    send_all(conn, resp);
+}
+
+// RUN_UNTIL precision=<p> [metric=avg|prob] [maxreps=N] [voľby RUN_MORE]: kolá replikácií
+// dostávajú len bunky, ktorých 95 % interval je ešte širší než p (pri avg relatívne
+// k priemeru, pri prob absolútne); skončí, keď sú presné všetky, alebo po maxreps kolách.
+// Odpoveď má Pending= (koľko buniek presnosť nedosiahlo).
+static void cmd_run_until(Session *ss, ReactorConn *conn, char *args, bool interactive) {
+    double precision = opt_double(args, "precision", 0.0);
+    int maxReps = opt_int(args, "maxreps", RUN_UNTIL_MAXREPS);
+    int metric = opt_metric(args);
+    if (!(precision > 0.0) || maxReps <= 0) {
+        send_all(conn, "ERR Bad RUN_UNTIL params\n");
+        return;
+    }
+
+    session_lock(ss);
+    if (!run_prepare(ss, conn, args)) return;
+    const char *err = NULL;
+    if (ss->sim.Estimator != SIM_EST_START) err = "ERR RUN_UNTIL needs estimator=start\n";
+    else if (metric == SIM_CI_AVG && !ss->sim.VarValid) err = "ERR No variance in state\n";
+    else if (metric == SIM_CI_AVG && ss->sim.ProbOnly) err = "ERR Probonly has no average\n";
+    if (err) {
+        session_unlock(ss);
+        send_all(conn, err);
+        return;
+    }
+    char info[REPLY_INFO_MAX];
+    int actRep = 0;
+    if (!job_launch(ss, conn, interactive, JOB_KIND_UNTIL, maxReps, (uint64_t)time(NULL), args, &actRep, info, sizeof(info))) {
+        session_unlock(ss);
+        send_all(conn, "ERR sim_run\n");
+        return;
+    }
+
+    char resp[256];
+    snprintf(resp, sizeof(resp),
+             "OK RUN_UNTIL ActRep=%d%s\n", actRep, info);
+    session_unlock(ss);
+
+    send_all(conn, resp);
+}
+
+// SET_MODE 1: NEW_SIM/RESUME_SIM/RUN_MORE/RUN_UNTIL tohto spojenia čakajú na koniec behu a dovtedy
+// posielajú zábery (FRAME ...), odpoveď OK príde až za nimi
+static void cmd_set_mode(ClientData *cd, ReactorConn *conn, char *args) {
+    int m;
+    if (sscanf(args, "%d", &m) != 1 || (m != 0 && m != 1)) {
+        send_all(conn, "ERR Bad SET_MODE\n");
+        return;
+    }
+
+    cd->SimMode = m == 1;
+
+    send_all(conn, "OK SET_MODE\n");
+}
+
+// WATCH [frames=N]: zábery bežiaceho jobu relácie (aj spusteného iným spojením) do jeho
+// konca alebo N záberov, potom OK WATCH
+static void cmd_watch(Session *ss, ReactorConn *conn, char *args) {
+    session_lock(ss);
+    bool running = job_running(ss) && !ss->job.exact;
+    int id = ss->job.id;
+    session_unlock(ss);
+    if (!running) {
+        send_all(conn, "ERR No job running\n");
+        return;
+    }
+
+    int frames = 0, dropped = 0;
+    if (!watch_job(ss, conn, id, opt_int(args, "frames", 0), &frames, &dropped)) return;
+    char line[128];
+    snprintf(line, sizeof(line), "OK WATCH Job=%d Frames=%d Dropped=%d\n", id, frames, dropped);
+    send_all(conn, line);
+}
+
+// podiel cenzurovaných vzoriek (limit krokov alebo probonly)
+static double censored_rate(const Sim *s) {
+    uint64_t all = 0;
+    uint64_t cens = sim_censored_total(s, &all);
+    return all ? (double)cens / (double)all : 0.0;
+}
+
+// Sumár z poslednej zverejnenej snímky: počas behu nečaká na simuláciu a pomalý
+// klient nebrzdí nikoho iného (snímka sa kvôli nemu neprepíše).
+typedef struct SummarySnap {
+    int H, W, K, ActRep;
+    double censored;
+    uint8_t *obstacle;              // 1 = prekážka
+    double *avg, *prob;             // NULL, ak sa nepýtali
+} SummarySnap;
+
+static void summary_free(SummarySnap *snap) {
+    free(snap->obstacle);
+    free(snap->avg);
+    free(snap->prob);
+    memset(snap, 0, sizeof(*snap));
+}
+
+// vráti NULL pri úspechu, inak text chyby pre klienta
+static const char *summary_snapshot(Session *ss, SummarySnap *snap, bool wantAvg, bool wantProb) {
+    memset(snap, 0, sizeof(*snap));
+    SimSnapshot *sn = session_snap_get(ss);
+    if (!sn) return "ERR No simulation\n";
+    const Sim *v = &sn->view;
+    snap->H = v->WorldHeight;
+    snap->W = v->WorldWidth;
+    snap->K = v->K;
+    snap->ActRep = v->ActRep;
+    snap->censored = censored_rate(v);
+    size_t n = (size_t)snap->H * (size_t)snap->W;
+    snap->obstacle = (uint8_t*)malloc(n);
+    if (wantAvg) snap->avg = (double*)malloc(n * sizeof(double));
+    if (wantProb) snap->prob = (double*)malloc(n * sizeof(double));
+    if (!snap->obstacle || (wantAvg && !snap->avg) || (wantProb && !snap->prob)) {
+        snapshot_release(sn);
+        summary_free(snap);
+        return "ERR Out of memory\n";
+    }
+    for (size_t i = 0; i < n; i++) {
+        bool x = sim_cell_obstacle(v, i);
+        snap->obstacle[i] = x;
+        if (snap->avg) snap->avg[i] = x ? 0.0 : sim_cell_avg(v, i);
+        if (snap->prob) snap->prob[i] = x ? 0.0 : sim_cell_prob(v, i);
+    }
+    snapshot_release(sn);
+    return NULL;
+}
+
+#define SUMMARY_CHUNK (64 * 1024)
+#define SUMMARY_CELL_MAX 400        // "%.1f " najväčšieho double (DBL_MAX má 309 číslic)
+
+static int send_chunk(ReactorConn *conn, char *buf, size_t len) {
+    buf[len] = '\0';
+    return send_all(conn, buf);
+}
+
+// Textová mriežka po riadkoch; bunky sa skladajú s posúvaným offsetom (nie strcat)
+// a odchádzajú po ~64 KB aj uprostred riadku, takže šírka sveta ani veľkosť hodnoty
+// (nekonvergované exaktné riešenie) buffer nepretečie.
+static void send_grid(ReactorConn *conn, const SummarySnap *snap, const double *val, const char *fmt) {
+    size_t cap = SUMMARY_CHUNK + SUMMARY_CELL_MAX + 2; // + '\n' a '\0'
+    char *buf = (char*)malloc(cap);
+    if (!buf) return;
+    size_t pos = 0;
+    bool ok = true;
+    for (int r = 0; ok && r < snap->H; r++) {
+        for (int c = 0; ok && c < snap->W; c++) {
+            size_t i = (size_t)r * (size_t)snap->W + (size_t)c;
+            if (snap->obstacle[i]) {
+                memcpy(buf + pos, "X ", 2);
+                pos += 2;
+            } else {
+                size_t room = cap - pos - 2;
+                int len = snprintf(buf + pos, room, fmt, val[i]);
+                if (len < 0) len = 0;
+                pos += (size_t)len < room ? (size_t)len : room - 1; // orezaná hodnota ostane v buffri
+            }
+            if (pos >= SUMMARY_CHUNK) {
+                ok = send_chunk(conn, buf, pos) == 0;
+                pos = 0;
+            }
+        }
+        buf[pos++] = '\n';
+        if (ok && (pos >= SUMMARY_CHUNK || r == snap->H - 1)) {
+            ok = send_chunk(conn, buf, pos) == 0;
+            pos = 0;
+        }
+    }
+    free(buf);
+}
+
+static void cmd_get_summary_avg(Session *ss, ReactorConn *conn) {
+    SummarySnap snap;
+    const char *err = summary_snapshot(ss, &snap, true, false);
+    if (err) {
+        send_all(conn, err);
+        return;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "OK SUMMARY_AVG H=%d W=%d ActRep=%d Censored=%.6f\n",
+             snap.H, snap.W, snap.ActRep, snap.censored);
+    send_all(conn, line);
+    send_grid(conn, &snap, snap.avg, "%.1f ");
+    summary_free(&snap);
+}
+
+static void cmd_get_summary_prob(Session *ss, ReactorConn *conn) {
+    SummarySnap snap;
+    const char *err = summary_snapshot(ss, &snap, false, true);
+    if (err) {
+        send_all(conn, err);
+        return;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "OK SUMMARY_PROB H=%d W=%d K=%d ActRep=%d Censored=%.6f\n",
+             snap.H, snap.W, snap.K, snap.ActRep, snap.censored);
+    send_all(conn, line);
+    send_grid(conn, &snap, snap.prob, "%.2f ");
+    summary_free(&snap);
+}
+
+// Binárny sumár: textová hlavička a za ňou rámce [u32 typ][u32 veľkosť prvku][u64 dĺžka]
+// + surové little-endian pole, ukončené rámcom typu SUMMARY_FRAME_END. Celá odpoveď
+// ide do výstupu spojenia priamo zo snímky (f64) alebo z jej kópie vo f32.
+enum {
+    SUMMARY_FRAME_END = 0,
+    SUMMARY_FRAME_OBSTACLE = 1,     // u8
+    SUMMARY_FRAME_AVG = 2,          // f32/f64
+    SUMMARY_FRAME_PROB = 3
+};
+
+typedef struct SummaryFrame {
+    uint32_t type;
+    uint32_t elemSize;
+    uint64_t length;
+} SummaryFrame;
+
+static int writev_all(ReactorConn *conn, const struct iovec *iov, int cnt) {
+    for (int k = 0; k < cnt; k++) {
+        if (send_bytes(conn, iov[k].iov_base, iov[k].iov_len) != 0) return -1;
+    }
+    return 0;
+}
+
+static void cmd_get_summary_bin(Session *ss, ReactorConn *conn, char *args) {
+    bool f32 = strstr(args, "f32") != NULL; // predvolene f64 (bez straty presnosti)
+    SummarySnap snap;
+    const char *err = summary_snapshot(ss, &snap, true, true);
+    if (err) {
+        send_all(conn, err);
+        return;
+    }
+    size_t n = (size_t)snap.H * (size_t)snap.W;
+    size_t elem = f32 ? sizeof(float) : sizeof(double);
+
+    const void *avg = snap.avg, *prob = snap.prob;
+    float *conv = NULL;
+    if (f32) {
+        conv = (float*)malloc(2 * n * sizeof(float));
+        if (!conv) {
+            summary_free(&snap);
+            send_all(conn, "ERR Out of memory\n");
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            conv[i] = (float)snap.avg[i];
+            conv[n + i] = (float)snap.prob[i];
+        }
+        avg = conv;
+        prob = conv + n;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "OK SUMMARY_BIN H=%d W=%d K=%d ActRep=%d Censored=%.6f Elem=%s\n",
+             snap.H, snap.W, snap.K, snap.ActRep, snap.censored, f32 ? "f32" : "f64");
+    SummaryFrame fr[4] = {
+        {SUMMARY_FRAME_OBSTACLE, 1, n},
+        {SUMMARY_FRAME_AVG, (uint32_t)elem, n * elem},
+        {SUMMARY_FRAME_PROB, (uint32_t)elem, n * elem},
+        {SUMMARY_FRAME_END, 0, 0}
+    };
+    struct iovec iov[8] = {
+        {line, strlen(line)},
+        {&fr[0], sizeof(SummaryFrame)}, {snap.obstacle, n},
+        {&fr[1], sizeof(SummaryFrame)}, {(void*)avg, n * elem},
+        {&fr[2], sizeof(SummaryFrame)}, {(void*)prob, n * elem},
+        {&fr[3], sizeof(SummaryFrame)}
+    };
+    writev_all(conn, iov, 8);
+    free(conv);
+    summary_free(&snap);
+}
+
+// prúd codec do výstupu spojenia
+static bool summary_sink(void *conn, const void *data, size_t len) {
+    return send_bytes((ReactorConn*)conn, data, len) == 0;
+}
+
+// Kompaktný sumár: hlavička ako text, za ňou prúd codec (prekážky, steps, hits,
+// samples, censored), z ktorého si klient spočíta priemer aj pravdepodobnosť sám.
+static void cmd_get_summary_z(Session *ss, ReactorConn *conn) {
+    SimSnapshot *sn = session_snap_get(ss);
+    if (!sn) {
+        send_all(conn, "ERR No simulation\n");
+        return;
+    }
+    const Sim *v = &sn->view;
+    if (v->Mode == SIM_MODE_EXACT) {
+        snapshot_release(sn);
+        send_all(conn, "ERR Exact mode has no counters\n");
+        return;
+    }
+    int H = v->WorldHeight;
+    int W = v->WorldWidth;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "OK SUMMARY_Z H=%d W=%d K=%d ActRep=%d Censored=%.6f\n",
+             H, W, v->K, v->ActRep, censored_rate(v));
+    send_all(conn, line);
+
+    // snímka sa počas posielania nemení, kóduje sa priamo z nej
+    CodecWriter w;
+    if (codec_writer_init(&w, summary_sink, conn)) {
+        bool ok = state_put_arrays(&w, v, false);
+        if (!codec_writer_finish(&w) || !ok) fprintf(stderr, "GET_SUMMARY_Z: odoslanie zlyhalo\n");
+    }
+    snapshot_release(sn);
+}
+
+// EXPORT_STATE: sumy simulácie na zlúčenie inde (MERGE_STATE, koordinátor, shard.h).
+// Hlavička s parametrami, za ňou prúd codec ako GET_SUMMARY_Z a pri VarValid ešte m2
+// ako bity double (bez straty). Posiela sa zo snímky bez zámku relácie; po dobehnutí
+// behu (aj zlúčení) je zverejnená snímka celý stav.
+static void cmd_export_state(Session *ss, ReactorConn *conn) {
+    session_lock(ss);
+    const char *err = NULL;
+    if (!ss->initialized) err = "ERR No simulation\n";
+    else if (job_running(ss)) err = "ERR Job running\n";
+    else if (!session_resident(ss)) err = "ERR sim_load_state\n";
+    else if (ss->sim.Mode == SIM_MODE_EXACT) err = "ERR Exact mode has no counters\n";
+    session_unlock(ss);
+    SimSnapshot *sn = err ? NULL : session_snap_get(ss);
+    if (!err && !sn) err = "ERR No simulation\n";
+    if (err) {
+        send_all(conn, err);
+        return;
+    }
+
+    const Sim *v = &sn->view;
+    int H = v->WorldHeight;
+    int W = v->WorldWidth;
+    char line[512];
+    snprintf(line, sizeof(line),
+             "OK EXPORT_STATE H=%d W=%d K=%d Seed=%llu Rep0=%d ActRep=%d MaxSteps=%u ProbOnly=%d "
+             "Estimator=%d WorldType=%d VarValid=%d Probs=%.17g,%.17g,%.17g,%.17g\n",
+             H, W, v->K, (unsigned long long)v->Seed, v->FirstRep, v->ActRep, v->MaxSteps,
+             v->ProbOnly ? 1 : 0, v->Estimator, v->WorldType ? 1 : 0, v->VarValid ? 1 : 0,
+             v->MoveProbs[0], v->MoveProbs[1], v->MoveProbs[2], v->MoveProbs[3]);
+    if (send_all(conn, line) == 0) {
+        CodecWriter w;
+        if (codec_writer_init(&w, summary_sink, conn)) {
+            bool ok = state_put_arrays(&w, v, v->VarValid);
+            if (!codec_writer_finish(&w) || !ok) fprintf(stderr, "EXPORT_STATE: odoslanie zlyhalo\n");
+        }
+    }
+    snapshot_release(sn);
+}
+
+// MERGE_STATE host port [session=N]: pripočíta sumy simulácie z iného servera (jeho
+// EXPORT_STATE, pri session= z danej relácie) k tejto; časť musí mať rovnaký svet, parametre
+// aj seed a nadväzovať na ňu (jej rep0 == ActRep). Sťahuje sa bez zámku relácie.
+static void cmd_merge_state(Session *ss, ReactorConn *conn, char *args) {
+    char host[64];
+    int port = 0;
+    int used = 0;
+    if (sscanf(args, "%63s %d%n", host, &port, &used) != 2 || port <= 0) {
+        send_all(conn, "ERR Bad MERGE_STATE params\n");
+        return;
+    }
+    int from = opt_int(args + used, "session", 0);
+    reactor_detach(conn);           // sťahovanie z iného servera môže trvať
+
+    RwClient c;
+    RwReply r;
+    RwState st;
+    memset(&st, 0, sizeof(st));
+    if (!rwc_connect(&c, host, port)) {
+        send_all(conn, "ERR Merge connect\n");
+        return;
+    }
+    bool attached = true;
+    if (from > 0) {
+        rwc_attach(&c, from);
+        attached = rwc_reply(&c, &r) && r.ok;
+    }
+    bool ok = false;
+    if (attached) {
+        rwc_export_state(&c);
+        ok = rwc_read_state(&c, &st, &r) && r.ok;
+    }
+    rwc_quit(&c);
+    rwc_reply(&c, &r);
+    rwc_close(&c);
+    if (!ok) {
+        rwc_state_free(&st);
+        send_all(conn, attached ? "ERR Merge export\n" : "ERR Merge session\n");
+        return;
+    }
+
+    session_lock(ss);
+    if (!run_prepare(ss, conn, "")) {
+        rwc_state_free(&st);
+        return;
+    }
+    char err[64];
+    if (!shard_merge(&ss->sim, &st, err, sizeof(err))) {
+        session_unlock(ss);
+        rwc_state_free(&st);
+        char resp[96];
+        snprintf(resp, sizeof(resp), "ERR %s\n", err);
+        send_all(conn, resp);
+        return;
+    }
+    rwc_state_free(&st);
+    snapshots_publish(ss->sim.Publish, &ss->sim);
+    char resp[128];
+    snprintf(resp, sizeof(resp), "OK MERGE_STATE ActRep=%d\n", ss->sim.ActRep);
+    session_unlock(ss);
+
+    send_all(conn, resp);
+}
+
+// priebeh jobu: počas behu z poslednej snímky, po skončení z jobu
+static void job_progress(Session *ss, const Job *j, int *rep, uint64_t *steps, double *t) {
+    *rep = j->endRep;
+    *steps = j->endSteps;
+    *t = j->endTime;
+    if (j->state != JOB_RUNNING) return;
+    SimSnapshot *sn = session_snap_get(ss);
+    if (sn && sn->published >= j->startTime) {
+        *rep = sn->view.ActRep;
+        *steps = steps_total(&sn->view);
+        *t = sn->published;
+    }
+    snapshot_release(sn);
+}
+
+static void cmd_job_status(Session *ss, ReactorConn *conn) {
+    session_lock(ss);
+    Job j = ss->job;
+    session_unlock(ss);
+    if (j.id == 0) {
+        send_all(conn, "OK JOB_STATUS State=idle\n");
+        return;
+    }
+
+    int rep;
+    uint64_t steps;
+    double t;
+    job_progress(ss, &j, &rep, &steps, &t);
+    double dt = t - j.startTime;
+    double repsPerSec = dt > 0 ? (double)(rep - j.startRep) / dt : 0.0;
+    double stepsPerSec = dt > 0 ? (double)(steps - j.startSteps) / dt : 0.0;
+    int target = j.exact ? 0 : j.startRep + j.reps;
+    double eta = 0.0;
+    if (j.state == JOB_RUNNING) eta = (!j.exact && repsPerSec > 0) ? (double)(target - rep) / repsPerSec : -1.0;
+    double elapsed = (j.state == JOB_RUNNING ? now_sec() : j.endTime) - j.startTime;
+
+    char line[512];
+    snprintf(line, sizeof(line),
+             "OK JOB_STATUS Job=%d State=%s ActRep=%d Target=%d RepsPerSec=%.3f StepsPerSec=%.4g ETA=%.1f Elapsed=%.1f%s\n",
+             j.id, JOB_STATE_NAMES[j.state], rep, target, repsPerSec, stepsPerSec, eta, elapsed, j.info);
+    send_all(conn, line);
+}
+
+static void cmd_cancel(Session *ss, ReactorConn *conn) {
+    session_lock(ss);
+    if (!job_running(ss)) {
+        session_unlock(ss);
+        send_all(conn, "ERR No job running\n");
+        return;
+    }
+    // sim_run skončí po dokončení rozbehnutej replikácie (riešič sa nepreruší)
+    __atomic_store_n(&ss->sim.SimEnd, true, __ATOMIC_RELAXED);
+    char line[64];
+    snprintf(line, sizeof(line), "OK CANCEL Job=%d\n", ss->job.id);
+    session_unlock(ss);
+    send_all(conn, line);
+}
+
+// Príkazy v poradí indexov počítadiel (stats.h); posledný sú neznáme príkazy.
+static const char *const COMMAND_NAMES[] = {
+    "NEW_SIM", "RESUME_SIM", "RUN_MORE", "RUN_UNTIL", "SET_MODE", "WATCH",
+    "GET_SUMMARY_AVG", "GET_SUMMARY_PROB", "GET_SUMMARY_BIN", "GET_SUMMARY_Z",
+    "JOB_STATUS", "CANCEL", "END_SIM", "OPEN", "ATTACH", "CLOSE", "STATS",
+    "EXPORT_STATE", "MERGE_STATE", "QUIT", "UNKNOWN"
+};
+#define COMMAND_COUNT (int)(sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]))
+#define STATS_TEXT_MAX (16 * 1024)
+
+static int command_index(const char *cmd) {
+    for (int k = 0; k < COMMAND_COUNT - 1; k++) {
+        if (strcmp(cmd, COMMAND_NAMES[k]) == 0) return k;
+    }
+    return COMMAND_COUNT - 1;
+}
+
+// časy (ns) sa vypisujú v us s príponou Us v mene kľúča
+static size_t text_hist(char *buf, size_t cap, const char *label, const StatsHist *h, bool ns) {
+    double unit = ns ? 1e3 : 1.0;
+    const char *u = ns ? "Us" : "";
+    return (size_t)snprintf(buf, cap, "%s Count=%llu Mean%s=%.1f P50%s=%.1f P99%s=%.1f Max%s=%.1f",
+                            label, (unsigned long long)h->count,
+                            u, h->count ? (double)h->sum / (double)h->count / unit : 0.0,
+                            u, (double)stats_quantile(h, 0.5) / unit, u, (double)stats_quantile(h, 0.99) / unit,
+                            u, (double)h->max / unit);
+}
+
+// Riadky STATS za hlavičkou: príkazy (časy, bajty odpovedí), zámok relácie,
+// dĺžky prechádzok v krokoch a ich log2 histogram (horná hranica koša = počet).
+// Vráti počet riadkov; text sa pri malom buffri oreže na celé riadky.
+static int stats_text(char *buf, size_t cap, const StatsTotals *t) {
+    char line[1024];
+    size_t pos = 0;
+    int lines = 0;
+    buf[0] = '\0';
+    for (int k = 0; k < COMMAND_COUNT + 4; k++) {
+        size_t n = 0;
+        if (k < COMMAND_COUNT) {
+            const StatsHist *h = &t->command[k];
+            if (h->count == 0) continue;
+            char label[64];
+            snprintf(label, sizeof(label), "CMD %s", COMMAND_NAMES[k]);
+            n = text_hist(line, sizeof(line), label, h, true);
+            n += (size_t)snprintf(line + n, sizeof(line) - n, " Bytes=%llu BytesPerCall=%.0f",
+                                  (unsigned long long)t->commandBytes[k], (double)t->commandBytes[k] / (double)h->count);
+        } else if (k == COMMAND_COUNT) {
+            n = text_hist(line, sizeof(line), "LOCK Wait", &t->lockWait, true);
+        } else if (k == COMMAND_COUNT + 1) {
+            n = text_hist(line, sizeof(line), "LOCK Hold", &t->lockHold, true);
+        } else if (k == COMMAND_COUNT + 2) {
+            n = text_hist(line, sizeof(line), "WALKS", &t->walkLen, false);
+        } else {
+            n = (size_t)snprintf(line, sizeof(line), "WALKLEN");
+            for (int b = 0; b < STATS_BUCKETS && n < sizeof(line) - 48; b++) {
+                if (!t->walkLen.bucket[b]) continue;
+                unsigned long long top = b == 0 ? 0 : (1ull << b) - 1;
+                n += (size_t)snprintf(line + n, sizeof(line) - n, " %llu=%llu", top,
+                                      (unsigned long long)t->walkLen.bucket[b]);
+            }
+        }
+        if (n >= sizeof(line) - 1 || pos + n + 2 > cap) break;
+        memcpy(buf + pos, line, n);
+        pos += n;
+        buf[pos++] = '\n';
+        buf[pos] = '\0';
+        lines++;
+    }
+    return lines;
+}
+
+// STATS: súhrn za celý server (všetky relácie a spojenia) od štartu, StepsPerSec je
+// aktuálny beh relácie spojenia (0 ak nebeží). Za hlavičkou nasleduje Lines= riadkov.
+static void cmd_stats(Session *ss, ReactorConn *conn) {
+    StatsTotals t;
+    stats_read(&t);
+    char *body = (char*)malloc(STATS_TEXT_MAX);
+    if (!body) {
+        send_all(conn, "ERR Out of memory\n");
+        return;
+    }
+    int lines = stats_text(body, STATS_TEXT_MAX, &t);
+
+    session_lock(ss);
+    Job j = ss->job;
+    session_unlock(ss);
+    double stepsPerSec = 0.0;
+    if (j.state == JOB_RUNNING) {
+        int rep;
+        uint64_t steps;
+        double at;
+        job_progress(ss, &j, &rep, &steps, &at);
+        if (at > j.startTime) stepsPerSec = (double)(steps - j.startSteps) / (at - j.startTime);
+    }
+
+    char line[512];
+    snprintf(line, sizeof(line),
+             "OK STATS Lines=%d Uptime=%.1f Connections=%llu Accepted=%llu Walks=%llu Steps=%llu StepsPerSec=%.4g Sent=%llu\n",
+             lines, now_sec() - g_start, (unsigned long long)(t.opened - t.closed), (unsigned long long)t.opened,
+             (unsigned long long)t.walkLen.count, (unsigned long long)t.walkLen.sum, stepsPerSec,
+             (unsigned long long)t.sent);
+    if (send_all(conn, line) == 0) send_all(conn, body);
+    free(body);
+}
+
+// Periodický výpis STATS na stdout každých secs sekúnd (5. argument servera);
+// StepsPerSec je tu za celý server od predchádzajúceho výpisu.
+static void *stats_log_main(void *arg) {
+    int secs = *(int*)arg;
+    char *body = (char*)malloc(STATS_TEXT_MAX);
+    if (!body) return NULL;
+    StatsTotals *t = (StatsTotals*)malloc(sizeof(StatsTotals));
+    if (!t) {
+        free(body);
+        return NULL;
+    }
+    uint64_t prevSteps = 0;
+    double prev = now_sec();
+    for (;;) {
+        sleep((unsigned)secs);
+        stats_read(t);
+        double now = now_sec();
+        stats_text(body, STATS_TEXT_MAX, t);
+        printf("STATS Uptime=%.1f Connections=%llu Accepted=%llu Walks=%llu Steps=%llu StepsPerSec=%.4g Sent=%llu\n%s",
+               now - g_start, (unsigned long long)(t->opened - t->closed), (unsigned long long)t->opened,
+               (unsigned long long)t->walkLen.count, (unsigned long long)t->walkLen.sum,
+               now > prev ? (double)(t->walkLen.sum - prevSteps) / (now - prev) : 0.0,
+               (unsigned long long)t->sent, body);
+        fflush(stdout);
+        prevSteps = t->walkLen.sum;
+        prev = now;
+    }
+    return NULL;
+}
+
+// pod ss->lock: ukončí beh a uloží výsledok do ResultFilePath (END_SIM, CLOSE)
+static void session_finish(Session *ss) {
+    if (job_running(ss)) {
+        // rozbehnutý beh sa ukončí na hranici replikácie a uloží sa, čo je hotové
+        __atomic_store_n(&ss->sim.SimEnd, true, __ATOMIC_RELAXED);
+        job_wait(ss);
+    }
+    // bez ResultFilePath (NEW_SIM s "-") sa výsledok neukladá
+    if (ss->initialized && ss->sim.ResultFilePath[0] && session_resident(ss)) {
+        const char *path = ss->sim.ResultFilePath;
+        if (sim_save_state(&ss->sim, path)) checkpoint_discard(path); // výsledok je novší než checkpointy
+    }
+    session_reset(ss);
+}
+
+static void cmd_end_sim(Session *ss, ReactorConn *conn) {
+    session_lock(ss);
+    if (job_running(ss)) reactor_detach(conn); // čaká sa na koniec replikácie
+    session_finish(ss);
+    session_unlock(ss);
+
+    send_all(conn, "OK END_SIM\n");
+}
+
+// OPEN: nová relácia, spojenie sa na ňu prepne
+static void cmd_open(Session **cur, ReactorConn *conn) {
+    Session *ss = session_open();
+    if (!ss) {
+        send_all(conn, "ERR Too many sessions\n");
+        return;
+    }
+    session_release(*cur);
+    *cur = ss;
+    char line[64];
+    snprintf(line, sizeof(line), "OK OPEN Session=%d\n", ss->id);
+    send_all(conn, line);
+}
+
+// ATTACH <id>: prepne spojenie na existujúcu reláciu (aj z iného spojenia)
+static void cmd_attach(Session **cur, ReactorConn *conn, char *args) {
+    int id;
+    if (sscanf(args, "%d", &id) != 1) {
+        send_all(conn, "ERR Bad ATTACH params\n");
+        return;
+    }
+    Session *ss = session_attach(id);
+    if (!ss) {
+        send_all(conn, "ERR No such session\n");
+        return;
+    }
+    session_release(*cur);
+    *cur = ss;
+    char line[64];
+    snprintf(line, sizeof(line), "OK ATTACH Session=%d\n", ss->id);
+    send_all(conn, line);
+}
+
+// CLOSE [id]: ukončí beh ako END_SIM a vyradí reláciu; bez id aktuálnu
+static void cmd_close(Session **cur, ReactorConn *conn, char *args) {
+    int id;
+    Session *ss = NULL;
+    if (sscanf(args, "%d", &id) == 1) {
+        ss = session_attach(id);
+    } else {
+        ss = *cur;
+        session_retain(ss);
+    }
+    if (!ss) {
+        send_all(conn, "ERR No such session\n");
+        return;
+    }
+    if (ss->id == SESSION_DEFAULT) {
+        session_release(ss);
+        send_all(conn, "ERR Default session\n");
+        return;
+    }
+
+    // closed sa nastaví pod ss->lock, nový job v zatvorenej relácii už nevznikne
+    session_lock(ss);
+    session_close(ss);
+    if (job_running(ss)) reactor_detach(conn);
+    session_finish(ss);
+    session_unlock(ss);
+
+    char line[64];
+    snprintf(line, sizeof(line), "OK CLOSE Session=%d\n", ss->id);
+    if (*cur == ss) {
+        session_release(*cur);
+        *cur = session_attach(SESSION_DEFAULT);
+    }
+    session_release(ss);
+    send_all(conn, line);
+}
+
+// Spojenie v reaktore (reactor.h): reaktor skladá riadky, príkazy jedného
+// spojenia vykonáva pracovné vlákno postupne, preto ss netreba zamykať.
+typedef struct Client {
+    Session *ss;                    // aktuálna relácia (OPEN/ATTACH ju menia)
+    ClientData cd;                  // SET_MODE
+} Client;
+
+static void *client_open(ReactorConn *conn) {
+    Client *cl = (Client*)calloc(1, sizeof(Client));
+    if (!cl) return NULL;
+    cl->ss = session_attach(SESSION_DEFAULT);
+    stats_connection(true);
+    send_all(conn, "HELLO RandomWalkServer\n");
+    return cl;
+}
+
+static void client_close(void *user) {
+    Client *cl = (Client*)user;
+    session_release(cl->ss);
+    free(cl);
+    stats_connection(false);
+}
+
+static bool client_dispatch(Client *cl, ReactorConn *conn, const char *cmd, char *args) {
+    if (strcmp(cmd, "OPEN") == 0) {
+        cmd_open(&cl->ss, conn);
+        return true;
+    } else if (strcmp(cmd, "ATTACH") == 0) {
+        cmd_attach(&cl->ss, conn, args);
+        return true;
+    } else if (strcmp(cmd, "CLOSE") == 0) {
+        cmd_close(&cl->ss, conn, args);
+        return true;
+    }
+    Session *ss = cl->ss;
+    if (!session_touch(ss)) {
+        // reláciu zatvorilo iné spojenie
+        session_release(ss);
+        cl->ss = session_attach(SESSION_DEFAULT);
+        send_all(conn, "ERR Session closed\n");
+        return true;
+    }
+
+    if (strcmp(cmd, "NEW_SIM") == 0) {
+        cmd_new_sim(ss, conn, args, cl->cd.SimMode);
+    } else if (strcmp(cmd, "RESUME_SIM") == 0) {
+        cmd_resume_sim(ss, conn, args, cl->cd.SimMode);
+    } else if (strcmp(cmd, "RUN_MORE") == 0) {
+        cmd_run_more(ss, conn, args, cl->cd.SimMode);
+    } else if (strcmp(cmd, "RUN_UNTIL") == 0) {
+        cmd_run_until(ss, conn, args, cl->cd.SimMode);
+    } else if (strcmp(cmd, "SET_MODE") == 0) {
+        cmd_set_mode(&cl->cd, conn, args);
+    } else if (strcmp(cmd, "WATCH") == 0) {
+        cmd_watch(ss, conn, args);
+    } else if (strcmp(cmd, "GET_SUMMARY_AVG") == 0) {
+        cmd_get_summary_avg(ss, conn);
+    } else if (strcmp(cmd, "GET_SUMMARY_PROB") == 0) {
+        cmd_get_summary_prob(ss, conn);
+    } else if (strcmp(cmd, "GET_SUMMARY_BIN") == 0) {
+        cmd_get_summary_bin(ss, conn, args);
+    } else if (strcmp(cmd, "GET_SUMMARY_Z") == 0) {
+        cmd_get_summary_z(ss, conn);
+    } else if (strcmp(cmd, "JOB_STATUS") == 0) {
+        cmd_job_status(ss, conn);
+    } else if (strcmp(cmd, "CANCEL") == 0) {
+        cmd_cancel(ss, conn);
+    } else if (strcmp(cmd, "END_SIM") == 0) {
+        cmd_end_sim(ss, conn);
+    } else if (strcmp(cmd, "STATS") == 0) {
+        cmd_stats(ss, conn);
+    } else if (strcmp(cmd, "EXPORT_STATE") == 0) {
+        cmd_export_state(ss, conn);
+    } else if (strcmp(cmd, "MERGE_STATE") == 0) {
+        cmd_merge_state(ss, conn, args);
+    } else if (strcmp(cmd, "QUIT") == 0) {
+        send_all(conn, "OK BYE\n");
+        return false;
+    } else {
+        send_all(conn, "ERR Unknown command\n");
+    }
+    return true;
+}
+
+static bool client_command(void *user, ReactorConn *conn, char *line) {
+    char cmd[64] = {0};
+    char *args = NULL;
+
+    char *space = strchr(line, ' ');
+    if (space) {
+        size_t len = (size_t)(space - line);
+        if (len >= sizeof(cmd)) len = sizeof(cmd)-1;
+        memcpy(cmd, line, len);
+        cmd[len] = '\0';
+        args = space + 1;
+    } else {
+        strncpy(cmd, line, sizeof(cmd)-1);
+        args = line + strlen(line);
+    }
+
+    // čas a bajty odpovede príkazu (na tomto vlákne beží celý, aj s wait=1 behom)
+    uint64_t t0 = stats_now_ns(), sent0 = stats_sent_mine();
+    bool keep = client_dispatch((Client*)user, conn, cmd, args);
+    stats_command(command_index(cmd), stats_now_ns() - t0, stats_sent_mine() - sent0);
+    return keep;
+}
+
+int main(int argc, char *argv[]) {
+    int port = DEFAULT_PORT;
+    if (argc >= 2) {
+        port = atoi(argv[1]);
+        if (port <= 0) port = DEFAULT_PORT;
+    }
+    if (argc >= 3) {
+        g_threads = atoi(argv[2]);
+        if (g_threads < 0) g_threads = 0;
+    }
+    size_t memLimit = 0;            // MB pre všetky relácie spolu (0=bez limitu)
+    if (argc >= 4) memLimit = (size_t)strtoull(argv[3], NULL, 10) << 20;
+    int workers = SERVER_WORKERS;   // súbežne vykonávané príkazy (behy jobov sú mimo nich)
+    if (argc >= 5 && atoi(argv[4]) > 0) workers = atoi(argv[4]);
+    static int statsSecs = 0;       // periodický výpis STATS (0=nie)
+    if (argc >= 6 && atoi(argv[5]) > 0) statsSecs = atoi(argv[5]);
+    if (argc >= 7 && !shards_parse(&g_shards, argv[6])) {
+        fprintf(stderr, "Bad shard list (host:port,host:port,...)\n");
+        return 1;
+    }
+    g_port = port;
+    g_start = now_sec();
+
+    // odpoveď zavretému klientovi je chyba send, nie koniec servera
+    signal(SIGPIPE, SIG_IGN);
+    // tisíce spojení potrebujú tisíce deskriptorov
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), SERVER_EVICT_PREFIX "%d_", port);
+    if (!sessions_init(memLimit, prefix, SERVER_SNAPSHOT_MS)) {
+        fprintf(stderr, "Failed to init sessions\n");
+        return 1;
+    }
+
+    int passive = passive_socket_init(port);
+    if (passive < 0) {
+        fprintf(stderr, "Failed to init server socket\n");
+        return 1;
+    }
+
+    printf("Server listening on port %d (threads=%d, mem=%zu MB, workers=%d, stats=%d s, shards=%d)\n",
+           port, g_threads, memLimit >> 20, workers, statsSecs, g_shards.count);
+    if (statsSecs > 0) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, stats_log_main, &statsSecs) == 0) pthread_detach(tid);
+    }
+
+    // spojenia obsluhuje reaktor, počet vlákien nezávisí od počtu klientov
+    ReactorOps ops = {client_open, client_command, client_close};
+    if (!reactor_run(passive, workers, &ops)) {
+        passive_socket_destroy(passive);
+        return 1;
+    }
+
+    passive_socket_destroy(passive);
+    return 0;
+}
+
@@ -0,0 +1,334 @@
+// session.c - tabuľka relácií servera, LRU odkladanie na disk
+#include "session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+static pthread_mutex_t g_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static Session *g_table[SESSION_MAX];
+static int g_next_id = SESSION_DEFAULT;
+static uint64_t g_tick;
+static size_t g_mem_limit;
+static char g_evict_prefix[PATH_MAX];
+static int g_snapshot_ms;
+
+static void session_free(Session *ss) {
+    if (ss->evicted) unlink(ss->evictPath);
+    session_snap_replace(ss, NULL);
+    sim_free(&ss->sim);
+    trace_destroy(ss->trace);
+    pthread_mutex_destroy(&ss->lock);
+    pthread_cond_destroy(&ss->jobCond);
+    pthread_mutex_destroy(&ss->snapLock);
+    free(ss);
+}
+
+// pod zámkom tabuľky
+static Session *session_new_locked(void) {
+    int slot = -1;
+    for (int k = 0; k < SESSION_MAX && slot < 0; k++) {
+        if (!g_table[k]) slot = k;
+    }
+    if (slot < 0) return NULL;
+    Session *ss = (Session*)calloc(1, sizeof(Session));
+    if (!ss) return NULL;
+    int len = snprintf(ss->evictPath, sizeof(ss->evictPath), "%s%d.dwalk", g_evict_prefix, g_next_id);
+    if (len < 0 || (size_t)len >= sizeof(ss->evictPath)) { // orezaná cesta by patrila inej relácii
+        free(ss);
+        return NULL;
+    }
+    ss->trace = trace_create();
+    if (!ss->trace) {
+        free(ss);
+        return NULL;
+    }
+    ss->id = g_next_id++;
+    pthread_mutex_init(&ss->lock, NULL);
+    pthread_cond_init(&ss->jobCond, NULL);
+    pthread_mutex_init(&ss->snapLock, NULL);
+    ss->refs = 1;                   // tabuľka
+    ss->lastUse = ++g_tick;
+    g_table[slot] = ss;
+    return ss;
+}
+
+bool sessions_init(size_t memLimit, const char *evictPrefix, int snapshotMs) {
+    g_mem_limit = memLimit;
+    g_snapshot_ms = snapshotMs;
+    if (strlen(evictPrefix) >= sizeof(g_evict_prefix) - 32) return false; // miesto na <id>.dwalk.tmp
+    snprintf(g_evict_prefix, sizeof(g_evict_prefix), "%s", evictPrefix);
+    pthread_mutex_lock(&g_table_lock);
+    Session *def = session_new_locked(); // SESSION_DEFAULT, nezatvára sa
+    pthread_mutex_unlock(&g_table_lock);
+    return def != NULL;
+}
+
+Session *session_open(void) {
+    pthread_mutex_lock(&g_table_lock);
+    Session *ss = session_new_locked();
+    if (ss) ss->refs++;
+    pthread_mutex_unlock(&g_table_lock);
+    return ss;
+}
+
+Session *session_attach(int id) {
+    Session *found = NULL;
+    pthread_mutex_lock(&g_table_lock);
+    for (int k = 0; k < SESSION_MAX && !found; k++) {
+        if (g_table[k] && g_table[k]->id == id && !g_table[k]->closed) found = g_table[k];
+    }
+    if (found) {
+        found->refs++;
+        found->lastUse = ++g_tick;
+    }
+    pthread_mutex_unlock(&g_table_lock);
+    return found;
+}
+
+void session_retain(Session *ss) {
+    pthread_mutex_lock(&g_table_lock);
+    ss->refs++;
+    pthread_mutex_unlock(&g_table_lock);
+}
+
+void session_release(Session *ss) {
+    if (!ss) return;
+    pthread_mutex_lock(&g_table_lock);
+    bool last = --ss->refs == 0;
+    pthread_mutex_unlock(&g_table_lock);
+    if (last) session_free(ss);
+}
+
+void session_close(Session *ss) {
+    pthread_mutex_lock(&g_table_lock);
+    bool drop = false;
+    for (int k = 0; k < SESSION_MAX; k++) {
+        if (g_table[k] == ss && !ss->closed) {
+            g_table[k] = NULL;
+            ss->closed = true;
+            ss->bytes = 0;
+            drop = true;
+        }
+    }
+    pthread_mutex_unlock(&g_table_lock);
+    if (drop) session_release(ss); // referencia tabuľky
+}
+
+bool session_touch(Session *ss) {
+    pthread_mutex_lock(&g_table_lock);
+    ss->lastUse = ++g_tick;
+    bool open = !ss->closed;
+    pthread_mutex_unlock(&g_table_lock);
+    return open;
+}
+
+// --- zámok ---
+
+void session_lock(Session *ss) {
+    uint64_t t0 = stats_now_ns();
+    pthread_mutex_lock(&ss->lock);
+    ss->lockedAt = stats_now_ns();
+    stats_lock_wait(ss->lockedAt - t0);
+}
+
+void session_unlock(Session *ss) {
+    uint64_t held = stats_now_ns() - ss->lockedAt;
+    pthread_mutex_unlock(&ss->lock);
+    stats_lock_hold(held);
+}
+
+void session_wait(Session *ss) {
+    stats_lock_hold(stats_now_ns() - ss->lockedAt);
+    pthread_cond_wait(&ss->jobCond, &ss->lock);
+    ss->lockedAt = stats_now_ns();
+}
+
+// --- snímky ---
+
+void session_snap_replace(Session *ss, Snapshots *p) {
+    pthread_mutex_lock(&ss->snapLock);
+    Snapshots *old = ss->snap;
+    ss->snap = p;
+    pthread_mutex_unlock(&ss->snapLock);
+    snapshots_destroy(old);
+}
+
+bool session_snap_new(Session *ss) {
+    Snapshots *p = snapshots_create(&ss->sim, g_snapshot_ms);
+    if (!p || !snapshots_publish(p, &ss->sim)) {
+        snapshots_destroy(p);
+        return false;
+    }
+    ss->sim.Publish = p;
+    session_snap_replace(ss, p);
+    return true;
+}
+
+SimSnapshot *session_snap_get(Session *ss) {
+    pthread_mutex_lock(&ss->snapLock);
+    SimSnapshot *snap = snapshots_acquire(ss->snap);
+    pthread_mutex_unlock(&ss->snapLock);
+    if (snap) return snap;
+
+    // odložená relácia sa pri čítaní načíta späť a chýbajúca snímka sa dorobí (job v nej
+    // nebeží, zámok je krátky)
+    session_lock(ss);
+    bool ok = ss->initialized && session_resident(ss);
+    session_unlock(ss);
+    if (!ok) return NULL;
+    pthread_mutex_lock(&ss->snapLock);
+    snap = snapshots_acquire(ss->snap);
+    pthread_mutex_unlock(&ss->snapLock);
+    return snap;
+}
+
+// --- pamäť a odkladanie ---
+
+// sim (mapa prekážok s rankom, druhy krokov, na voľnú bunku kroky a zásahy, samples a censored
+// ak ich má alebo ich beh alokuje, m2 pri VarValid, exaktné polia) + dve snímky počítadiel a m2
+// s kópiou mapy prekážok
+static size_t sim_bytes(const Sim *s) {
+    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+    size_t map = s->Tiles * (sizeof(uint64_t) + sizeof(uint32_t));
+    size_t per = 2 * sizeof(uint64_t);
+    bool recycle = s->Estimator == SIM_EST_RECYCLE;
+    if (s->samples || recycle) per += sizeof(uint64_t);
+    if (s->censored || recycle || s->MaxSteps || s->ProbOnly) per += sizeof(uint64_t);
+    if (s->VarValid) per += sizeof(double);   // m2 sa alokuje najneskôr pri behu
+    size_t bytes = 2 * map + s->Tiles * 64 + s->FreeCells * 3 * per;
+    if (s->Mode == SIM_MODE_EXACT) bytes += n * 2 * sizeof(double);
+    return bytes;
+}
+
+// pod victim->lock: stav ide do DWALK2 (rýchle načítanie), parametre behu ostanú v saved
+static bool evict(Session *v) {
+    if (!v->initialized || v->evicted || v->job.state == JOB_RUNNING) return false;
+    if (v->sim.Mode == SIM_MODE_EXACT) return false; // exaktné polia sa neukladajú
+    int format = v->sim.StateFormat;
+    v->sim.StateFormat = SIM_STATE_DWALK2;
+    bool ok = sim_save_state(&v->sim, v->evictPath);
+    v->sim.StateFormat = format;
+    if (!ok) return false;
+
+    session_snap_replace(v, NULL);
+    v->saved = v->sim;
+    v->saved.obstacle = NULL;
+    v->saved.rank = NULL;
+    v->saved.moves = NULL;
+    v->saved.steps_sum = v->saved.hits_sum = v->saved.samples = v->saved.censored = NULL;
+    v->saved.m2 = NULL;
+    v->saved.exact_avg = v->saved.exact_prob = NULL;
+    v->saved.Publish = NULL;
+    sim_free(&v->sim);
+    memset(&v->sim, 0, sizeof(v->sim));
+    v->evicted = true;
+
+    pthread_mutex_lock(&g_table_lock);
+    v->bytes = 0;
+    pthread_mutex_unlock(&g_table_lock);
+    fprintf(stderr, "session %d odlozena do %s\n", v->id, v->evictPath);
+    return true;
+}
+
+void session_reset(Session *ss) {
+    session_snap_replace(ss, NULL);
+    sim_free(&ss->sim);
+    memset(&ss->sim, 0, sizeof(ss->sim));
+    ss->initialized = false;
+    if (ss->evicted) unlink(ss->evictPath);
+    ss->evicted = false;
+    pthread_mutex_lock(&g_table_lock);
+    ss->bytes = 0;
+    pthread_mutex_unlock(&g_table_lock);
+}
+
+bool session_resident(Session *ss) {
+    if (!ss->evicted) {
+        // snímka, ktorú sa pri načítaní nepodarilo vytvoriť, sa skúsi znova
+        if (ss->initialized && !ss->snap && ss->job.state != JOB_RUNNING) session_snap_new(ss);
+        return true;
+    }
+    Sim loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    if (!sim_load_state(&loaded, ss->evictPath)) {
+        sim_free(&loaded);
+        return false;
+    }
+    // parametre behu, ktoré stav neobsahuje
+    Sim *v = &ss->saved;
+    memcpy(loaded.WorldFilePath, v->WorldFilePath, sizeof(loaded.WorldFilePath));
+    memcpy(loaded.ResultFilePath, v->ResultFilePath, sizeof(loaded.ResultFilePath));
+    loaded.Threads = v->Threads;
+    loaded.Kernel = v->Kernel;
+    loaded.CheckpointReps = v->CheckpointReps;
+    loaded.CheckpointSecs = v->CheckpointSecs;
+    loaded.StateFormat = v->StateFormat;
+    // implicitné samples (sim.h) sa načítali voči FirstRep 0
+    if (v->FirstRep && !sim_samples_alloc(&loaded)) {
+        sim_free(&loaded);
+        return false;
+    }
+    loaded.FirstRep = v->FirstRep;
+    loaded.ObstacleDensity = v->ObstacleDensity;
+    ss->sim = loaded;
+    ss->evicted = false;
+    unlink(ss->evictPath);
+    // sim je už v pamäti; bez snímky sa dorobí pri ďalšom session_resident
+    session_snap_new(ss);
+    session_account(ss);
+    return true;
+}
+
+void session_account(Session *ss) {
+    pthread_mutex_lock(&g_table_lock);
+    ss->bytes = (ss->initialized && !ss->evicted) ? sim_bytes(&ss->sim) : 0;
+    ss->lastUse = ++g_tick;
+    if (g_mem_limit == 0) {
+        pthread_mutex_unlock(&g_table_lock);
+        return;
+    }
+
+    // kandidáti od najdlhšie nepoužitej; zámky obetí sa len skúšajú (volajúci drží svoj)
+    for (;;) {
+        size_t total = 0;
+        Session *victim = NULL;
+        for (int k = 0; k < SESSION_MAX; k++) {
+            Session *c = g_table[k];
+            if (!c) continue;
+            total += c->bytes;
+            if (c == ss || c->bytes == 0 || c->lastUse == UINT64_MAX) continue;
+            if (!victim || c->lastUse < victim->lastUse) victim = c;
+        }
+        if (total <= g_mem_limit || !victim) break;
+        victim->refs++;
+        uint64_t use = victim->lastUse;
+        victim->lastUse = UINT64_MAX; // počas pokusu sa nevyberie znova
+        pthread_mutex_unlock(&g_table_lock);
+
+        bool done = false;
+        if (pthread_mutex_trylock(&victim->lock) == 0) {
+            victim->lockedAt = stats_now_ns();
+            done = evict(victim);
+            session_unlock(victim);
+        }
+
+        pthread_mutex_lock(&g_table_lock);
+        // odložená má bytes 0; zaneprázdnená (job, príkaz) ostáva označená do konca kola
+        if (done) victim->lastUse = use;
+        bool last = --victim->refs == 0;
+        if (last) {
+            pthread_mutex_unlock(&g_table_lock);
+            session_free(victim);
+            pthread_mutex_lock(&g_table_lock);
+        }
+    }
+    // preskočené relácie idú na koniec LRU (boli práve aktívne)
+    for (int k = 0; k < SESSION_MAX; k++) {
+        if (g_table[k] && g_table[k]->lastUse == UINT64_MAX) g_table[k]->lastUse = ++g_tick;
+    }
+    pthread_mutex_unlock(&g_table_lock);
+}
@@ -0,0 +1,109 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+#include "snapshot.h"
+#include "trace.h"
+
+// Beh na pozadí (NEW_SIM/RESUME_SIM/RUN_MORE/RUN_UNTIL); kým beží, Sim relácie patrí jobu.
+enum {
+    JOB_IDLE = 0,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_CANCELLED,
+    JOB_FAILED
+};
+
+// čo job spustí
+enum {
+    JOB_KIND_REPS = 0,              // sim_run s reps replikáciami
+    JOB_KIND_EXACT,                 // riešič
+    JOB_KIND_UNTIL                  // sim_run_until, reps je strop kôl
+};
+
+typedef struct Job {
+    int id;
+    int state;                      // JOB_*
+    bool exact;                     // riešič namiesto sim_run
+    bool until;                     // sim_run_until (precision=, metric= v opts)
+    int reps;
+    uint64_t seed;
+    char opts[256];                 // tol=, maxiter= pre riešič, precision= pre RUN_UNTIL
+    int startRep, endRep;
+    uint64_t startSteps, endSteps;
+    double startTime, endTime;
+    char info[128];                 // doplnok odpovede riešiča
+} Job;
+
+// Relácia = jedna simulácia so svojím zámkom, jobom a snímkami. Nezávislé relácie
+// bežia súbežne; spojenie bez OPEN/ATTACH pracuje so spoločnou reláciou 1 (pôvodné
+// správanie jedného g_sim). Pri prekročení pamäťového limitu sa nečinné relácie
+// (najdlhšie nepoužité) odložia na disk a pri ďalšom použití sa načítajú späť.
+typedef struct Session {
+    int id;
+    pthread_mutex_t lock;           // príkazy meniace sim a job (beh samotný ho nedrží); session_lock
+    uint64_t lockedAt;              // kedy ho vzal terajší držiteľ (ns, STATS)
+    pthread_cond_t jobCond;
+    Sim sim;
+    bool initialized;
+    Job job;
+
+    pthread_mutex_t snapLock;       // len výmena ukazovateľa snap
+    Snapshots *snap;                // sumáre čítajú len snímky
+    Trace *trace;                   // zábery pre pozorovateľov behu (job ho dá do sim.Trace)
+
+    // pod zámkom tabuľky
+    int refs;                       // spojenia + bežiaci job + tabuľka
+    bool closed;                    // nastavuje sa aj pod lock
+    uint64_t lastUse;
+    size_t bytes;                   // odhad pamäte, kým je v pamäti
+
+    // odložená na disk (pod lock): sim je uvoľnený, parametre behu sú v saved
+    bool evicted;
+    Sim saved;
+    char evictPath[PATH_MAX];
+} Session;
+
+#define SESSION_DEFAULT 1
+#define SESSION_MAX 64
+
+// memLimit 0 = bez limitu; evictPrefix je začiatok mena odkladacích súborov
+bool sessions_init(size_t memLimit, const char *evictPrefix, int snapshotMs);
+
+// nová relácia s referenciou pre volajúceho (NULL ak je tabuľka plná)
+Session *session_open(void);
+// existujúca relácia s referenciou (NULL ak neexistuje alebo je zatvorená)
+Session *session_attach(int id);
+void session_retain(Session *ss);
+void session_release(Session *ss);
+// vyradí reláciu z tabuľky; uvoľní sa po poslednej referencii
+void session_close(Session *ss);
+// poznačí použitie (LRU); false ak reláciu medzitým zatvorili
+bool session_touch(Session *ss);
+
+// ss->lock s meraním čakania a držania pre STATS (stats.h)
+void session_lock(Session *ss);
+void session_unlock(Session *ss);
+// pod ss->lock: pthread_cond_wait na jobCond (čas čakania sa do držania neráta)
+void session_wait(Session *ss);
+
+// pod ss->lock, job nebeží: zahodí simuláciu (aj odloženú na disku)
+void session_reset(Session *ss);
+// pod ss->lock: načíta odložený stav späť do pamäte; rezidentnej relácii bez snímky (zlyhala
+// pri načítaní) ju skúsi vytvoriť znova. false len ak sa stav nepodarilo načítať.
+bool session_resident(Session *ss);
+// pod ss->lock: prepočíta pamäť relácie a podľa potreby odloží iné nečinné relácie
+void session_account(Session *ss);
+
+// snímky relácie: vymení (NULL = žiadna simulácia) / vytvorí pre aktuálny sim (pod lock)
+void session_snap_replace(Session *ss, Snapshots *p);
+bool session_snap_new(Session *ss);
+// posledná snímka; ak je relácia odložená alebo snímku nemá, najprv ju načíta / vytvorí
+SimSnapshot *session_snap_get(Session *ss);
+
+#endif
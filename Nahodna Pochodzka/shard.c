@@ -0,0 +1,228 @@
+// shard.c - koordinátor: replikácie na viacerých serveroch a zlúčenie ich súm
+#include "shard.h"
+#include "world.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct ShardTask {
+    const char *host;
+    int port;
+    char cmd[PATH_MAX + 512];       // NEW_SIM pre úsek
+    int rep1;                       // koniec úseku (zrušený môže skončiť skôr)
+    Sim *s;                         // len SimEnd (atomicky)
+    RwState st;
+    bool ok;
+    char err[RWC_LINE_MAX];
+} ShardTask;
+
+bool shards_parse(ShardSet *set, const char *list) {
+    memset(set, 0, sizeof(*set));
+    const char *p = list;
+    while (p && *p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char *colon = memchr(p, ':', len);
+        if (!colon || set->count >= SHARD_MAX || (size_t)(colon - p) >= sizeof(set->host[0])) return false;
+        memcpy(set->host[set->count], p, (size_t)(colon - p));
+        set->host[set->count][colon - p] = '\0';
+        set->port[set->count] = atoi(colon + 1);
+        if (set->port[set->count] <= 0) return false;
+        set->count++;
+        p = end ? end + 1 : NULL;
+    }
+    return set->count > 0;
+}
+
+// časť st patrí k s a začína replikáciou rep0
+static bool part_check(const Sim *s, const RwState *st, int rep0, char *err, size_t errLen) {
+    const char *why = NULL;
+    if (st->H != s->WorldHeight || st->W != s->WorldWidth) why = "size";
+    else if (st->K != s->K || st->maxSteps != s->MaxSteps || st->probOnly != s->ProbOnly ||
+             st->estimator != s->Estimator) why = "params";
+    else if (memcmp(st->moveProbs, s->MoveProbs, sizeof(s->MoveProbs)) != 0) why = "probs";
+    else if (st->seed != s->Seed) why = "seed";
+    else if (st->rep0 != rep0 || st->actRep < st->rep0) why = "reps";
+    if (!why) {
+        size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+        for (size_t i = 0; i < n; i++) {
+            if (sim_cell_obstacle(s, i) != (st->worldType && st->obstacle[i])) {
+                why = "world";
+                break;
+            }
+        }
+    }
+    if (why) snprintf(err, errLen, "Merge %s", why);
+    return why == NULL;
+}
+
+static bool part_merge(Sim *s, const RwState *st, char *err, size_t errLen) {
+    if (!sim_merge_counts(s, st->steps, st->hits, st->samples, st->censored, st->m2, st->actRep - st->rep0)) {
+        snprintf(err, errLen, "Out of memory");
+        return false;
+    }
+    s->ActRep = st->actRep;
+    if (s->MaxReps < s->ActRep) s->MaxReps = s->ActRep;
+    return true;
+}
+
+bool shard_merge(Sim *s, const RwState *st, char *err, size_t errLen) {
+    return part_check(s, st, s->ActRep, err, errLen) && part_merge(s, st, err, errLen);
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+// Jeden pracovný server: vlastná relácia, beh úseku bez wait (kvôli CANCEL), EXPORT_STATE
+// a zatvorenie relácie (aj pri chybe, aby na serveri nič neostalo).
+static void *shard_worker(void *arg) {
+    ShardTask *t = (ShardTask*)arg;
+    RwClient c;
+    RwReply r;
+    if (!rwc_connect(&c, t->host, t->port)) {
+        snprintf(t->err, sizeof(t->err), "Shard %s:%d connect", t->host, t->port);
+        return NULL;
+    }
+    const char *fail = NULL;
+    char why[RWC_LINE_MAX] = "";    // odpoveď servera (ERR ...), ktorá krok zhodila
+    rwc_open(&c);
+    rwc_send(&c, t->cmd);
+    bool opened = rwc_reply(&c, &r) && r.ok;
+    if (!opened) fail = "OPEN";
+    if (!rwc_reply(&c, &r) || !r.ok) fail = fail ? fail : "NEW_SIM";
+    if (fail) snprintf(why, sizeof(why), "%s", r.line);
+
+    bool cancelSent = false;
+    RwJobStatus js;
+    memset(&js, 0, sizeof(js));
+    while (!fail) {
+        sleep_ms(SHARD_POLL_MS);
+        if (!cancelSent && __atomic_load_n(&t->s->SimEnd, __ATOMIC_RELAXED)) {
+            rwc_cancel(&c);
+            cancelSent = true;
+            if (!rwc_reply(&c, &r)) fail = "CANCEL"; // ERR No job running = už dobehol
+        }
+        rwc_job_status(&c);
+        if (!fail && (!rwc_read_job_status(&c, &js, &r) || !r.ok)) fail = "JOB_STATUS";
+        if (!fail && strcmp(js.state, "running") != 0) break;
+    }
+    // aj zrušený úsek sa stiahne: jeho hotové replikácie môžu nadväzovať
+    if (!fail) {
+        if (strcmp(js.state, "done") != 0 && strcmp(js.state, "cancelled") != 0) {
+            fail = "run";
+        } else {
+            rwc_export_state(&c);
+            if (!rwc_read_state(&c, &t->st, &r) || !r.ok) fail = "EXPORT_STATE";
+            else t->ok = true;
+        }
+        if (fail) snprintf(why, sizeof(why), "%s", r.line);
+    }
+    if (opened) {
+        rwc_close_session(&c, 0);
+        rwc_reply(&c, &r);
+    }
+    rwc_quit(&c);
+    rwc_reply(&c, &r);
+    rwc_close(&c);
+    if (fail) snprintf(t->err, sizeof(t->err), "Shard %s:%d %s %s", t->host, t->port, fail, why);
+    return NULL;
+}
+
+// voľby NEW_SIM, ktorými si pracovný server postaví rovnaký svet; voľby príkazu delí
+// medzera, preto cesta s ňou (aj k pôvodnému súboru) ide cez kópiu vo worldFile
+static bool world_recipe(Sim *s, const char *worldFile, char *out, size_t outLen) {
+    char abs[PATH_MAX];
+    out[0] = '\0';
+    if (!s->WorldType) return true;
+    if (!s->WorldFilePath[0] && s->ObstacleDensity >= 0.0) {
+        snprintf(out, outLen, "density=%.17g", s->ObstacleDensity);
+        return true;
+    }
+    if (!s->WorldFilePath[0] || !realpath(s->WorldFilePath, abs) || strpbrk(abs, " \t")) {
+        if (!world_save(s, worldFile) || !realpath(worldFile, abs) || strpbrk(abs, " \t")) return false;
+    }
+    snprintf(out, outLen, "world=%s", abs);
+    return true;
+}
+
+bool shard_run(Sim *s, const ShardSet *set, int reps, uint64_t seed, const char *worldFile,
+               char *err, size_t errLen) {
+    if (!s || !set || set->count <= 0 || reps <= 0) {
+        snprintf(err, errLen, "Shard params");
+        return false;
+    }
+    if (!s->Seed) s->Seed = seed ? seed : (uint64_t)time(NULL);
+    char world[PATH_MAX + 16];
+    if (!world_recipe(s, worldFile, world, sizeof(world))) {
+        snprintf(err, errLen, "Shard world file");
+        return false;
+    }
+
+    int n = set->count < reps ? set->count : reps;
+    ShardTask *tasks = (ShardTask*)calloc((size_t)n, sizeof(ShardTask));
+    pthread_t *tids = (pthread_t*)calloc((size_t)n, sizeof(pthread_t));
+    bool *started = (bool*)calloc((size_t)n, sizeof(bool));
+    if (!tasks || !tids || !started) {
+        free(tasks);
+        free(tids);
+        free(started);
+        snprintf(err, errLen, "Out of memory");
+        return false;
+    }
+    for (int k = 0; k < n; k++) {
+        ShardTask *t = &tasks[k];
+        int rep0 = s->ActRep + (int)((long long)reps * k / n);
+        int rep1 = s->ActRep + (int)((long long)reps * (k + 1) / n);
+        t->host = set->host[k];
+        t->port = set->port[k];
+        t->rep1 = rep1;
+        t->s = s;
+        // "-" = pracovný server výsledok neukladá; vlákna a jadro si volí sám
+        snprintf(t->cmd, sizeof(t->cmd),
+                 "NEW_SIM %d %d %d %.17g %.17g %.17g %.17g %d %d - seed=%llu rep0=%d estimator=%s maxsteps=%u probonly=%d ckpt_secs=0 %s",
+                 s->WorldHeight, s->WorldWidth, s->WorldType ? 1 : 0,
+                 s->MoveProbs[0], s->MoveProbs[1], s->MoveProbs[2], s->MoveProbs[3],
+                 s->K, rep1 - rep0, (unsigned long long)s->Seed, rep0,
+                 s->Estimator == SIM_EST_RECYCLE ? "recycle" : "start", s->MaxSteps, s->ProbOnly ? 1 : 0, world);
+        started[k] = pthread_create(&tids[k], NULL, shard_worker, t) == 0;
+        if (!started[k]) snprintf(t->err, sizeof(t->err), "Shard thread");
+    }
+    for (int k = 0; k < n; k++) {
+        if (started[k]) pthread_join(tids[k], NULL);
+    }
+
+    // Najprv sa overia všetky časti, potom sa zlúči súvislý začiatok v poradí úsekov: celý
+    // beh, po CANCEL hotové replikácie až po prvý nedokončený úsek (ďalšie by nenadväzovali).
+    bool cancelled = __atomic_load_n(&s->SimEnd, __ATOMIC_RELAXED);
+    bool ok = true;
+    int rep = s->ActRep;
+    int use = 0;
+    for (int k = 0; k < n; k++) {
+        if (!tasks[k].ok) {
+            if (!cancelled) {
+                snprintf(err, errLen, "%s", tasks[k].err[0] ? tasks[k].err : "Shard failed");
+                ok = false;
+            }
+            break;
+        }
+        if (!part_check(s, &tasks[k].st, rep, err, errLen)) {
+            ok = false;
+            break;
+        }
+        use = k + 1;
+        rep = tasks[k].st.actRep;
+        if (rep < tasks[k].rep1) break;
+    }
+    for (int k = 0; ok && k < use; k++) ok = part_merge(s, &tasks[k].st, err, errLen);
+    for (int k = 0; k < n; k++) rwc_state_free(&tasks[k].st);
+    free(tasks);
+    free(tids);
+    free(started);
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rwclient.h"
+#include "sim.h"
+
+// Koordinátor: replikácie behu sa rozdelia na súvislé úseky medzi pracovné servery
+// (iné procesy, aj na iných strojoch). Prúd prechádzky je daný len (seed, replikácia,
+// bunka), preto pracovný server s rovnakým svetom a seedom, ktorý začne na replikácii
+// rep0 (NEW_SIM rep0=), vyrobí presne sumy tých replikácií a ich zlúčenie dá bitovo
+// rovnaké počítadlá ako beh v jednom procese (m2 sa spája Chanovým vzorcom).
+//
+// Svet ide pracovným serverom ako recept: vygenerovaný ako density= s rovnakým seedom,
+// zo súboru ako world= s tou istou cestou, inak (napr. po RESUME_SIM) ho koordinátor
+// zapíše do súboru (world_save). Cesta musí byť pracovným serverom dostupná (localhost,
+// zdieľaný disk); zhodu prekážok po bitoch overí zlúčenie.
+
+#define SHARD_MAX 32
+#define SHARD_POLL_MS 50            // ako často sa pýta JOB_STATUS (a preposiela CANCEL)
+
+typedef struct ShardSet {
+    int count;
+    char host[SHARD_MAX][64];
+    int port[SHARD_MAX];
+} ShardSet;
+
+// "host:port,host:port,..."; false pri chybnom zápise
+bool shards_parse(ShardSet *set, const char *list);
+
+// Pripočíta časť st do s (EXPORT_STATE iného servera): overí zhodu sveta a parametrov a
+// že časť nadväzuje (rovnaký seed, rep0 == ActRep). Pri chybe vráti false a v err je dôvod.
+bool shard_merge(Sim *s, const RwState *st, char *err, size_t errLen);
+
+// reps replikácií s na pracovných serveroch a zlúčenie výsledkov v poradí úsekov;
+// worldFile = kam zapísať svet bez receptu. SimEnd zruší behy na serveroch a zlúčia sa len
+// replikácie nadväzujúce na ActRep (vráti true). Pri chybe vráti false a v err je dôvod.
+bool shard_run(Sim *s, const ShardSet *set, int reps, uint64_t seed, const char *worldFile,
+               char *err, size_t errLen);
+
+#endif
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# shard_test.sh <server> - koordinátor s dvoma pracovnými servermi musí dať bitovo rovnaké
+# počítadlá (GET_SUMMARY_Z) a sumár (GET_SUMMARY_BIN f64) ako beh v jednom procese (shard.h).
+# EXPORT_STATE sa porovnáva len bez m2: Chanovo zlúčenie m2 nie je bitovo rovnaké ako Welford.
+set -u
+SERVER=${1:?usage: shard_test.sh <server>}
+BASE=$((20000 + $$ % 20000))
+P1=$BASE; P2=$((BASE + 1)); PC=$((BASE + 2))
+TMP=$(mktemp -d)
+PIDS=()
+
+cleanup() {
+    for p in "${PIDS[@]}"; do kill "$p" 2>/dev/null; done
+    wait 2>/dev/null
+    rm -rf "$TMP"
+}
+trap cleanup EXIT
+
+# počká, kým server na porte neprijíma spojenia
+wait_port() {
+    for _ in $(seq 100); do
+        (exec 3<>/dev/tcp/127.0.0.1/"$1") 2>/dev/null && return 0
+        sleep 0.05
+    done
+    echo "server na porte $1 nenabehol" >&2
+    return 1
+}
+
+# pošle príkazy (po riadkoch) a QUIT, vypíše surovú odpoveď servera
+query() {
+    local port=$1; shift
+    exec 3<>/dev/tcp/127.0.0.1/"$port" || return 1
+    printf '%s\n' "$@" QUIT >&3
+    cat <&3
+    exec 3<&-
+}
+
+# odpoveď od stavového riadku posledného príkazu po koniec (binárne dáta bez zmeny,
+# v stavovom riadku sa vynechá Job=)
+reply() {
+    LC_ALL=C sed -n "/^OK $1 /,\$p" | LC_ALL=C sed '1s/ Job=[0-9]*//'
+}
+
+# pracovné servery sú obyčajné servery, druhý slúži aj ako beh v jednom procese
+TMPDIR=$TMP "$SERVER" "$P1" 2 >"$TMP/w1.log" 2>&1 & PIDS+=($!)
+TMPDIR=$TMP "$SERVER" "$P2" 2 >"$TMP/w2.log" 2>&1 & PIDS+=($!)
+TMPDIR=$TMP "$SERVER" "$PC" 2 0 0 0 "127.0.0.1:$P1,127.0.0.1:$P2" >"$TMP/c.log" 2>&1 & PIDS+=($!)
+wait_port "$P1" && wait_port "$P2" && wait_port "$PC" || exit 1
+
+fail=0
+for opts in "density=0.3" "density=0.2 maxsteps=200" "estimator=recycle density=0.25"; do
+    sim="NEW_SIM 21 17 1 0.3 0.2 0.25 0.25 40 24 - seed=77 $opts wait=1"
+    # RUN_UNTIL beží na koordinátore lokálne a jeho Pending závisí aj od zlúčeného m2
+    until="RUN_UNTIL precision=0.15 metric=avg maxreps=1 wait=1"
+    # "stavový riadok|príkazy po NEW_SIM"
+    checks=("SUMMARY_Z|GET_SUMMARY_Z" "SUMMARY_BIN|GET_SUMMARY_BIN f64")
+    case $opts in
+        *recycle*) checks+=("EXPORT_STATE|EXPORT_STATE") ;;           # recyklácia m2 nemá
+        *) checks+=("RUN_UNTIL|$until|GET_SUMMARY_Z") ;;
+    esac
+    for check in "${checks[@]}"; do
+        IFS='|' read -r kind cmds <<<"$check"
+        IFS='|' read -ra cmds <<<"$cmds"
+        query "$PC" "$sim" "${cmds[@]}" >"$TMP/shard.out"
+        query "$P2" "$sim" "${cmds[@]}" >"$TMP/single.out"
+        reply "$kind" <"$TMP/shard.out" >"$TMP/a"
+        reply "$kind" <"$TMP/single.out" >"$TMP/b"
+        if [ ! -s "$TMP/a" ] || ! cmp -s "$TMP/a" "$TMP/b"; then
+            echo "FAIL $kind ($opts)"
+            LC_ALL=C head -c 300 "$TMP/shard.out" "$TMP/single.out"
+            fail=1
+        else
+            echo "ok $kind ($opts)"
+        fi
+        grep -aq "Shards=2" "$TMP/shard.out" || { echo "FAIL koordinátor nerozdelil beh ($opts)"; fail=1; }
+    done
+done
+exit $fail
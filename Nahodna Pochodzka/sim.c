@@ -1,287 +1,1021 @@
-#include "sim.h"
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
-
-static inline int idx(const Sim *s, int r, int c) { return r * s->WorldWidth + c; }
-
-static bool alloc_arrays(Sim *s) {
-    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
-    s->obstacle  = (bool*)calloc(n, sizeof(bool));
-    s->steps_sum = (uint64_t*)calloc(n, sizeof(uint64_t));
-    s->hits_sum  = (uint64_t*)calloc(n, sizeof(uint64_t));
-    return s->obstacle && s->steps_sum && s->hits_sum;
-}
-
-bool sim_init_empty(Sim *s, int h, int w, bool worldType) {
-    if (!s || h <= 0 || w <= 0) return false;
-    memset(s, 0, sizeof(*s));
-    s->WorldHeight = h;
-    s->WorldWidth = w;
-    s->WorldType = worldType;
-    s->MaxReps = 0;
-    s->ActRep = 0;
-    s->K = 100;
-    s->MoveProbs[0] = 0.25; s->MoveProbs[1] = 0.25; s->MoveProbs[2] = 0.25; s->MoveProbs[3] = 0.25;
-    return alloc_arrays(s);
-}
-
-void sim_free(Sim *s) {
-    if (!s) return;
-    free(s->obstacle);  s->obstacle = NULL;
-    free(s->steps_sum); s->steps_sum = NULL;
-    free(s->hits_sum);  s->hits_sum = NULL;
-}
-
-static bool probs_ok(const double p[4]) {
-    double sum = p[0] + p[1] + p[2] + p[3];
-    if (sum < 0.999999 || sum > 1.000001) return false;
-    for (int i = 0; i < 4; i++) if (p[i] < 0.0) return false;
-    return true;
-}
-
-static int sample_dir(const double p[4]) {
-    double r = (double)rand() / (double)RAND_MAX;
-    double c = 0.0;
-    for (int i = 0; i < 4; i++) {
-        c += p[i];
-        if (r <= c) return i;
-    }
-    return 3;
-}
-
-// torus wrap
-static inline int wrap(int x, int m) {
-    x %= m;
-    if (x < 0) x += m;
-    return x;
-}
-
-static void step_try(const Sim *s, int *r, int *c, int dir) {
-    int nr = *r, nc = *c;
-    if (dir == 0) nr--;        // U
-    else if (dir == 1) nr++;   // D
-    else if (dir == 2) nc--;   // L
-    else nc++;                 // R
-
-    nr = wrap(nr, s->WorldHeight);
-    nc = wrap(nc, s->WorldWidth);
-
-    // ak sú prekážky a cieľ je prekážka, ostaneme na mieste
-    if (s->WorldType && s->obstacle[idx(s, nr, nc)]) return;
-
-    *r = nr; *c = nc;
-}
-
-static bool bfs_connected_from_center(const Sim *s) {
-    int H = s->WorldHeight, W = s->WorldWidth;
-    int cr = H/2, cc = W/2;
-    if (s->obstacle[idx(s, cr, cc)]) return false;
-
-    size_t n = (size_t)H * (size_t)W;
-    bool *vis = (bool*)calloc(n, sizeof(bool));
-    int *q = (int*)malloc((int)n * (int)sizeof(int));
-    if (!vis || !q) { free(vis); free(q); return false; }
-
-    int qh = 0, qt = 0;
-    vis[idx(s, cr, cc)] = true;
-    q[qt++] = idx(s, cr, cc);
-
-    while (qh < qt) {
-        int v = q[qh++];
-        int r = v / W, c = v % W;
-
-        const int dr[4] = {-1, +1, 0, 0};
-        const int dc[4] = {0, 0, -1, +1};
-
-        for (int i = 0; i < 4; i++) {
-            int nr = wrap(r + dr[i], H);
-            int nc = wrap(c + dc[i], W);
-            int ni = idx(s, nr, nc);
-            if (s->WorldType && s->obstacle[ni]) continue;
-            if (!vis[ni]) { vis[ni] = true; q[qt++] = ni; }
-        }
-    }
-
-    // každý non-obstacle musí byť reachable
-    for (int i = 0; i < (int)n; i++) {
-        if (s->WorldType && s->obstacle[i]) continue;
-        if (!vis[i]) { free(vis); free(q); return false; }
-    }
-
-    free(vis);
-    free(q);
-    return true;
-}
-
-bool sim_generate_obstacles_connected(Sim *s, double obstacleDensity, uint64_t seed) {
-    if (!s || !s->obstacle) return false;
-    if (!s->WorldType) return true; // bez prekážok netreba
-    if (obstacleDensity < 0.0) obstacleDensity = 0.0;
-    if (obstacleDensity > 0.80) obstacleDensity = 0.80; // aby bolo realistické nájsť connected
-
-    srand((unsigned)(seed ? seed : (uint64_t)time(NULL)));
-
-    int H = s->WorldHeight, W = s->WorldWidth;
-    int cr = H/2, cc = W/2;
-
-    size_t n = (size_t)H * (size_t)W;
-
-    // skúšaj generovať, kým je svet connected
-    for (int attempt = 0; attempt < 5000; attempt++) {
-        memset(s->obstacle, 0, n * sizeof(bool));
-
-        for (int r = 0; r < H; r++) {
-            for (int c = 0; c < W; c++) {
-                if (r == cr && c == cc) continue; // [0,0] nesmie byť prekážka
-                double u = (double)rand() / (double)RAND_MAX;
-                if (u < obstacleDensity) s->obstacle[idx(s, r, c)] = true;
-            }
-        }
-
-        if (bfs_connected_from_center(s)) return true;
-    }
-    return false;
-}
-
-static uint32_t walk_until_center(const Sim *s, int sr, int sc, int *hitWithinK) {
-    int H = s->WorldHeight, W = s->WorldWidth;
-    int cr = H/2, cc = W/2;
-
-    int r = sr, c = sc;
-    uint32_t steps = 0;
-    *hitWithinK = 0;
-
-    while (!(r == cr && c == cc)) {
-        int dir = sample_dir(s->MoveProbs);
-        step_try(s, &r, &c, dir);
-        steps++;
-        if (steps == (uint32_t)s->K && (r == cr && c == cc)) *hitWithinK = 1;
-        if (steps < (uint32_t)s->K && (r == cr && c == cc)) *hitWithinK = 1;
-        // Na konečnom grafe (connected) je zásah takmer iste, takže netreba hard limit.
-    }
-    return steps;
-}
-
-bool sim_run(Sim *s, int addReps, uint64_t seed) {
-    if (!s || addReps <= 0) return false;
-    if (!probs_ok(s->MoveProbs)) return false;
-
-    srand((unsigned)(seed ? seed : (uint64_t)time(NULL)));
-
-    int H = s->WorldHeight, W = s->WorldWidth;
-    int cr = H/2, cc = W/2;
-
-    for (int rep = 0; rep < addReps; rep++) {
-        for (int r = 0; r < H; r++) {
-            for (int c = 0; c < W; c++) {
-                int i = idx(s, r, c);
-                if (s->WorldType && s->obstacle[i]) continue;
-
-                if (r == cr && c == cc) {
-                    s->steps_sum[i] += 0;
-                    s->hits_sum[i] += 1; // do K krokov je to pravda (0 krokov)
-                    continue;
-                }
-
-                int hitK = 0;
-                uint32_t steps = walk_until_center(s, r, c, &hitK);
-                s->steps_sum[i] += (uint64_t)steps;
-                s->hits_sum[i] += (uint64_t)hitK;
-            }
-        }
-        s->ActRep++;
-        if (s->MaxReps < s->ActRep) s->MaxReps = s->ActRep;
-        if (s->SimEnd) break;
-    }
-    return true;
-}
-
-bool sim_save_state(const Sim *s, const char *path) {
-    if (!s || !path) return false;
-    FILE *f = fopen(path, "w");
-    if (!f) return false;
-
-    fprintf(f, "DWALK1\n");
-    fprintf(f, "%d %d\n", s->WorldHeight, s->WorldWidth);
-    fprintf(f, "%d\n", (int)s->WorldType);
-    fprintf(f, "%d\n", s->K);
-    fprintf(f, "%.17g %.17g %.17g %.17g\n", s->MoveProbs[0], s->MoveProbs[1], s->MoveProbs[2], s->MoveProbs[3]);
-    fprintf(f, "%d %d\n", s->MaxReps, s->ActRep);
-
-    int H = s->WorldHeight, W = s->WorldWidth;
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) fprintf(f, "%d", s->obstacle[idx(s,r,c)] ? 1 : 0);
-        fprintf(f, "\n");
-    }
-
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) fprintf(f, "%llu ", (unsigned long long)s->steps_sum[idx(s,r,c)]);
-        fprintf(f, "\n");
-    }
-
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) fprintf(f, "%llu ", (unsigned long long)s->hits_sum[idx(s,r,c)]);
-        fprintf(f, "\n");
-    }
-
-    fclose(f);
-    return true;
-}
-
-bool sim_load_state(Sim *s, const char *path) {
-    if (!s || !path) return false;
-    FILE *f = fopen(path, "r");
-    if (!f) return false;
-
-    char magic[32] = {0};
-    if (!fgets(magic, (int)sizeof(magic), f)) { fclose(f); return false; }
-    if (strncmp(magic, "DWALK1", 5) != 0) { fclose(f); return false; }
-
-    int H=0, W=0, wt=0, K=0, maxReps=0, actRep=0;
-    double p0,p1,p2,p3;
-
-    if (fscanf(f, "%d %d\n", &H, &W) != 2) { fclose(f); return false; }
-    if (fscanf(f, "%d\n", &wt) != 1) { fclose(f); return false; }
-    if (fscanf(f, "%d\n", &K) != 1) { fclose(f); return false; }
-    if (fscanf(f, "%lf %lf %lf %lf\n", &p0,&p1,&p2,&p3) != 4) { fclose(f); return false; }
-    if (fscanf(f, "%d %d\n", &maxReps, &actRep) != 2) { fclose(f); return false; }
-
-    sim_free(s);
-    if (!sim_init_empty(s, H, W, (bool)wt)) { fclose(f); return false; }
-
-    s->K = K;
-    s->MoveProbs[0]=p0; s->MoveProbs[1]=p1; s->MoveProbs[2]=p2; s->MoveProbs[3]=p3;
-    s->MaxReps = maxReps;
-    s->ActRep = actRep;
-
-    // obstacles
-    for (int r = 0; r < H; r++) {
-        char line[8192];
-        if (!fgets(line, (int)sizeof(line), f)) { fclose(f); return false; }
-        // môže to byť prázdny riadok po fscanf -> preskoč, ak treba
-        if ((int)strlen(line) < W) { r--; continue; }
-        for (int c = 0; c < W; c++) s->obstacle[idx(s,r,c)] = (line[c] == '1');
-    }
-
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            unsigned long long v=0;
-            if (fscanf(f, "%llu", &v) != 1) { fclose(f); return false; }
-            s->steps_sum[idx(s,r,c)] = (uint64_t)v;
-        }
-    }
-
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            unsigned long long v=0;
-            if (fscanf(f, "%llu", &v) != 1) { fclose(f); return false; }
-            s->hits_sum[idx(s,r,c)] = (uint64_t)v;
-        }
-    }
-
-    fclose(f);
-    return true;
-}
+#include "sim.h"
+#include "checkpoint.h"
+#include "rng.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "pool.h"
+#include "state.h"
+#include "stats.h"
+#include "trace.h"
+#include "walk.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_TRANSITIONS_CELLS_PER_THREAD (1 << 16) // menší svet zostaví tabuľku prechodov jedno vlákno
+
+static inline int idx(const Sim *s, int r, int c) { return r * s->WorldWidth + c; }
+
+// bunky za okrajom sveta v krajných dlaždiciach sú v mape prekážky
+static bool alloc_arrays(Sim *s) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    s->TilesW = (W + SIM_TILE - 1) >> SIM_TILE_SHIFT;
+    s->Tiles = (size_t)((H + SIM_TILE - 1) >> SIM_TILE_SHIFT) * (size_t)s->TilesW;
+    s->obstacle = (uint64_t*)calloc(s->Tiles, sizeof(uint64_t));
+    if (!s->obstacle) return false;
+    for (int r = 0; r < (int)(s->Tiles / (size_t)s->TilesW) * SIM_TILE; r++) {
+        for (int c = r < H ? W : 0; c < s->TilesW * SIM_TILE; c++) {
+            size_t p = sim_pos(s, r, c);
+            s->obstacle[p >> 6] |= (uint64_t)1 << (p & 63);
+        }
+    }
+    return true;
+}
+
+bool sim_m2_alloc(Sim *s) {
+    if (!s->m2) s->m2 = (double*)calloc(s->FreeCells ? s->FreeCells : 1, sizeof(double));
+    return s->m2 != NULL;
+}
+
+// rozptyl sa prestal viesť -> m2 už netreba
+static void m2_drop(Sim *s) {
+    s->VarValid = false;
+    free(s->m2);
+    s->m2 = NULL;
+}
+
+// hodnota voľnej bunky k (sim_slot) v poli arr, s implicitnými hodnotami nealokovaných polí
+static inline uint64_t slot_value(const Sim *s, int arr, size_t k) {
+    switch (arr) {
+    case SIM_STEPS: return s->steps_sum ? s->steps_sum[k] : 0;
+    case SIM_HITS: return s->hits_sum ? s->hits_sum[k] : 0;
+    case SIM_SAMPLES: return s->samples ? s->samples[k] : (uint64_t)(s->ActRep - s->FirstRep);
+    case SIM_CENSORED: return s->censored ? s->censored[k] : 0;
+    default: {
+        uint64_t bits = 0;
+        if (s->m2) memcpy(&bits, &s->m2[k], sizeof(bits));
+        return bits;
+    }
+    }
+}
+
+static inline size_t cell_pos(const Sim *s, size_t i) {
+    return sim_pos(s, (int)(i / (size_t)s->WorldWidth), (int)(i % (size_t)s->WorldWidth));
+}
+
+bool sim_cell_obstacle(const Sim *s, size_t i) {
+    return sim_blocked(s, cell_pos(s, i));
+}
+
+static uint64_t cell_value(const Sim *s, int arr, size_t i) {
+    size_t p = cell_pos(s, i);
+    return sim_blocked(s, p) ? 0 : slot_value(s, arr, sim_slot(s, p));
+}
+
+uint64_t sim_cell_steps(const Sim *s, size_t i) { return cell_value(s, SIM_STEPS, i); }
+uint64_t sim_cell_hits(const Sim *s, size_t i) { return cell_value(s, SIM_HITS, i); }
+uint64_t sim_cell_samples(const Sim *s, size_t i) { return cell_value(s, SIM_SAMPLES, i); }
+uint64_t sim_cell_censored(const Sim *s, size_t i) { return cell_value(s, SIM_CENSORED, i); }
+
+size_t sim_cell_index(const Sim *s, size_t p) {
+    size_t tile = p >> 6;
+    size_t r = (tile / (size_t)s->TilesW) << SIM_TILE_SHIFT | ((p >> SIM_TILE_SHIFT) & (SIM_TILE - 1));
+    size_t c = (tile % (size_t)s->TilesW) << SIM_TILE_SHIFT | (p & (SIM_TILE - 1));
+    return r * (size_t)s->WorldWidth + c;
+}
+
+size_t sim_cell_step(const Sim *s, size_t i, int d) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    int r = (int)(i / (size_t)W), c = (int)(i % (size_t)W);
+    if (d == 0) r = r == 0 ? H - 1 : r - 1;
+    else if (d == 1) r = r == H - 1 ? 0 : r + 1;
+    else if (d == 2) c = c == 0 ? W - 1 : c - 1;
+    else c = c == W - 1 ? 0 : c + 1;
+    return sim_blocked(s, sim_pos(s, r, c)) ? i : (size_t)idx(s, r, c);
+}
+
+// Prechod bunkami lo .. hi-1 po riadkoch sveta: telo dostane index bunky i, polohu p a pri
+// voľnej bunke aj jej slot k (pri prekážke je k 0).
+#define FOR_CELLS(s, lo, hi, ...) do {                                                   \
+        size_t W_ = (size_t)(s)->WorldWidth;                                              \
+        for (size_t i = (lo); i < (hi); ) {                                               \
+            int r_ = (int)(i / W_);                                                       \
+            size_t end_ = ((size_t)r_ + 1) * W_ < (hi) ? ((size_t)r_ + 1) * W_ : (hi);    \
+            for (int c_ = (int)(i - (size_t)r_ * W_); i < end_; i++, c_++) {              \
+                size_t p = sim_pos((s), r_, c_);                                          \
+                bool blocked = sim_blocked((s), p);                                       \
+                size_t k = blocked ? 0 : sim_slot((s), p);                                \
+                __VA_ARGS__;                                                              \
+            }                                                                             \
+        }                                                                                 \
+    } while (0)
+
+void sim_fill(const Sim *s, int arr, uint64_t *dst, size_t lo, size_t hi) {
+    FOR_CELLS(s, lo, hi, dst[i - lo] = blocked ? 0 : slot_value(s, arr, k));
+}
+
+// 8 bitov riadku r v dlaždici stĺpca tc (bit j = stĺpec tc*8 + j)
+static inline unsigned row_bits(const Sim *s, int r, int tc) {
+    size_t tile = (size_t)(r >> SIM_TILE_SHIFT) * (size_t)s->TilesW + (size_t)tc;
+    return (unsigned)(s->obstacle[tile] >> ((r & (SIM_TILE - 1)) * SIM_TILE)) & 0xFF;
+}
+
+// Prechod mapou prekážok po úsekoch riadkov: celé dlaždice (8 stĺpcov) naraz, okraje úseku
+// a posledná neúplná dlaždica po bunkách. Telo dostane riadok r, prvý stĺpec c, index
+// bunky i a počet stĺpcov n (8 alebo 1).
+#define FOR_ROW_BYTES(s, lo, hi, ...) do {                                                \
+        size_t W_ = (size_t)(s)->WorldWidth;                                              \
+        for (size_t i = (lo); i < (hi); ) {                                               \
+            int r = (int)(i / W_), c = (int)(i % W_);                                     \
+            int n = (c & (SIM_TILE - 1)) == 0 && (size_t)c + SIM_TILE <= W_                \
+                    && i + SIM_TILE <= (hi) ? SIM_TILE : 1;                               \
+            __VA_ARGS__;                                                                  \
+            i += (size_t)n;                                                               \
+        }                                                                                 \
+    } while (0)
+
+void sim_fill_obstacle(const Sim *s, bool *dst, size_t lo, size_t hi) {
+    FOR_ROW_BYTES(s, lo, hi, {
+        unsigned bits = row_bits(s, r, c >> SIM_TILE_SHIFT) >> (c & (SIM_TILE - 1));
+        for (int j = 0; j < n; j++) dst[i - lo + (size_t)j] = (bits >> j) & 1;
+    });
+}
+
+// pole arr (SIM_*), NULL = nealokované s implicitnými hodnotami
+static void *array_of(const Sim *s, int arr) {
+    switch (arr) {
+    case SIM_STEPS: return s->steps_sum;
+    case SIM_HITS: return s->hits_sum;
+    case SIM_SAMPLES: return s->samples;
+    case SIM_CENSORED: return s->censored;
+    default: return s->m2;
+    }
+}
+
+bool sim_store(Sim *s, int arr, const uint64_t *src, size_t lo, size_t hi) {
+    void *dst = array_of(s, arr);
+    bool ok = true;
+    FOR_CELLS(s, lo, hi, {
+        if (blocked || !ok) continue;
+        if (!dst) {
+            if (src[i - lo] == slot_value(s, arr, k)) continue;
+            ok = arr == SIM_SAMPLES ? sim_samples_alloc(s) : arr == SIM_CENSORED ? sim_censored_alloc(s) : sim_m2_alloc(s);
+            dst = array_of(s, arr);
+            if (!ok) continue;
+        }
+        if (arr == SIM_M2) memcpy(&s->m2[k], &src[i - lo], sizeof(double));
+        else ((uint64_t*)dst)[k] = src[i - lo];
+    });
+    return ok;
+}
+
+void sim_store_obstacle(Sim *s, const bool *src, size_t lo, size_t hi) {
+    bool wt = s->WorldType;
+    FOR_ROW_BYTES(s, lo, hi, {
+        uint64_t bits = 0;
+        for (int j = 0; wt && j < n; j++) bits |= (uint64_t)src[i - lo + (size_t)j] << j;
+        int shift = (r & (SIM_TILE - 1)) * SIM_TILE + (c & (SIM_TILE - 1));
+        uint64_t *word = &s->obstacle[(size_t)(r >> SIM_TILE_SHIFT) * (size_t)s->TilesW + (size_t)(c >> SIM_TILE_SHIFT)];
+        *word = (*word & ~((((uint64_t)1 << n) - 1) << shift)) | bits << shift;
+    });
+}
+
+bool sim_samples_alloc(Sim *s) {
+    if (s->samples) return true;
+    uint64_t *a = (uint64_t*)malloc((s->FreeCells ? s->FreeCells : 1) * sizeof(uint64_t));
+    if (!a) return false;
+    for (size_t k = 0; k < s->FreeCells; k++) a[k] = (uint64_t)(s->ActRep - s->FirstRep);
+    s->samples = a;
+    return true;
+}
+
+bool sim_censored_alloc(Sim *s) {
+    if (!s->censored) s->censored = (uint64_t*)calloc(s->FreeCells ? s->FreeCells : 1, sizeof(uint64_t));
+    return s->censored != NULL;
+}
+
+bool sim_init_alloc(Sim *s, int h, int w, bool worldType) {
+    if (!s || h <= 0 || w <= 0) return false;
+    // polohy aj počítadlá majú 32-bit indexy (jadrá, rank)
+    uint64_t tiles = (((uint64_t)h + SIM_TILE - 1) >> SIM_TILE_SHIFT) * (((uint64_t)w + SIM_TILE - 1) >> SIM_TILE_SHIFT);
+    if (tiles * 64 > UINT32_MAX) return false;
+    memset(s, 0, sizeof(*s));
+    s->WorldHeight = h;
+    s->WorldWidth = w;
+    s->WorldType = worldType;
+    s->MaxReps = 0;
+    s->ActRep = 0;
+    s->K = 100;
+    s->MoveProbs[0] = 0.25; s->MoveProbs[1] = 0.25; s->MoveProbs[2] = 0.25; s->MoveProbs[3] = 0.25;
+    s->VarValid = true;             // zatiaľ žiadne vzorky
+    s->ObstacleDensity = -1.0;
+    return alloc_arrays(s);
+}
+
+bool sim_init_empty(Sim *s, int h, int w, bool worldType) {
+    return sim_init_alloc(s, h, w, worldType) && sim_build_transitions(s);
+}
+
+static void counters_free(Sim *s) {
+    free(s->steps_sum); s->steps_sum = NULL;
+    free(s->hits_sum);  s->hits_sum = NULL;
+    free(s->samples);   s->samples = NULL;
+    free(s->censored);  s->censored = NULL;
+    free(s->m2);        s->m2 = NULL;
+}
+
+void sim_free(Sim *s) {
+    if (!s) return;
+    counters_free(s);
+    free(s->obstacle);  s->obstacle = NULL;
+    free(s->rank);      s->rank = NULL;
+    free(s->moves);     s->moves = NULL;
+    free(s->exact_avg); s->exact_avg = NULL;
+    free(s->exact_prob); s->exact_prob = NULL;
+}
+
+static bool probs_ok(const double p[4]) {
+    double sum = p[0] + p[1] + p[2] + p[3];
+    if (sum < 0.999999 || sum > 1.000001) return false;
+    for (int i = 0; i < 4; i++) if (p[i] < 0.0) return false;
+    return true;
+}
+
+// torus wrap
+static inline int wrap(int x, int m) {
+    x %= m;
+    if (x < 0) x += m;
+    return x;
+}
+
+// riadok r tabuľky krokov po dlaždiciach; susedov dávajú bajty riadkov mapy prekážok,
+// okraje dlaždíc a sveta sa rozlišujú len podľa stĺpca a riadku
+static void transitions_row(Sim *s, int r) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    int up = r == 0 ? H - 1 : r - 1, down = r == H - 1 ? 0 : r + 1;
+    int kindU = r == 0 ? SIM_MOVE_WRAP : (r & (SIM_TILE - 1)) == 0 ? SIM_MOVE_NEXT : SIM_MOVE_TILE;
+    int kindD = r == H - 1 ? SIM_MOVE_WRAP : (r & (SIM_TILE - 1)) == SIM_TILE - 1 ? SIM_MOVE_NEXT : SIM_MOVE_TILE;
+    // SIM_MOVE_STAY je 0: smer k prekážke sa z bajtu len vymaže
+    uint8_t inner = (uint8_t)(kindU | kindD << 2 | SIM_MOVE_TILE << 4 | SIM_MOVE_TILE << 6);
+    for (int tc = 0; tc < s->TilesW; tc++) {
+        int c0 = tc << SIM_TILE_SHIFT, n = W - c0 < SIM_TILE ? W - c0 : SIM_TILE;
+        unsigned bu = row_bits(s, up, tc), bd = row_bits(s, down, tc), b = row_bits(s, r, tc);
+        // bit j = prekážka naľavo / napravo od stĺpca c0 + j (cez okraj dlaždice aj sveta)
+        unsigned bl = b << 1 | sim_blocked(s, sim_pos(s, r, c0 == 0 ? W - 1 : c0 - 1));
+        unsigned br = (b >> 1 & ((1u << (n - 1)) - 1)) | (unsigned)sim_blocked(s, sim_pos(s, r, c0 + n == W ? 0 : c0 + n)) << (n - 1);
+        uint8_t *out = s->moves + sim_pos(s, r, c0);
+        for (int j = 0; j < n; j++) {
+            unsigned stay = ((bu >> j) & 1) * 0x03u | ((bd >> j) & 1) * 0x0Cu
+                            | ((bl >> j) & 1) * 0x30u | ((br >> j) & 1) * 0xC0u;
+            out[j] = (uint8_t)(inner & ~stay);
+        }
+        // okrajové stĺpce dlaždice idú doľava / doprava mimo nej
+        out[0] = (uint8_t)((out[0] & 0xCF) | ((bl & 1) ? 0 : (c0 == 0 ? SIM_MOVE_WRAP : SIM_MOVE_NEXT) << 4));
+        out[n - 1] = (uint8_t)((out[n - 1] & 0x3F) | ((br >> (n - 1) & 1) ? 0 : (c0 + n == W ? SIM_MOVE_WRAP : SIM_MOVE_NEXT) << 6));
+    }
+}
+
+static void transitions_worker(Pool *p, int tid, void *arg) {
+    Sim *s = (Sim*)arg;
+    int H = s->WorldHeight, T = pool_size(p);
+    int r1 = (int)((int64_t)H * (tid + 1) / T);
+    for (int r = (int)((int64_t)H * tid / T); r < r1; r++) transitions_row(s, r);
+}
+
+void sim_move_deltas(const Sim *s, int32_t delta[256 * 4]) {
+    int32_t H = s->WorldHeight, W = s->WorldWidth, tileRow = s->TilesW << 6;
+    // posun pre [smer][SIM_MOVE_*]; cez okraj = rozdiel polôh na protiľahlých okrajoch
+    int32_t wrapV = ((H - 1) >> SIM_TILE_SHIFT) * tileRow + ((H - 1) & (SIM_TILE - 1)) * SIM_TILE;
+    int32_t wrapH = ((W - 1) >> SIM_TILE_SHIFT) * 64 + ((W - 1) & (SIM_TILE - 1));
+    const int32_t by[4][4] = {
+        {0, -SIM_TILE, -(tileRow - (SIM_TILE - 1) * SIM_TILE), wrapV},
+        {0, SIM_TILE, tileRow - (SIM_TILE - 1) * SIM_TILE, -wrapV},
+        {0, -1, -(64 - (SIM_TILE - 1)), wrapH},
+        {0, 1, 64 - (SIM_TILE - 1), -wrapH}
+    };
+    for (int m = 0; m < 256; m++) {
+        for (int d = 0; d < 4; d++) delta[m * 4 + d] = by[d][(m >> (2 * d)) & 3];
+    }
+}
+
+bool sim_build_transitions(Sim *s) {
+    if (!s || !s->obstacle) return false;
+    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+    if (!s->rank) s->rank = (uint32_t*)malloc(s->Tiles * sizeof(uint32_t));
+    // + 3 bajty, aby 32-bit gather posledného bajtu nečítal za pole (walk.c)
+    if (!s->moves) s->moves = (uint8_t*)calloc(s->Tiles * 64 + 3, 1);
+    if (!s->rank || !s->moves) return false;
+    size_t freeCells = 0;
+    for (size_t t = 0; t < s->Tiles; t++) {
+        s->rank[t] = (uint32_t)freeCells;
+        freeCells += (size_t)__builtin_popcountll(~s->obstacle[t]);
+    }
+    counters_free(s);
+    s->FreeCells = freeCells;
+    s->steps_sum = (uint64_t*)calloc(freeCells ? freeCells : 1, sizeof(uint64_t));
+    s->hits_sum = (uint64_t*)calloc(freeCells ? freeCells : 1, sizeof(uint64_t));
+    if (!s->steps_sum || !s->hits_sum) return false;
+
+    int maxUseful = (int)(n / SIM_TRANSITIONS_CELLS_PER_THREAD) + 1;
+    if (maxUseful > s->WorldHeight) maxUseful = s->WorldHeight;
+    return pool_run(pool_threads(s->Threads, maxUseful), transitions_worker, s) > 0;
+}
+
+// značky generátora prekážok
+enum {
+    GEN_NONE = 0,
+    GEN_MAIN,                       // voľná bunka spojená so stredom
+    GEN_BORDER                      // prekážka susediaca s MAIN (kandidát na otvorenie)
+};
+
+// Zaplaví voľnú oblasť od start (start je voľná), pridá ju k MAIN a jej susedné prekážky
+// zaradí na hranicu; vráti počet buniek pridaných k MAIN. Každá bunka prejde najviac raz.
+static size_t flood_main(const Sim *s, const bool *ob, uint32_t start, uint8_t *mark, uint32_t *q,
+                         uint32_t *border, size_t *borderLen) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    const int dr[4] = {-1, +1, 0, 0};
+    const int dc[4] = {0, 0, -1, +1};
+    size_t qh = 0, qt = 0;
+    mark[start] = GEN_MAIN;
+    q[qt++] = start;
+    while (qh < qt) {
+        uint32_t v = q[qh++];
+        int r = (int)v / W, c = (int)v % W;
+        for (int d = 0; d < 4; d++) {
+            uint32_t u = (uint32_t)idx(s, wrap(r + dr[d], H), wrap(c + dc[d], W));
+            if (mark[u] == GEN_MAIN) continue;
+            if (!ob[u]) {
+                mark[u] = GEN_MAIN;
+                q[qt++] = u;
+            } else if (mark[u] == GEN_NONE) {
+                mark[u] = GEN_BORDER;
+                border[(*borderLen)++] = u;
+            }
+        }
+    }
+    return qt;
+}
+
+// Jeden prechod bez zamietania: prekážky sa rozhodia nezávisle s pravdepodobnosťou
+// obstacleDensity, potom sa od stredu zaplaví jeho oblasť. Kým má menej voľných buniek,
+// než koľko ich losovanie dalo, otvára sa náhodná prekážka na jej hranici (tým sa pripojí
+// aj každá izolovaná oblasť za ňou). Voľné bunky, ktoré ostali odrezané, sa nakoniec
+// zaplnia. Svet je tak vždy súvislý a hustota zodpovedá zadanej (presnosť je veľkosť
+// poslednej pripojenej oblasti); ak bol súvislý už po losovaní, ostane nezmenený.
+bool sim_generate_obstacles_connected(Sim *s, double obstacleDensity, uint64_t seed) {
+    if (!s || !s->obstacle) return false;
+    if (!s->WorldType) return true; // bez prekážok netreba
+    if (obstacleDensity < 0.0) obstacleDensity = 0.0;
+    if (obstacleDensity > SIM_OBSTACLE_DENSITY_MAX) obstacleDensity = SIM_OBSTACLE_DENSITY_MAX;
+
+    if (!seed) seed = (uint64_t)time(NULL);
+    if (!s->Seed) s->Seed = seed;
+    s->ObstacleDensity = seed == s->Seed ? obstacleDensity : -1.0; // recept sveta pre koordinátor
+    Rng rng;
+    rng_seed(&rng, seed ^ 0x6F62737461636C65ull); // iný prúd než prechádzky
+
+    int H = s->WorldHeight, W = s->WorldWidth;
+    int cr = H/2, cc = W/2;
+    size_t n = (size_t)H * (size_t)W;
+
+    bool *ob = (bool*)calloc(n, sizeof(bool)); // po riadkoch, do mapy prekážok až na konci
+    uint8_t *mark = (uint8_t*)calloc(n, sizeof(uint8_t));
+    uint32_t *q = (uint32_t*)malloc(n * sizeof(uint32_t));
+    uint32_t *border = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!ob || !mark || !q || !border) {
+        free(ob); free(mark); free(q); free(border);
+        return false;
+    }
+
+    size_t target = 0;              // voľné bunky po losovaní
+    for (int r = 0; r < H; r++) {
+        for (int c = 0; c < W; c++) {
+            bool obst = false;
+            if (r != cr || c != cc) obst = rng_uniform(&rng) < obstacleDensity; // stred nesmie byť prekážka
+            ob[idx(s, r, c)] = obst;
+            target += !obst;
+        }
+    }
+
+    size_t borderLen = 0;
+    size_t have = flood_main(s, ob, (uint32_t)idx(s, cr, cc), mark, q, border, &borderLen);
+    while (have < target && borderLen > 0) {
+        size_t k = (size_t)(rng_uniform(&rng) * (double)borderLen);
+        uint32_t v = border[k];
+        border[k] = border[--borderLen];
+        ob[v] = false;
+        have += flood_main(s, ob, v, mark, q, border, &borderLen);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!ob[i] && mark[i] != GEN_MAIN) ob[i] = true;
+    }
+    sim_store_obstacle(s, ob, 0, n);
+
+    free(ob);
+    free(mark);
+    free(q);
+    free(border);
+    return sim_build_transitions(s);
+}
+
+// --- paralelný beh: vlákna si delia pásy riadkov jednej replikácie ---
+//
+// Pri SIM_EST_START prechádzka mení len svoju štartovaciu bunku a pás má v replikácii
+// jediného vlastníka, takže všetky vlákna píšu rovno do súm Sim (bez kópií na vlákno,
+// čo pri veľkom svete rozhoduje o pamäti). Pás je riadok dlaždíc (SIM_TILE riadkov): počítadlá
+// dlaždice ležia pri sebe, pri delení po riadkoch by si vlákna prepisovali tie isté riadky cache.
+// Recyklácia zasahuje bunky celej cesty, tam má každé vlákno 32-bit akumulátory (WalkAcc,
+// walk.h), pri jednom vlákne tiež rovno do Sim.
+
+typedef struct Worker {
+    WalkAcc acc;                    // kam idú prechádzky
+    uint64_t *steps_sum;            // = Sim.steps_sum ... (štarty a Welford)
+    uint64_t *hits_sum;
+    uint64_t *samples;              // NULL = implicitné (sim.h), inak ++ za každý štart
+    WalkStart *starts;              // štarty jedného riadku
+    uint64_t *prevSteps;            // steps_sum a censored štartov pred prechádzkami riadku (Welford, dĺžky)
+    uint64_t *prevCens;
+    WalkPath path;                  // len pri SIM_EST_RECYCLE
+    StatsHist lengths;              // dĺžky prechádzok riadku, po riadku idú do stats (stats.h)
+} Worker;
+
+typedef struct RunCtx {
+    Sim *s;
+    int addReps;
+    DirSampler sampler;             // zostavený raz z MoveProbs pre celý beh
+    int32_t delta[256 * 4];         // posuny polôh pre jadrá (sim_move_deltas)
+    WalkBatchFn walk;               // skalárne alebo SIMD jadro podľa CPU
+    bool recycle;                   // SIM_EST_RECYCLE: walk_batch_recycle namiesto walk
+    bool welford;                   // m2 sa vedie (SIM_EST_START a platné m2)
+    double *m2;                     // = Sim.m2; bunku v replikácii mení len vlastník jej pásu
+    uint64_t *_Atomic censored;     // = Sim.censored; NULL, kým žiadna prechádzka nebola cenzurovaná
+    pthread_mutex_t censoredLock;   // alokácia censored počas behu (censored_add)
+    atomic_bool oom;                // censored sa nepodarilo alokovať -> beh zlyhá
+    uint8_t *active;                // sim_run_until: 1 = voľná bunka (sim_slot) ešte dostáva prechádzky (NULL = všetky)
+    double precision;
+    int metric;
+    atomic_size_t pending;          // nepresné bunky po poslednom kole
+    uint32_t cap;                   // MaxSteps, pri ProbOnly najviac K
+    atomic_int nextBand;            // ďalší nepridelený pás aktuálnej replikácie
+    int doneReps;                   // koľko replikácií je v tomto behu hotových
+    bool stop;
+    Worker *workers;
+    int nworkers;
+    Checkpoint *ckpt;               // NULL = bez priebežného ukladania
+    bool ckptNow;                   // na tejto hranici replikácie sa robí snímka
+    bool publishNow;                // ... a zverejní sa snímka pre čitateľov (Sim.Publish)
+} RunCtx;
+
+// polovica 95 % intervalu zo súm bunky; priemer relatívne, P(do K) podľa Agrestiho-Coulla
+// (pri 0 alebo všetkých zásahoch nevyjde nulová šírka)
+static double ci_half(int metric, uint64_t steps, uint64_t hits, uint64_t samples, uint64_t censored, double m2) {
+    if (samples < SIM_CI_MIN_SAMPLES) return INFINITY;
+    if (metric == SIM_CI_PROB) {
+        double p = ((double)hits + 2.0) / ((double)samples + 4.0);
+        return SIM_CI_Z * sqrt(p * (1.0 - p) / ((double)samples + 4.0));
+    }
+    uint64_t done = samples - censored;
+    if (done < SIM_CI_MIN_SAMPLES || steps == 0) return INFINITY;
+    double mean = (double)steps / (double)done;
+    return SIM_CI_Z * sqrt(m2 / (double)(done - 1) / (double)done) / mean;
+}
+
+// interval voľnej bunky k (sim_slot)
+static double slot_ci(const Sim *s, size_t k, int metric) {
+    return ci_half(metric, slot_value(s, SIM_STEPS, k), slot_value(s, SIM_HITS, k), slot_value(s, SIM_SAMPLES, k),
+                   slot_value(s, SIM_CENSORED, k), s->m2 ? s->m2[k] : 0.0);
+}
+
+// Welford po riadku: prírastok steps_sum štartu je počet krokov jeho prechádzky
+// (pri SIM_EST_START má každá bunka v riadku najviac jednu), cenzurované (prírastok 0)
+// sa nerátajú. Sumy sú spoločné a samples sa ešte nezvýšilo, pred prechádzkou teda bolo
+// samples - prevCens necenzurovaných vzoriek so súčtom prevSteps. Vzorky bunky prichádzajú
+// v poradí replikácií a priemer sa berie z celočíselných súm, takže m2 nezávisí od počtu
+// vlákien ani od toho, či sa beh delil (RESUME_SIM).
+static void welford_row(RunCtx *ctx, Worker *w, int count) {
+    uint64_t reps = (uint64_t)(ctx->s->ActRep - ctx->s->FirstRep);
+    for (int k = 0; k < count; k++) {
+        uint32_t i = w->starts[k].slot;
+        uint64_t x = w->steps_sum[i] - w->prevSteps[k];
+        if (x == 0) continue;
+        uint64_t n = (w->samples ? w->samples[i] : reps) - w->prevCens[k];
+        if (n > 0) {
+            double delta = (double)x - (double)w->prevSteps[k] / (double)n;
+            ctx->m2[i] += delta * delta * (double)n / (double)(n + 1);
+        }
+    }
+}
+
+// Interaktívny mód: ak pozorovateľ čaká na záber, prehrá sa jedna z práve odbehnutých
+// prechádzok riadku (rovnaký prúd, akumulátory sa nemenia, výsledok behu je rovnaký).
+static void trace_row(RunCtx *ctx, const WalkJob *job, const WalkStart *starts, int count) {
+    Sim *s = ctx->s;
+    TraceRec *rec = trace_claim(s->Trace);
+    if (!rec) return;
+    int W = s->WorldWidth;
+    rec->H = s->WorldHeight;
+    rec->W = W;
+    rec->rep = job->rep;
+    const WalkStart *st = &starts[rec->seq % (uint64_t)count];
+    rec->start = st->cell;
+    uint32_t end;
+    rec->steps = walk_trace(job, st, rec->code, TRACE_MOVES_MAX, &rec->moves, &end);
+    rec->end = (uint32_t)sim_cell_index(s, end);
+    rec->hit = end == job->center;
+    trace_commit(s->Trace);
+}
+
+// Cenzurovaná prechádzka, kým Sim nemá censored: pole sa alokuje raz pod zámkom, ďalšie
+// riadky doň jadro píše priamo; vlákna, ktoré ho na začiatku riadku ešte nemali, pripočítajú
+// pod zámkom (každé len bunky svojho pásu).
+static void censored_add(RunCtx *ctx, uint32_t slot) {
+    Sim *s = ctx->s;
+    pthread_mutex_lock(&ctx->censoredLock);
+    if (!s->censored && sim_censored_alloc(s)) atomic_store(&ctx->censored, s->censored);
+    if (s->censored) s->censored[slot]++;
+    else atomic_store(&ctx->oom, true);
+    pthread_mutex_unlock(&ctx->censoredLock);
+}
+
+static void run_row(RunCtx *ctx, Worker *w, int r) {
+    const Sim *s = ctx->s;
+    int H = s->WorldHeight, W = s->WorldWidth;
+    int cr = H/2, cc = W/2;
+    int count = 0;
+
+    for (int c = 0; c < W; c++) {
+        size_t p = sim_pos(s, r, c);
+        if (sim_blocked(s, p)) continue;
+        uint32_t k = (uint32_t)sim_slot(s, p);
+        if (ctx->active && !ctx->active[k]) continue; // už presná (aj stred)
+
+        if (r == cr && c == cc) {
+            walk_acc_center(&w->acc, k); // do K krokov je to pravda (0 krokov)
+            continue;
+        }
+        w->starts[count++] = (WalkStart){ .pos = (uint32_t)p, .cell = (uint32_t)idx(s, r, c), .slot = k };
+    }
+
+    // prúd náhodných čísel každej prechádzky je daný len (seed, replikácia, bunka)
+    WalkJob job = {
+        .moves = s->moves,
+        .delta = ctx->delta,
+        .sim = s,
+        .ds = &ctx->sampler,
+        .center = (uint32_t)sim_pos(s, cr, cc),
+        .K = (uint32_t)s->K,
+        .cap = ctx->cap,
+        .seed = s->Seed,
+        .rep = (uint64_t)s->ActRep,
+    };
+    if (ctx->recycle) {
+        walk_batch_recycle(&job, w->starts, count, &w->path, &w->acc);
+        for (int k = 0; k < count; k++) stats_hist_add(&w->lengths, w->path.lengths[k]);
+    } else {
+        uint64_t *cens = atomic_load(&ctx->censored);
+        for (int k = 0; k < count; k++) {
+            w->prevSteps[k] = w->steps_sum[w->starts[k].slot];
+            w->prevCens[k] = cens ? cens[w->starts[k].slot] : 0;
+        }
+        ctx->walk(&job, w->starts, count, w->steps_sum, w->hits_sum, cens);
+        if (!cens) {
+            // zásah mimo stredu má aspoň jeden krok -> nezmenené steps_sum = cenzurovaná
+            for (int k = 0; k < count; k++) {
+                if (w->steps_sum[w->starts[k].slot] == w->prevSteps[k]) censored_add(ctx, w->starts[k].slot);
+            }
+        }
+        if (ctx->welford) welford_row(ctx, w, count);
+        for (int k = 0; k < count; k++) {
+            uint32_t i = w->starts[k].slot;
+            if (w->samples) w->samples[i]++;
+            // cenzurovaná prechádzka urobila cap krokov, do steps_sum sa nepočítajú
+            uint64_t steps = w->steps_sum[i] - w->prevSteps[k];
+            stats_hist_add(&w->lengths, steps == 0 ? ctx->cap : steps);
+        }
+    }
+    stats_walks(&w->lengths);
+    if (s->Trace && count > 0) trace_row(ctx, &job, w->starts, count);
+}
+
+// Snímka pre checkpoint alebo čitateľov: každé vlákno skopíruje pre svoj úsek voľných buniek
+// sumy Sim do dst a pripočíta nevyprázdnené akumulátory vlákien (recyklácia); ak dstM2
+// nie je NULL, skopíruje aj m2 (to je spoločné). dst[WALK_SAMPLES] a dst[WALK_CENSORED]
+// môžu byť NULL (snímka ich nevedie, kým ich nemá ani Sim).
+static void reduce_slice(RunCtx *ctx, uint64_t **dst, double *dstM2, int tid, int nthreads) {
+    const Sim *s = ctx->s;
+    size_t n = s->FreeCells;
+    size_t lo = n * (size_t)tid / (size_t)nthreads, hi = n * (size_t)(tid + 1) / (size_t)nthreads;
+    if (dstM2 && s->m2) memcpy(dstM2 + lo, s->m2 + lo, (hi - lo) * sizeof(double));
+    else if (dstM2) memset(dstM2 + lo, 0, (hi - lo) * sizeof(double));
+    memcpy(dst[WALK_STEPS] + lo, s->steps_sum + lo, (hi - lo) * sizeof(uint64_t));
+    memcpy(dst[WALK_HITS] + lo, s->hits_sum + lo, (hi - lo) * sizeof(uint64_t));
+    for (int a = WALK_SAMPLES; a <= WALK_CENSORED; a++) {
+        if (!dst[a]) continue;
+        for (size_t k = lo; k < hi; k++) dst[a][k] = slot_value(s, a, k);
+    }
+    for (int a = 0; a < WALK_SUMS; a++) {
+        for (int w = 0; w < ctx->nworkers; w++) {
+            const uint32_t *part = ctx->workers[w].acc.narrow[a];
+            if (!part || !dst[a]) continue;
+            for (size_t k = lo; k < hi; k++) dst[a][k] += part[k];
+        }
+    }
+}
+
+// sim_run_until: pre úsek voľných buniek spojí sumy vlákien a určí, ktoré ešte potrebujú prechádzky
+static void converge_slice(RunCtx *ctx, int tid, int nthreads) {
+    const Sim *s = ctx->s;
+    size_t n = s->FreeCells;
+    size_t lo = n * (size_t)tid / (size_t)nthreads, hi = n * (size_t)(tid + 1) / (size_t)nthreads;
+    size_t center = sim_slot(s, sim_pos(s, s->WorldHeight/2, s->WorldWidth/2));
+    size_t pending = 0;
+    for (size_t k = lo; k < hi; k++) {
+        if (k == center) {
+            ctx->active[k] = 0;
+            continue;
+        }
+        // len SIM_EST_START: sumy sú celé v Sim
+        bool wide = slot_ci(s, k, ctx->metric) > ctx->precision;
+        ctx->active[k] = wide;
+        pending += wide;
+    }
+    atomic_fetch_add(&ctx->pending, pending);
+}
+
+static void run_worker(Pool *p, int tid, void *arg) {
+    RunCtx *ctx = (RunCtx*)arg;
+    Worker *w = &ctx->workers[tid];
+    Sim *s = ctx->s;
+    int bands = (s->WorldHeight + SIM_TILE - 1) >> SIM_TILE_SHIFT;
+
+    for (;;) {
+        int b;
+        while ((b = atomic_fetch_add(&ctx->nextBand, 1)) < bands) {
+            int r1 = (b + 1) << SIM_TILE_SHIFT;
+            if (r1 > s->WorldHeight) r1 = s->WorldHeight;
+            for (int r = b << SIM_TILE_SHIFT; r < r1; r++) run_row(ctx, w, r);
+        }
+
+        // adaptívne kolo: presnosť sa vyhodnotí po dobehnutí všetkých riadkov
+        if (ctx->active) {
+            pool_barrier(p);
+            converge_slice(ctx, tid, pool_size(p));
+        }
+        // replikácia je hotová až keď dobehnú všetky vlákna -> ActRep ostáva presný
+        if (pool_barrier(p)) {
+            ctx->doneReps++;
+            s->ActRep++;
+            if (s->MaxReps < s->ActRep) s->MaxReps = s->ActRep;
+            if (ctx->doneReps >= ctx->addReps || __atomic_load_n(&s->SimEnd, __ATOMIC_RELAXED)) ctx->stop = true;
+            if (ctx->active && atomic_exchange(&ctx->pending, 0) == 0) ctx->stop = true;
+            if (atomic_load(&ctx->oom)) ctx->stop = true;
+            ctx->ckptNow = ctx->ckpt && checkpoint_due(ctx->ckpt, s);
+            // posledná replikácia sa nezverejňuje, volajúci má po návrate celý Sim
+            ctx->publishNow = !ctx->stop && s->Publish && snapshots_due(s->Publish, s, ctx->welford);
+            atomic_store(&ctx->nextBand, 0);
+        }
+        pool_barrier(p);
+        if (ctx->ckptNow) {
+            reduce_slice(ctx, checkpoint_arrays(ctx->ckpt), checkpoint_m2(ctx->ckpt), tid, pool_size(p));
+            if (pool_barrier(p)) checkpoint_submit(ctx->ckpt, s);
+        }
+        if (ctx->publishNow) {
+            reduce_slice(ctx, snapshots_arrays(s->Publish), snapshots_m2(s->Publish), tid, pool_size(p));
+            if (pool_barrier(p)) snapshots_submit(s->Publish, s);
+        }
+        if (ctx->stop) break;
+    }
+}
+
+// precision 0 = obyčajné replikácie (sim_run), inak adaptívne kolá (sim_run_until)
+static bool run_reps(Sim *s, int addReps, uint64_t seed, double precision, int metric) {
+    if (!s || addReps <= 0) return false;
+    if (!probs_ok(s->MoveProbs)) return false;
+
+    // seed sa zvolí raz pre celú simuláciu; ďalšie behy (aj po RESUME_SIM) pokračujú v tej istej postupnosti
+    if (!s->Seed) s->Seed = seed ? seed : (uint64_t)time(NULL);
+    size_t positions = s->Tiles * 64;
+
+    RunCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.s = s;
+    ctx.addReps = addReps;
+    if (!dir_sampler_init(&ctx.sampler, s->MoveProbs)) return false;
+    sim_move_deltas(s, ctx.delta);
+    ctx.walk = walk_kernel_pick(s->Kernel, positions);
+    ctx.recycle = s->Estimator == SIM_EST_RECYCLE; // cesta sa zapisuje krok po kroku -> len skalárne
+    ctx.cap = s->MaxSteps ? s->MaxSteps : UINT32_MAX;
+    if (s->ProbOnly && (uint32_t)s->K < ctx.cap) ctx.cap = (uint32_t)s->K;
+    if (ctx.cap == 0) ctx.cap = 1; // aspoň jeden krok (zo štartu mimo stredu sa do 0 krokov aj tak netrafí)
+    atomic_init(&ctx.nextBand, 0);
+    atomic_init(&ctx.pending, 0);
+    // recyklované vzorky jednej prechádzky nie sú nezávislé, m2 sa pre ne nevedie
+    if (ctx.recycle) m2_drop(s);
+    ctx.welford = s->VarValid;
+    if (ctx.welford && !sim_m2_alloc(s)) return false;
+    ctx.precision = precision;
+    ctx.metric = metric;
+    // recyklácia a adaptívne kolá dávajú bunkám rôzne počty vzoriek, samples musí byť pole
+    if ((ctx.recycle || precision > 0) && !sim_samples_alloc(s)) return false;
+    if (ctx.recycle && !sim_censored_alloc(s)) return false;
+    atomic_init(&ctx.censored, s->censored);
+    atomic_init(&ctx.oom, false);
+
+    int nthreads = sim_thread_count(s);
+    ctx.workers = (Worker*)calloc((size_t)nthreads, sizeof(Worker));
+    if (!ctx.workers) return false;
+    ctx.nworkers = nthreads;
+    pthread_mutex_init(&ctx.censoredLock, NULL);
+
+    bool ok = true;
+    uint64_t *const sums[WALK_SUMS] = {s->steps_sum, s->hits_sum, s->samples, s->censored};
+    for (int t = 0; t < nthreads; t++) {
+        Worker *w = &ctx.workers[t];
+        w->starts = (WalkStart*)malloc((size_t)s->WorldWidth * sizeof(WalkStart));
+        w->prevSteps = (uint64_t*)malloc((size_t)s->WorldWidth * sizeof(uint64_t));
+        w->prevCens = (uint64_t*)malloc((size_t)s->WorldWidth * sizeof(uint64_t));
+        if (!w->starts || !w->prevSteps || !w->prevCens) ok = false;
+        if (ctx.recycle && !walk_path_init(&w->path, positions)) ok = false;
+        if (!walk_acc_init(&w->acc, sums, s->FreeCells, ctx.recycle && nthreads > 1)) ok = false;
+        w->steps_sum = s->steps_sum;
+        w->hits_sum = s->hits_sum;
+        w->samples = s->samples;
+    }
+    if (ctx.welford) ctx.m2 = s->m2;
+
+    // adaptívny beh začína bunkami, ktoré ešte nie sú presné; ak nie je žiadna, niet čo robiť
+    bool idle = false;
+    if (ok && precision > 0) {
+        ctx.active = (uint8_t*)malloc(s->FreeCells);
+        if (!ctx.active) ok = false;
+        else converge_slice(&ctx, 0, 1);
+        idle = ok && atomic_exchange(&ctx.pending, 0) == 0;
+    }
+
+    // ak sa niektoré vlákno nepodarí spustiť, pool beží s menším počtom
+    if (ok && !idle) ctx.ckpt = checkpoint_start(s);
+    if (ok && !idle && pool_run(nthreads, run_worker, &ctx) == 0) ok = false;
+    checkpoint_stop(ctx.ckpt);
+    if (atomic_load(&ctx.oom)) ok = false;
+
+    free(ctx.active);
+    for (int t = 0; t < nthreads; t++) {
+        Worker *w = &ctx.workers[t];
+        if (ok) walk_acc_flush(&w->acc, false);
+        walk_acc_free(&w->acc);
+        free(w->starts);
+        free(w->prevSteps);
+        free(w->prevCens);
+        walk_path_free(&w->path);
+    }
+    free(ctx.workers);
+    pthread_mutex_destroy(&ctx.censoredLock);
+    return ok;
+}
+
+bool sim_run(Sim *s, int addReps, uint64_t seed) {
+    return run_reps(s, addReps, seed, 0.0, SIM_CI_AVG);
+}
+
+bool sim_run_until(Sim *s, double precision, int metric, int maxReps, uint64_t seed) {
+    if (!s || precision <= 0 || s->Estimator != SIM_EST_START) return false;
+    if (metric == SIM_CI_AVG && !s->VarValid) return false; // P(do K) m2 nepotrebuje
+    return run_reps(s, maxReps, seed, precision, metric);
+}
+
+double sim_cell_avg(const Sim *s, size_t i) {
+    if (s->Mode == SIM_MODE_EXACT) return s->exact_avg ? s->exact_avg[i] : 0.0;
+    uint64_t done = sim_cell_samples(s, i) - sim_cell_censored(s, i);
+    return (done > 0) ? (double)sim_cell_steps(s, i) / (double)done : 0.0;
+}
+
+double sim_cell_prob(const Sim *s, size_t i) {
+    if (s->Mode == SIM_MODE_EXACT) return s->exact_prob ? s->exact_prob[i] : 0.0;
+    uint64_t n = sim_cell_samples(s, i);
+    return (n > 0) ? (double)sim_cell_hits(s, i) / (double)n : 0.0;
+}
+
+bool sim_merge_counts(Sim *s, const uint64_t *steps, const uint64_t *hits, const uint64_t *samples,
+                      const uint64_t *censored, const double *m2, int reps) {
+    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+    // polia sa rozbalia, len ak časť nie je implicitná (reps vzoriek na voľnú bunku, nič cenzurované)
+    bool ownSamples = false, anyCensored = false;
+    FOR_CELLS(s, 0, n, {
+        (void)k;
+        ownSamples |= samples[i] != (blocked ? 0 : (uint64_t)reps);
+        anyCensored |= censored[i] != 0;
+    });
+    if ((ownSamples && !sim_samples_alloc(s)) || (anyCensored && !sim_censored_alloc(s))) return false;
+    if (!m2 || (s->VarValid && !sim_m2_alloc(s))) m2_drop(s);
+    FOR_CELLS(s, 0, n, {
+        if (blocked) continue;
+        if (s->VarValid) {
+            // Chan: m2 = m2a + m2b + delta^2 * na * nb / (na + nb)
+            uint64_t na = slot_value(s, SIM_SAMPLES, k) - slot_value(s, SIM_CENSORED, k), nb = samples[i] - censored[i];
+            if (na == 0) {
+                s->m2[k] = m2[i];
+            } else if (nb > 0) {
+                double delta = (double)steps[i] / (double)nb - (double)s->steps_sum[k] / (double)na;
+                s->m2[k] += m2[i] + delta * delta * ((double)na * (double)nb / (double)(na + nb));
+            }
+        }
+        s->steps_sum[k] += steps[i];
+        s->hits_sum[k] += hits[i];
+        if (s->samples) s->samples[k] += samples[i];
+        if (s->censored) s->censored[k] += censored[i];
+    });
+    return true;
+}
+
+uint64_t sim_censored_total(const Sim *s, uint64_t *samplesTotal) {
+    uint64_t cens = 0, all = 0;
+    for (size_t k = 0; k < s->FreeCells; k++) {
+        cens += slot_value(s, SIM_CENSORED, k);
+        all += slot_value(s, SIM_SAMPLES, k);
+    }
+    if (samplesTotal) *samplesTotal = all;
+    return cens;
+}
+
+double sim_cell_ci(const Sim *s, size_t i, int metric) {
+    if (metric == SIM_CI_AVG && !s->VarValid) return INFINITY;
+    size_t p = cell_pos(s, i);
+    if (sim_blocked(s, p)) return ci_half(metric, 0, 0, 0, 0, 0.0);
+    return slot_ci(s, sim_slot(s, p), metric);
+}
+
+size_t sim_ci_pending(const Sim *s, double precision, int metric) {
+    size_t center = sim_slot(s, sim_pos(s, s->WorldHeight/2, s->WorldWidth/2)), pending = 0;
+    if (metric == SIM_CI_AVG && !s->VarValid) return s->FreeCells - 1;
+    for (size_t k = 0; k < s->FreeCells; k++) {
+        if (k == center) continue;
+        pending += slot_ci(s, k, metric) > precision;
+    }
+    return pending;
+}
+
+int sim_thread_count(const Sim *s) {
+    return pool_threads(s->Threads, (s->WorldHeight + SIM_TILE - 1) >> SIM_TILE_SHIFT); // pracujeme po pásoch dlaždíc
+}
+
+// riadky poľa arr (SIM_*) ako čísla oddelené medzerou, row má W prvkov
+static void print_rows(FILE *f, const Sim *s, int arr, uint64_t *row) {
+    size_t W = (size_t)s->WorldWidth;
+    for (size_t r = 0; r < (size_t)s->WorldHeight; r++) {
+        sim_fill(s, arr, row, r * W, (r + 1) * W);
+        for (size_t c = 0; c < W; c++) fprintf(f, "%llu ", (unsigned long long)row[c]);
+        fprintf(f, "\n");
+    }
+}
+
+static bool save_direct(const Sim *s, const char *path) {
+    if (s->StateFormat == SIM_STATE_DWALK2) return state_save_dwalk2(s, path);
+    if (s->StateFormat == SIM_STATE_DWALKZ) return state_save_dwalkz(s, path);
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+
+    fprintf(f, "DWALK1\n");
+    fprintf(f, "%d %d\n", s->WorldHeight, s->WorldWidth);
+    fprintf(f, "%d\n", (int)s->WorldType);
+    fprintf(f, "%d\n", s->K);
+    fprintf(f, "%.17g %.17g %.17g %.17g\n", s->MoveProbs[0], s->MoveProbs[1], s->MoveProbs[2], s->MoveProbs[3]);
+    fprintf(f, "%d %d\n", s->MaxReps, s->ActRep);
+    fprintf(f, "seed=%llu\n", (unsigned long long)s->Seed);
+    if (s->Mode == SIM_MODE_EXACT) fprintf(f, "mode=exact\n");
+    if (s->Estimator == SIM_EST_RECYCLE) fprintf(f, "estimator=recycle\n");
+    if (s->MaxSteps) fprintf(f, "maxsteps=%u\n", s->MaxSteps);
+    if (s->ProbOnly) fprintf(f, "probonly=1\n");
+
+    int H = s->WorldHeight, W = s->WorldWidth;
+    // počty vzoriek sa zapíšu len ak sa líšia od ActRep (inak ich starý formát odvodí sám)
+    bool ownCounts = false;
+    for (size_t k = 0; k < s->FreeCells && !ownCounts; k++) {
+        ownCounts = slot_value(s, SIM_SAMPLES, k) != (uint64_t)s->ActRep;
+    }
+    if (ownCounts) fprintf(f, "samples=1\n");
+    bool anyCensored = sim_censored_total(s, NULL) > 0;
+    if (anyCensored) fprintf(f, "censored=1\n");
+
+    uint64_t *row = (uint64_t*)malloc((size_t)W * sizeof(uint64_t));
+    if (!row) { fclose(f); return false; }
+    for (int r = 0; r < H; r++) {
+        for (int c = 0; c < W; c++) fprintf(f, "%d", sim_blocked(s, sim_pos(s, r, c)) && s->WorldType ? 1 : 0);
+        fprintf(f, "\n");
+    }
+    print_rows(f, s, SIM_STEPS, row);
+    print_rows(f, s, SIM_HITS, row);
+    if (ownCounts) print_rows(f, s, SIM_SAMPLES, row);
+    if (anyCensored) print_rows(f, s, SIM_CENSORED, row);
+    free(row);
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// Zapíše do <path>.tmp, fsync a až potom rename cez path: pád alebo plný disk počas
+// zápisu (END_SIM, CLOSE, vysťahovanie) nechá pôvodný súbor celý.
+bool sim_save_state(const Sim *s, const char *path) {
+    if (!s || !path) return false;
+    char tmp[PATH_MAX + 8];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return false;
+    bool ok = save_direct(s, tmp);
+    if (ok) {
+        int fd = open(tmp, O_RDONLY);
+        ok = fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0) close(fd);
+    }
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) unlink(tmp);
+    return ok;
+}
+
+bool sim_load_state(Sim *s, const char *path) {
+    if (!s || !path) return false;
+    if (state_is_dwalk2(path)) return state_load_dwalk2(s, path);
+    if (state_is_dwalkz(path)) return state_load_dwalkz(s, path);
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char magic[32] = {0};
+    if (!fgets(magic, (int)sizeof(magic), f)) { fclose(f); return false; }
+    if (strncmp(magic, "DWALK1", 6) != 0) { fclose(f); return false; }
+
+    int H=0, W=0, wt=0, K=0, maxReps=0, actRep=0;
+    double p0,p1,p2,p3;
+
+    if (fscanf(f, "%d %d\n", &H, &W) != 2) { fclose(f); return false; }
+    if (fscanf(f, "%d\n", &wt) != 1) { fclose(f); return false; }
+    if (fscanf(f, "%d\n", &K) != 1) { fclose(f); return false; }
+    if (fscanf(f, "%lf %lf %lf %lf\n", &p0,&p1,&p2,&p3) != 4) { fclose(f); return false; }
+    if (fscanf(f, "%d %d\n", &maxReps, &actRep) != 2) { fclose(f); return false; }
+
+    sim_free(s);
+    if (!sim_init_alloc(s, H, W, (bool)wt)) { fclose(f); return false; }
+
+    s->K = K;
+    s->MoveProbs[0]=p0; s->MoveProbs[1]=p1; s->MoveProbs[2]=p2; s->MoveProbs[3]=p3;
+    s->MaxReps = maxReps;
+    s->ActRep = actRep;
+    s->VarValid = actRep == 0;      // textový formát m2 nemá
+
+    // voliteľné riadky kľúč=hodnota pred mapou prekážok, potom obstacles (riadok ľubovoľnej dĺžky)
+    char *line = NULL;
+    size_t lineCap = 0;
+    bool ownCounts = false, anyCensored = false;
+    size_t n = (size_t)H * (size_t)W;
+    // riadok prekážok alebo počítadiel, do Sim ide cez sim_store*
+    uint64_t *row = (uint64_t*)malloc((size_t)W * sizeof(uint64_t));
+    bool *obRow = (bool*)malloc((size_t)W * sizeof(bool));
+    if (!row || !obRow) { free(row); free(obRow); fclose(f); return false; }
+    int r = 0;
+    while (r < H) {
+        if (getline(&line, &lineCap, f) < 0) { free(line); free(row); free(obRow); fclose(f); return false; }
+        if (isalpha((unsigned char)line[0])) {
+            unsigned long long v = 0;
+            if (sscanf(line, "seed=%llu", &v) == 1) s->Seed = (uint64_t)v;
+            if (strncmp(line, "mode=exact", 10) == 0) s->Mode = SIM_MODE_EXACT;
+            if (strncmp(line, "estimator=recycle", 17) == 0) s->Estimator = SIM_EST_RECYCLE;
+            if (strncmp(line, "samples=1", 9) == 0) ownCounts = true;
+            if (strncmp(line, "censored=1", 10) == 0) anyCensored = true;
+            if (strncmp(line, "probonly=1", 10) == 0) s->ProbOnly = true;
+            unsigned int cap = 0;
+            if (sscanf(line, "maxsteps=%u", &cap) == 1) s->MaxSteps = cap;
+            continue;
+        }
+        // môže to byť prázdny riadok po fscanf -> preskoč, ak treba
+        if (strlen(line) < (size_t)W) continue;
+        for (int c = 0; c < W; c++) obRow[c] = (line[c] == '1');
+        sim_store_obstacle(s, obRow, (size_t)r * (size_t)W, (size_t)(r + 1) * (size_t)W);
+        r++;
+    }
+    free(line);
+    free(obRow);
+    bool ok = sim_build_transitions(s);
+
+    // bez vlastných počtov ostane samples implicitné (ActRep na voľnú bunku, sim.h)
+    const int arrs[4] = {SIM_STEPS, SIM_HITS, SIM_SAMPLES, SIM_CENSORED};
+    const bool present[4] = {true, true, ownCounts, anyCensored};
+    for (int a = 0; ok && a < 4; a++) {
+        for (size_t lo = 0; ok && present[a] && lo < n; lo += (size_t)W) {
+            for (int c = 0; ok && c < W; c++) {
+                unsigned long long v = 0;
+                ok = fscanf(f, "%llu", &v) == 1;
+                row[c] = (uint64_t)v;
+            }
+            ok = ok && sim_store(s, arrs[a], row, lo, lo + (size_t)W);
+        }
+    }
+
+    free(row);
+    fclose(f);
+    return ok;
+}
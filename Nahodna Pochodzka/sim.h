@@ -1,52 +1,242 @@
-#ifndef SIM_H
-#define SIM_H
-
-#include <stdbool.h>
-#include <stdint.h>
-
-#ifndef PATH_MAX
-#define PATH_MAX 4096
-#endif
-
-// client-side (neskôr; zatiaľ nepoužité)
-typedef struct ClientData {
-    bool SimMode; // false=sumárny, true=interaktívny (neskôr)
-    bool SimEnd;  // žiadosť ukončiť (neskôr)
-} ClientData;
-
-// server-side (tu používané aj v single-process režime)
-typedef struct Sim {
-    char WorldFilePath[PATH_MAX];   // ak sa načítava svet z externého súboru (voliteľné)
-    bool WorldType;                 // 0=bez prekážok, 1=s prekážkami
-    int WorldHeight;
-    int WorldWidth;
-
-    int MaxReps;
-    int ActRep;                     // aktuálna (koľko je už hotových)
-
-    double MoveProbs[4];            // U, D, L, R (súčet = 1)
-    int K;                          // max krokov pre pravdepodobnosť
-
-    char ResultFilePath[PATH_MAX];  // súbor na uloženie stavu
-
-    int DrunkCoords[2];             // (row, col) pre interaktívny mód (neskôr)
-    bool SimEnd;
-
-    // --- interné polia pre sumár (per-cell) ---
-    bool *obstacle;                 // H*W
-    uint64_t *steps_sum;            // H*W
-    uint64_t *hits_sum;             // H*W (počet zásahov do K)
-} Sim;
-
-bool sim_init_empty(Sim *s, int h, int w, bool worldType);
-void sim_free(Sim *s);
-
-bool sim_generate_obstacles_connected(Sim *s, double obstacleDensity, uint64_t seed);
-
-bool sim_run(Sim *s, int addReps, uint64_t seed);
-bool sim_save_state(const Sim *s, const char *path);
-bool sim_load_state(Sim *s, const char *path);
-
-
-#endif
-
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// client-side: stav spojenia na serveri
+typedef struct ClientData {
+    bool SimMode; // false=sumárny, true=interaktívny (behy posielajú zábery prechádzky, trace.h)
+    bool SimEnd;  // žiadosť ukončiť (neskôr)
+} ClientData;
+
+// jadro prechádzok (walk.c)
+enum {
+    SIM_KERNEL_AUTO = 0,            // AVX2 ak ho CPU má, inak skalárne
+    SIM_KERNEL_SCALAR = 1,
+    SIM_KERNEL_AVX2 = 2
+};
+
+// spôsob výpočtu sumáru
+enum {
+    SIM_MODE_MC = 0,                // Monte Carlo prechádzky (sim_run)
+    SIM_MODE_EXACT = 1              // exaktné riešenie reťazca (sim_solve_expected)
+};
+
+// odhad v Monte Carlo režime
+enum {
+    SIM_EST_START = 0,              // každá prechádzka je jedna vzorka pre svoju štartovaciu bunku
+    SIM_EST_RECYCLE = 1             // vzorka pre každú bunku na ceste (zvyšok cesty od prvej návštevy)
+};
+
+// veličina, ktorej interval spoľahlivosti stráži sim_run_until
+enum {
+    SIM_CI_AVG = 0,                 // priemer krokov, presnosť relatívne k priemeru
+    SIM_CI_PROB = 1                 // P(do K), presnosť absolútne
+};
+
+#define SIM_CI_Z 1.96               // 95 % interval
+#define SIM_CI_MIN_SAMPLES 16       // menej vzoriek bunky sa za presné nepovažuje
+
+#define SIM_OBSTACLE_DENSITY_DEFAULT 0.2
+#define SIM_OBSTACLE_DENSITY_MAX 0.95   // aspoň niečo voľné okrem stredu
+
+// formát súboru so stavom (načítanie rozpozná každý podľa magic)
+enum {
+    SIM_STATE_DWALK2 = 0,           // binárny, zarovnané polia + kontrolný súčet (state.c)
+    SIM_STATE_DWALK1 = 1,           // pôvodný textový
+    SIM_STATE_DWALKZ = 2            // kompaktný binárny (delta + varint + rANS, state.c/codec.c)
+};
+
+// Kompaktné rozloženie sveta: dlaždice 8x8 buniek po riadkoch dlaždíc, dlaždica je jedno
+// 64-bit slovo mapy prekážok. Bunka (r, c) má polohu p = dlaždica * 64 + (r % 8) * 8 + c % 8
+// (sim_pos); bunky za okrajom sveta v krajných dlaždiciach sú v mape prekážky. Počítadlá
+// majú prvok len pre voľné bunky, v poradí polôh (sim_slot), takže bunky jednej dlaždice
+// ležia pri sebe aj cez riadky. Formáty a protokol používajú index bunky i = r*W + c, ten
+// preklápajú sim_cell_*, sim_fill a sim_store.
+#define SIM_TILE_SHIFT 3
+#define SIM_TILE (1 << SIM_TILE_SHIFT)  // strana dlaždice
+
+// druh kroku z bunky v jednom smere (Sim.moves má 2 bity na smer U, D, L, R)
+enum {
+    SIM_MOVE_STAY = 0,              // cieľ je prekážka, ostáva sa na mieste
+    SIM_MOVE_TILE,                  // v tej istej dlaždici
+    SIM_MOVE_NEXT,                  // do susednej dlaždice
+    SIM_MOVE_WRAP                   // cez okraj sveta (torus)
+};
+
+// polia počítadiel (sim_fill, sim_store); poradie ako WALK_* vo walk.h
+enum {
+    SIM_STEPS = 0,
+    SIM_HITS,
+    SIM_SAMPLES,
+    SIM_CENSORED,
+    SIM_M2,                         // bity double
+    SIM_ARRAYS
+};
+
+struct Snapshots;
+struct Trace;
+
+// server-side (tu používané aj v single-process režime)
+typedef struct Sim {
+    char WorldFilePath[PATH_MAX];   // ak sa načítava svet z externého súboru (voliteľné)
+    bool WorldType;                 // 0=bez prekážok, 1=s prekážkami
+    int WorldHeight;
+    int WorldWidth;
+
+    int MaxReps;
+    int ActRep;                     // aktuálna (koľko je už hotových)
+    int FirstRep;                   // prvá replikácia v sumách (>0 len pre časť rozdelenej simulácie, neukladá sa)
+
+    double MoveProbs[4];            // U, D, L, R (súčet = 1)
+    int K;                          // max krokov pre pravdepodobnosť
+
+    char ResultFilePath[PATH_MAX];  // súbor na uloženie stavu
+
+    bool SimEnd;                    // žiadosť ukončiť sim_run po dokončení replikácie (iné vlákno, atomicky)
+
+    int Threads;                    // počet pracovných vlákien pre sim_run (0=podľa počtu CPU)
+    int Mode;                       // SIM_MODE_*
+    int Kernel;                     // SIM_KERNEL_* (výsledok je rovnaký, líši sa len rýchlosť)
+    int Estimator;                  // SIM_EST_* pre ďalšie replikácie (dá sa meniť medzi behmi)
+    uint32_t MaxSteps;              // limit krokov jednej prechádzky (0=bez limitu), dlhšie sú cenzurované
+    bool ProbOnly;                  // prechádzka končí po K krokoch (stačí pre P(do K), priemer nie)
+    int CheckpointReps;             // checkpoint počas sim_run každých N replikácií (0=nie)
+    int CheckpointSecs;             // ... alebo každých T sekúnd (0=nie); ide do ResultFilePath.ckpt0/1
+    int StateFormat;                // SIM_STATE_* pre sim_save_state (načítanie ho nemení -> DWALK1 sa uloží ako DWALK2)
+    uint64_t Seed;                  // koreň náhodných prúdov (0=zvolí sa pri prvom behu), ukladá sa do stavu
+    double ObstacleDensity;         // s ňou svet vygeneroval sim_generate_obstacles_connected (-1 = iný pôvod)
+    bool VarValid;                  // m2 zodpovedá všetkým dokončeným vzorkám (nie po recyklácii ani zo starého stavu)
+    struct Snapshots *Publish;      // NULL = sim_run nezverejňuje priebežné snímky (snapshot.h)
+    struct Trace *Trace;            // NULL = sim_run neprehráva prechádzky pre pozorovateľov (trace.h)
+
+    // --- interné polia pre sumár (kompaktné rozloženie, pozri SIM_TILE) ---
+    int TilesW;                     // dlaždíc v riadku
+    size_t Tiles;                   // polôh je Tiles * 64
+    size_t FreeCells;               // voľné bunky = prvky počítadiel
+    uint64_t *obstacle;             // Tiles slov, bit polohy = prekážka alebo bunka za okrajom
+    uint32_t *rank;                 // Tiles: voľné bunky pred dlaždicou (sim_build_transitions)
+    uint8_t *moves;                 // Tiles*64 (+3): SIM_MOVE_* smerov U,D,L,R po 2 bitoch od najnižších
+    uint64_t *steps_sum;            // FreeCells (NULL len v snímke bez prechádzok = všade 0)
+    uint64_t *hits_sum;             // FreeCells (počet zásahov do K; NULL ako steps_sum)
+    uint64_t *samples;              // FreeCells počet vzoriek bunky (NULL = každá ActRep - FirstRep)
+    uint64_t *censored;             // FreeCells z toho cenzurované, bez krokov aj zásahu v sumách (NULL = všade 0)
+    double *m2;                     // FreeCells Welfordov súčet štvorcov odchýlok krokov dokončených vzoriek (NULL = všade 0 alebo !VarValid)
+    double *exact_avg;              // H*W očakávaný počet krokov (len SIM_MODE_EXACT, inak NULL)
+    double *exact_prob;             // H*W pravdepodobnosť zásahu do K krokov (len SIM_MODE_EXACT)
+} Sim;
+
+// poloha bunky (r, c)
+static inline size_t sim_pos(const Sim *s, int r, int c) {
+    size_t tile = (size_t)(r >> SIM_TILE_SHIFT) * (size_t)s->TilesW + (size_t)(c >> SIM_TILE_SHIFT);
+    return tile << 6 | (size_t)((r & (SIM_TILE - 1)) << SIM_TILE_SHIFT | (c & (SIM_TILE - 1)));
+}
+
+// prekážka alebo bunka za okrajom sveta
+static inline bool sim_blocked(const Sim *s, size_t p) {
+    return (s->obstacle[p >> 6] >> (p & 63)) & 1;
+}
+
+// index počítadiel voľnej bunky na polohe p
+static inline size_t sim_slot(const Sim *s, size_t p) {
+    uint64_t before = ~s->obstacle[p >> 6] & (((uint64_t)1 << (p & 63)) - 1);
+    return s->rank[p >> 6] + (size_t)__builtin_popcountll(before);
+}
+
+typedef struct SimSolveInfo {
+    int iterations;                 // počet iterácií riešiča
+    double residual;                // max |1 + sum p*E(sused) - E| ~ relatívna chyba
+    bool converged;
+} SimSolveInfo;
+
+bool sim_init_empty(Sim *s, int h, int w, bool worldType);
+// ako sim_init_empty, ale len s mapou prekážok: volajúci ju naplní (sim_store_obstacle)
+// a potom raz zavolá sim_build_transitions (načítanie stavu a sveta, generátor)
+bool sim_init_alloc(Sim *s, int h, int w, bool worldType);
+void sim_free(Sim *s);
+// m2 sa alokuje až keď ho treba (beh s Welfordom, načítanie, zlúčenie pri VarValid)
+bool sim_m2_alloc(Sim *s);
+// Pri SIM_EST_START bez limitu krokov má každá voľná bunka ActRep - FirstRep vzoriek a žiadnu
+// cenzurovanú, polia samples a censored sa preto alokujú až pri recyklácii, adaptívnom behu,
+// prvej cenzurovanej prechádzke, zlúčení alebo načítaní iných hodnôt. Čítať cez tieto funkcie.
+// Bunky sú tu indexy i = r*W + c; prekážka má všetky počítadlá 0.
+bool sim_cell_obstacle(const Sim *s, size_t i);
+uint64_t sim_cell_steps(const Sim *s, size_t i);
+uint64_t sim_cell_hits(const Sim *s, size_t i);
+uint64_t sim_cell_samples(const Sim *s, size_t i);
+uint64_t sim_cell_censored(const Sim *s, size_t i);
+// index bunky na polohe p (sim_pos)
+size_t sim_cell_index(const Sim *s, size_t p);
+// index bunky, kam vedie krok v smere d (0..3 = U,D,L,R) z voľnej bunky i
+size_t sim_cell_step(const Sim *s, size_t i, int d);
+// dst[0 .. hi-lo) = hodnoty buniek lo .. hi-1 poľa arr (SIM_*), po riadkoch sveta (snímky,
+// ukladanie, protokol); m2 ako bity double
+void sim_fill(const Sim *s, int arr, uint64_t *dst, size_t lo, size_t hi);
+void sim_fill_obstacle(const Sim *s, bool *dst, size_t lo, size_t hi);
+// Opačný smer pri načítaní: hodnoty prekážok sa ignorujú. samples, censored a m2 sa
+// alokujú až pri prvej hodnote, ktorá sa líši od implicitnej (obstacle a ActRep už
+// musia byť načítané). false = nedostatok pamäte.
+bool sim_store(Sim *s, int arr, const uint64_t *src, size_t lo, size_t hi);
+// prekážky buniek lo .. hi-1 (len pri WorldType); potom treba sim_build_transitions
+void sim_store_obstacle(Sim *s, const bool *src, size_t lo, size_t hi);
+// rozbalí samples (censored vynuluje) do vlastného poľa; už alokované nechá
+bool sim_samples_alloc(Sim *s);
+bool sim_censored_alloc(Sim *s);
+
+// náhodné prekážky s hustotou obstacleDensity (0..SIM_OBSTACLE_DENSITY_MAX), každá voľná
+// bunka je spojená so stredom; O(H*W), rovnaký seed = rovnaký svet
+bool sim_generate_obstacles_connected(Sim *s, double obstacleDensity, uint64_t seed);
+// Po naplnení alebo zmene prekážok zostaví index voľných buniek (rank), tabuľku krokov
+// (moves) a alokuje vynulované počítadlá (staré zahodí). Generátor a načítanie to volajú samé.
+bool sim_build_transitions(Sim *s);
+// posun polohy pre krok: delta[moves[p] * 4 + smer] (jadrá prechádzok)
+void sim_move_deltas(const Sim *s, int32_t delta[256 * 4]);
+
+bool sim_run(Sim *s, int addReps, uint64_t seed);
+// Adaptívny beh: v každom kole (replikácii) dostanú prechádzku len bunky, ktorých 95 %
+// interval metric (SIM_CI_*) je ešte širší než precision; skončí, keď sú presné všetky,
+// alebo po maxReps kolách. Potrebuje SIM_EST_START, SIM_CI_AVG aj VarValid.
+bool sim_run_until(Sim *s, double precision, int metric, int maxReps, uint64_t seed);
+// koľko vlákien použije sim_run (Threads alebo počet CPU, najviac jedno na riadok dlaždíc)
+int sim_thread_count(const Sim *s);
+// Exaktná očakávaná doba zásahu stredu: E[v] = 1 + sum p_d*E[next_d(v)], E[stred] = 0.
+// Iteratívne (BiCGSTAB na stencile mriežky), zastaví sa pri reziduu <= tol (alebo po maxIter).
+// Výsledok je v s->exact_avg (INFINITY pre bunky, z ktorých sa stred nedá dosiahnuť s istotou).
+// false len pri nedostatku pamäte alebo vlákien; či riešič konvergoval, je v info->converged
+// (svet bez neznámych konverguje s 0 iteráciami).
+bool sim_solve_expected(Sim *s, double tol, int maxIter, SimSolveInfo *info);
+// Exaktná pravdepodobnosť zásahu stredu do K krokov: K ťahov stencilu cez mriežku
+// (deterministické, O(K*H*W)). Výsledok je v s->exact_prob.
+bool sim_solve_hit_prob(Sim *s);
+
+// hodnoty sumáru pre bunku i (podľa Mode, delí sa počtom vzoriek bunky; prekážky volajúci rieši sám)
+// priemer je len cez necenzurované prechádzky, pravdepodobnosť cez všetky
+double sim_cell_avg(const Sim *s, size_t i);
+double sim_cell_prob(const Sim *s, size_t i);
+// počet cenzurovaných vzoriek a všetkých vzoriek v Monte Carlo sumári
+uint64_t sim_censored_total(const Sim *s, uint64_t *samplesTotal);
+// polovica 95 % intervalu bunky i (SIM_CI_AVG relatívne k priemeru); INFINITY ak je málo vzoriek
+double sim_cell_ci(const Sim *s, size_t i, int metric);
+// koľko voľných buniek (okrem stredu) ešte nemá interval do precision
+size_t sim_ci_pending(const Sim *s, double precision, int metric);
+
+// Pripočíta sumy inej časti tej istej simulácie (rovnaký svet, parametre a seed, iné
+// replikácie): počítadlá sa sčítajú presne, m2 sa spojí Chanovým vzorcom (NULL = časť
+// rozptyl nemá, VarValid sa zruší). Polia majú H*W prvkov po riadkoch sveta, časť má reps replikácií; ActRep
+// upraví volajúci. false = nedostatok pamäte (s ostane nezmenený).
+bool sim_merge_counts(Sim *s, const uint64_t *steps, const uint64_t *hits, const uint64_t *samples,
+                      const uint64_t *censored, const double *m2, int reps);
+
+// atomicky cez <path>.tmp (fsync + rename), pri chybe ostane pôvodný súbor
+bool sim_save_state(const Sim *s, const char *path);
+bool sim_load_state(Sim *s, const char *path);
+
+
+#endif
+
@@ -0,0 +1,266 @@
+// snapshot.c - zverejňovanie snímok simulácie pre súbežných čitateľov
+#include "snapshot.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SNAPSHOT_SPARE 2            // voľné buffre odložené na ďalšie zverejnenie
+
+struct Snapshots {
+    pthread_mutex_t lock;           // len na výmenu ukazovateľov a počítadlá referencií
+    uint64_t *obstacle;             // kópia mapy prekážok a indexu voľných buniek, zdieľaná všetkými snímkami
+    uint32_t *rank;
+    size_t tiles;
+    int tilesW;
+    size_t freeCells;               // prvky polí snímky
+    size_t cells;                   // H*W, exaktné polia
+    bool exact;
+    int intervalMs;
+    double last;
+
+    SimSnapshot *front;             // posledná zverejnená (má aj referenciu od Snapshots)
+    SimSnapshot *back;              // práve sa plní v sim_run
+    SimSnapshot *spare[SNAPSHOT_SPARE];
+    int nspare;
+    uint64_t seq;
+    int refs;                       // vlastník + vydané snímky
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void buffer_free(SimSnapshot *b) {
+    if (!b) return;
+    for (int a = 0; a < 4; a++) free(b->arrays[a]);
+    free(b->m2);
+    free(b->exact[0]);
+    free(b->exact[1]);
+    free(b);
+}
+
+static SimSnapshot *buffer_new(Snapshots *p) {
+    SimSnapshot *b = (SimSnapshot*)calloc(1, sizeof(SimSnapshot));
+    if (!b) return NULL;
+    bool ok = true;
+    if (p->exact) {
+        b->exact[0] = (double*)malloc(p->cells * sizeof(double));
+        b->exact[1] = (double*)malloc(p->cells * sizeof(double));
+        if (!b->exact[0] || !b->exact[1]) ok = false;
+    }
+    if (!ok) {
+        buffer_free(b);
+        return NULL;
+    }
+    b->owner = p;
+    return b;
+}
+
+// volá sa pod zámkom; polia dostane buffer až keď ich treba (odložený ich môže mať z minula):
+// steps a hits pri counts, samples a censored ak ich má s, m2 pri withM2
+static SimSnapshot *buffer_take(Snapshots *p, const Sim *s, bool counts, bool withM2) {
+    SimSnapshot *b = p->nspare > 0 ? p->spare[--p->nspare] : buffer_new(p);
+    if (!b) return NULL;
+    size_t n = p->freeCells ? p->freeCells : 1;
+    bool ok = true;
+    for (int a = 0; counts && a < 2; a++)
+        if (!b->arrays[a]) ok = ok && (b->arrays[a] = (uint64_t*)malloc(n * sizeof(uint64_t))) != NULL;
+    if (s->samples && !b->arrays[2]) ok = (b->arrays[2] = (uint64_t*)malloc(n * sizeof(uint64_t))) != NULL;
+    if (s->censored && !b->arrays[3]) ok = ok && (b->arrays[3] = (uint64_t*)malloc(n * sizeof(uint64_t))) != NULL;
+    if (withM2 && !b->m2) ok = ok && (b->m2 = (double*)malloc(n * sizeof(double))) != NULL;
+    if (!ok) {
+        buffer_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+// volá sa pod zámkom s bufferom, na ktorý už nikto neukazuje
+static void buffer_put(Snapshots *p, SimSnapshot *b) {
+    if (p->nspare < SNAPSHOT_SPARE) p->spare[p->nspare++] = b;
+    else buffer_free(b);
+}
+
+static void hub_free(Snapshots *p) {
+    buffer_free(p->back);
+    for (int k = 0; k < p->nspare; k++) buffer_free(p->spare[k]);
+    free(p->obstacle);
+    free(p->rank);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+// zníži referenciu snímky aj Snapshots; volá sa pod zámkom, vráti či treba uvoľniť Snapshots
+static bool unref(Snapshots *p, SimSnapshot *b) {
+    if (--b->refs == 0) buffer_put(p, b);
+    return --p->refs == 0;
+}
+
+Snapshots *snapshots_create(const Sim *s, int intervalMs) {
+    Snapshots *p = (Snapshots*)calloc(1, sizeof(Snapshots));
+    if (!p) return NULL;
+    p->cells = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+    p->tiles = s->Tiles;
+    p->tilesW = s->TilesW;
+    p->freeCells = s->FreeCells;
+    p->exact = s->Mode == SIM_MODE_EXACT;
+    p->intervalMs = intervalMs;
+    p->refs = 1;
+    p->obstacle = (uint64_t*)malloc(p->tiles * sizeof(uint64_t));
+    p->rank = (uint32_t*)malloc(p->tiles * sizeof(uint32_t));
+    if (!p->obstacle || !p->rank) {
+        free(p->obstacle);
+        free(p->rank);
+        free(p);
+        return NULL;
+    }
+    memcpy(p->obstacle, s->obstacle, p->tiles * sizeof(uint64_t));
+    memcpy(p->rank, s->rank, p->tiles * sizeof(uint32_t));
+    pthread_mutex_init(&p->lock, NULL);
+    return p;
+}
+
+void snapshots_destroy(Snapshots *p) {
+    if (!p) return;
+    pthread_mutex_lock(&p->lock);
+    if (p->front) unref(p, p->front); // vlastník ešte drží referenciu
+    p->front = NULL;
+    bool last = --p->refs == 0;
+    pthread_mutex_unlock(&p->lock);
+    if (last) hub_free(p);
+}
+
+bool snapshots_due(Snapshots *p, const Sim *s, bool withM2) {
+    double t = now_sec();
+    pthread_mutex_lock(&p->lock);
+    bool ok = p->intervalMs <= 0 || (t - p->last) * 1000.0 >= (double)p->intervalMs;
+    if (ok && !p->back) p->back = buffer_take(p, s, true, withM2);
+    ok = ok && p->back != NULL;
+    pthread_mutex_unlock(&p->lock);
+    return ok;
+}
+
+uint64_t **snapshots_arrays(Snapshots *p) {
+    return p->back->arrays;
+}
+
+double *snapshots_m2(Snapshots *p) {
+    return p->back->m2;
+}
+
+// skaláry zo s, polia ostávajú snímky; po poliach, lebo SimEnd môže práve meniť iné vlákno.
+// counts = false: snímka bez prechádzok, steps a hits ostanú NULL (všade 0)
+static void fill_view(Snapshots *p, SimSnapshot *b, const Sim *s, bool counts) {
+    memset(&b->view, 0, sizeof(b->view));
+    b->view.WorldType = s->WorldType;
+    b->view.WorldHeight = s->WorldHeight;
+    b->view.WorldWidth = s->WorldWidth;
+    b->view.MaxReps = s->MaxReps;
+    b->view.ActRep = s->ActRep;
+    memcpy(b->view.MoveProbs, s->MoveProbs, sizeof(s->MoveProbs));
+    b->view.K = s->K;
+    b->view.Mode = s->Mode;
+    b->view.Estimator = s->Estimator;
+    b->view.MaxSteps = s->MaxSteps;
+    b->view.ProbOnly = s->ProbOnly;
+    b->view.Seed = s->Seed;
+    b->view.FirstRep = s->FirstRep;
+    // m2 snímky platí, len ak sa rozptyl vedie a buffer ho má (inak ho nikto nenaplnil)
+    b->view.VarValid = s->VarValid && b->m2;
+    b->view.m2 = b->view.VarValid ? b->m2 : NULL;
+    b->view.TilesW = p->tilesW;
+    b->view.Tiles = p->tiles;
+    b->view.FreeCells = p->freeCells;
+    b->view.obstacle = p->obstacle;
+    b->view.rank = p->rank;
+    b->view.steps_sum = counts ? b->arrays[0] : NULL;
+    b->view.hits_sum = counts ? b->arrays[1] : NULL;
+    b->view.samples = b->arrays[2];
+    b->view.censored = b->arrays[3];
+    // exaktné polia len ak ich Sim už má (pred dobehnutím riešiča ostanú NULL)
+    b->view.exact_avg = s->exact_avg ? b->exact[0] : NULL;
+    b->view.exact_prob = s->exact_prob ? b->exact[1] : NULL;
+}
+
+// volá sa pod zámkom: b je úplný, nahradí front
+static void swap_front(Snapshots *p, SimSnapshot *b) {
+    b->published = now_sec();
+    b->seq = ++p->seq;
+    b->refs = 1;
+    p->refs++;
+    if (p->front) unref(p, p->front); // vlastník drží referenciu, Snapshots sa tu neuvoľní
+    p->front = b;
+    p->last = b->published;
+}
+
+void snapshots_submit(Snapshots *p, const Sim *s) {
+    pthread_mutex_lock(&p->lock);
+    SimSnapshot *b = p->back;
+    p->back = NULL;
+    pthread_mutex_unlock(&p->lock);
+    fill_view(p, b, s, true);
+    pthread_mutex_lock(&p->lock);
+    swap_front(p, b);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// nová simulácia (aj exaktná) ešte nemá žiadnu prechádzku -> snímka nepotrebuje kópiu súm
+static bool counts_zero(const Sim *s) {
+    for (size_t k = 0; k < s->FreeCells; k++)
+        if (s->steps_sum[k] | s->hits_sum[k]) return false;
+    return true;
+}
+
+bool snapshots_publish(Snapshots *p, const Sim *s) {
+    pthread_mutex_lock(&p->lock);
+    bool counts = !counts_zero(s);
+    SimSnapshot *b = buffer_take(p, s, counts, s->VarValid);
+    pthread_mutex_unlock(&p->lock);
+    if (!b) return false;
+
+    size_t n = p->freeCells;
+    if (counts) {
+        memcpy(b->arrays[0], s->steps_sum, n * sizeof(uint64_t));
+        memcpy(b->arrays[1], s->hits_sum, n * sizeof(uint64_t));
+    }
+    // buffer z minula môže mať polia, ktoré Sim nemá -> implicitné hodnoty (sim.h)
+    for (size_t k = 0; b->arrays[2] && k < n; k++) b->arrays[2][k] = s->samples ? s->samples[k] : (uint64_t)(s->ActRep - s->FirstRep);
+    if (b->arrays[3] && s->censored) memcpy(b->arrays[3], s->censored, n * sizeof(uint64_t));
+    else if (b->arrays[3]) memset(b->arrays[3], 0, n * sizeof(uint64_t));
+    if (s->VarValid && b->m2 && s->m2) memcpy(b->m2, s->m2, n * sizeof(double));
+    else if (s->VarValid && b->m2) memset(b->m2, 0, n * sizeof(double));
+    // Mode sa za života Snapshots nemení, exaktné polia má buffer práve vtedy, keď ich môže mať Sim
+    if (p->exact && s->exact_avg) memcpy(b->exact[0], s->exact_avg, p->cells * sizeof(double));
+    if (p->exact && s->exact_prob) memcpy(b->exact[1], s->exact_prob, p->cells * sizeof(double));
+    fill_view(p, b, s, counts);
+
+    pthread_mutex_lock(&p->lock);
+    swap_front(p, b);
+    pthread_mutex_unlock(&p->lock);
+    return true;
+}
+
+SimSnapshot *snapshots_acquire(Snapshots *p) {
+    if (!p) return NULL;
+    pthread_mutex_lock(&p->lock);
+    SimSnapshot *b = p->front;
+    if (b) {
+        b->refs++;
+        p->refs++;
+    }
+    pthread_mutex_unlock(&p->lock);
+    return b;
+}
+
+void snapshot_release(SimSnapshot *snap) {
+    if (!snap) return;
+    Snapshots *p = snap->owner;
+    pthread_mutex_lock(&p->lock);
+    bool last = unref(p, snap);
+    pthread_mutex_unlock(&p->lock);
+    if (last) hub_free(p);
+}
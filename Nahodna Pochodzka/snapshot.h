@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+// Zverejnené snímky simulácie pre čitateľov počas behu (server: sumáre, JOB_STATUS).
+// sim_run na hranici replikácie zráta sumy vlákien do voľného bufferu a zverejní ho;
+// čitateľ si vezme referenciu na posledný zverejnený a číta ho bez zámku, kým ho
+// neuvoľní. Zverejnená snímka sa nikdy neprepisuje, takže čitateľ nečaká na simuláciu
+// a simulácia nečaká na čitateľa (pri pomalom čitateľovi sa pridá ďalší buffer).
+typedef struct Snapshots Snapshots;
+
+typedef struct SimSnapshot {
+    Sim view;                       // parametre simulácie + polia snímky (moves je NULL, steps a hits pred prvou prechádzkou tiež), len na čítanie
+    double published;               // čas zverejnenia (CLOCK_MONOTONIC, s)
+    uint64_t seq;                   // poradie zverejnenia
+    int refs;                       // interné
+    Snapshots *owner;               // interné
+    uint64_t *arrays[4];            // interné: steps_sum, hits_sum, samples, censored (FreeCells; alokujú sa až keď ich treba)
+    double *m2;                     // interné: m2 (alokuje sa, keď ho prvýkrát treba)
+    double *exact[2];               // interné: exact_avg, exact_prob (len SIM_MODE_EXACT)
+} SimSnapshot;
+
+// mapa prekážok s indexom voľných buniek (a Mode kvôli exaktným poliam) sa prevezme zo s;
+// počas života sa nemenia
+Snapshots *snapshots_create(const Sim *s, int intervalMs);
+// zruší vlastníkovu referenciu; pamäť sa uvoľní po poslednom snapshot_release
+void snapshots_destroy(Snapshots *p);
+
+// volá jedno vlákno na hranici replikácie: uplynul interval od posledného zverejnenia?
+// Ak áno, pripraví buffer, do ktorého vlákna sčítajú svoje úseky (snapshots_arrays);
+// samples a censored dostane, len ak ich s už má, withM2 = beh vedie rozptyl, buffer
+// dostane aj m2 (snapshots_m2).
+bool snapshots_due(Snapshots *p, const Sim *s, bool withM2);
+uint64_t **snapshots_arrays(Snapshots *p);
+// m2 pripraveného buffra; NULL, ak sa rozptyl nevedie
+double *snapshots_m2(Snapshots *p);
+// pripravený buffer je úplný -> zverejní sa so skalármi zo s (view.m2 len pri VarValid)
+void snapshots_submit(Snapshots *p, const Sim *s);
+// zverejní priamo obsah s (mimo sim_run, napr. po skončení behu alebo riešiča)
+bool snapshots_publish(Snapshots *p, const Sim *s);
+
+// posledná zverejnená snímka (NULL ak ešte nebola žiadna); treba ju vrátiť snapshot_release
+SimSnapshot *snapshots_acquire(Snapshots *p);
+void snapshot_release(SimSnapshot *snap);
+
+#endif
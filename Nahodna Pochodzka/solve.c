@@ -0,0 +1,565 @@
+// solve.c - exaktné výsledky bez Monte Carlo (riešenie Markovovho reťazca na mriežke)
+#include "sim.h"
+#include "pool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOLVE_CELLS_PER_THREAD 4096 // menej buniek na vlákno sa neoplatí (bariéry)
+
+static inline bool is_free(const Sim *s, size_t i) {
+    return !sim_cell_obstacle(s, i);
+}
+
+// Bunky s konečnou očakávanou dobou: z nich sa do stredu dá dostať a zároveň sa
+// z nich nedá dostať do bunky, odkiaľ stred nedosiahnuteľný (napr. pri p=0 v smere).
+static bool *finite_cells(const Sim *s) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    size_t n = (size_t)H * (size_t)W;
+    uint32_t center = (uint32_t)((H/2) * W + W/2);
+    const int dr[4] = {-1, +1, 0, 0};
+    const int dc[4] = {0, 0, -1, +1};
+
+    bool *reach = (bool*)calloc(n, sizeof(bool));
+    bool *inf = (bool*)calloc(n, sizeof(bool));
+    uint32_t *q = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!reach || !inf || !q) { free(reach); free(inf); free(q); return NULL; }
+
+    // spätné BFS: predchodca v bunky u v smere d je sused u v opačnom smere
+    size_t qh = 0, qt = 0;
+    reach[center] = true;
+    q[qt++] = center;
+    for (int pass = 0; pass < 2; pass++) {
+        bool *mark = pass == 0 ? reach : inf;
+        while (qh < qt) {
+            uint32_t u = q[qh++];
+            int r = (int)(u / (uint32_t)W), c = (int)(u % (uint32_t)W);
+            for (int d = 0; d < 4; d++) {
+                if (s->MoveProbs[d] <= 0.0) continue;
+                int pr = ((r - dr[d]) % H + H) % H;
+                int pc = ((c - dc[d]) % W + W) % W;
+                uint32_t v = (uint32_t)(pr * W + pc);
+                if (v == u || mark[v] || !is_free(s, v) || sim_cell_step(s, v, d) != u) continue;
+                if (pass == 1 && v == center) continue; // stred je absorpčný
+                mark[v] = true;
+                q[qt++] = v;
+            }
+        }
+        if (pass == 1) break;
+
+        // druhý prechod: všetko, čo vedie do nedosiahnuteľných buniek, má nekonečnú dobu
+        qh = qt = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (is_free(s, i) && !reach[i]) { inf[i] = true; q[qt++] = (uint32_t)i; }
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) reach[i] = is_free(s, i) && !inf[i];
+    free(inf);
+    free(q);
+    return reach;
+}
+
+// Neznáme sú bunky s konečnou dobou okrem stredu. Sústava (I - P) E = 1 je bez driftu
+// (pU = pD, pL = pR) symetrická a kladne definitná -> CG, s driftom nie -> BiCGSTAB.
+// Obe s diagonálnym predpodmienením (diagonála = 1 - pravdepodobnosť ostať na mieste).
+// Vektory majú plnú dĺžku H*W, mimo neznámych sú 0 -> A*y je priamo stencil cez susedov neznámej.
+typedef struct SolveCtx {
+    const Sim *s;
+    uint32_t *cells;                // neznáme
+    uint32_t *nbr;                  // 4 susedia neznámej k (sim_cell_step), U, D, L, R
+    size_t count;
+    double *invDiag;
+    double tol;
+    int maxIter;
+    bool symmetric;
+
+    double *x, *r, *rh, *p, *v, *y, *z, *t;
+    double *part;                   // čiastočné súčty po vláknach (3 na vlákno)
+    double sum[3];
+    SimSolveInfo info;
+} SolveCtx;
+
+static void slice_of(size_t count, int tid, int nth, size_t *from, size_t *to) {
+    *from = count * (size_t)tid / (size_t)nth;
+    *to = count * (size_t)(tid + 1) / (size_t)nth;
+}
+
+// out = (I - P) in na neznámej k
+static inline double apply_at(const SolveCtx *ctx, const double *in, size_t k) {
+    const uint32_t *nx = &ctx->nbr[k * 4];
+    const double *pr = ctx->s->MoveProbs;
+    return in[ctx->cells[k]] - (pr[0] * in[nx[0]] + pr[1] * in[nx[1]] + pr[2] * in[nx[2]] + pr[3] * in[nx[3]]);
+}
+
+// súčet cnt čiastočných výsledkov všetkých vlákien (všetci dostanú rovnaké ctx->sum)
+static void reduce(Pool *p, SolveCtx *ctx, int tid, const double *loc, int cnt) {
+    int nth = pool_size(p);
+    for (int k = 0; k < cnt; k++) ctx->part[tid * 3 + k] = loc[k];
+    if (pool_barrier(p)) {
+        for (int k = 0; k < cnt; k++) {
+            double acc = 0.0;
+            for (int t = 0; t < nth; t++) acc += ctx->part[t * 3 + k];
+            ctx->sum[k] = acc;
+        }
+    }
+    pool_barrier(p);
+}
+
+static void reduce_max(Pool *p, SolveCtx *ctx, int tid, double loc) {
+    int nth = pool_size(p);
+    ctx->part[tid * 3] = loc;
+    if (pool_barrier(p)) {
+        double m = 0.0;
+        for (int t = 0; t < nth; t++) if (ctx->part[t * 3] > m) m = ctx->part[t * 3];
+        ctx->sum[0] = m;
+    }
+    pool_barrier(p);
+}
+
+// skutočné max |1 - A x| (rekurzívne reziduum sa môže od neho odchýliť)
+static double true_residual(Pool *p, SolveCtx *ctx, int tid, size_t from, size_t to) {
+    double rmax = 0.0;
+    for (size_t k = from; k < to; k++) {
+        double rr = fabs(1.0 - apply_at(ctx, ctx->x, k));
+        if (rr > rmax) rmax = rr;
+    }
+    reduce_max(p, ctx, tid, rmax);
+    return ctx->sum[0];
+}
+
+static void finish(SolveCtx *ctx, int tid, int it, double res) {
+    if (tid != 0) return;
+    ctx->info.iterations = it;
+    ctx->info.residual = res;
+    ctx->info.converged = res <= ctx->tol;
+}
+
+// spoločný koniec iterácie: pri malom rekurzívnom reziduu over skutočné 1 - A x;
+// vráti true, ak treba skončiť, inak nastaví *restart
+static bool check_done(Pool *p, SolveCtx *ctx, int tid, size_t from, size_t to, int it, double res, bool *restart) {
+    if (!(res <= ctx->tol || !isfinite(res) || it >= ctx->maxIter)) return false;
+    res = true_residual(p, ctx, tid, from, to);
+    finish(ctx, tid, it, res);
+    if (res <= ctx->tol || !isfinite(res) || it >= ctx->maxIter) return true;
+    *restart = true;
+    return false;
+}
+
+// Rozpad (delenie nulou): reštart z aktuálneho x, ale hneď po reštarte by sa zopakoval
+// rovnako a po maxIter už neostáva čas -> koniec so skutočným reziduom (presné x má r = 0
+// a tiež sa rozpadne, vtedy je to konvergencia). Vráti true, ak treba skončiť.
+static bool breakdown(Pool *p, SolveCtx *ctx, int tid, size_t from, size_t to, int it, bool fresh, bool *restart) {
+    double res = true_residual(p, ctx, tid, from, to);
+    if (res > ctx->tol && isfinite(res) && !fresh && it < ctx->maxIter) {
+        *restart = true;
+        return false;
+    }
+    finish(ctx, tid, it, res);
+    return true;
+}
+
+static void cg_worker(Pool *p, int tid, void *arg) {
+    SolveCtx *ctx = (SolveCtx*)arg;
+    size_t from, to;
+    slice_of(ctx->count, tid, pool_size(p), &from, &to);
+    const uint32_t *cells = ctx->cells;
+    double *x = ctx->x, *r = ctx->r, *pv = ctx->p, *q = ctx->v, *z = ctx->z;
+    double loc[2];
+
+    bool restart = true, fresh = false;  // fresh = prvá iterácia po reštarte
+    double rz = 0.0;
+    for (int it = 1; ; it++) {
+        if (restart) {
+            pool_barrier(p);
+            loc[0] = 0.0;
+            for (size_t k = from; k < to; k++) {
+                uint32_t c = cells[k];
+                r[c] = 1.0 - apply_at(ctx, x, k);
+                z[c] = r[c] * ctx->invDiag[c];
+                pv[c] = z[c];
+                loc[0] += r[c] * z[c];
+            }
+            reduce(p, ctx, tid, loc, 1);
+            rz = ctx->sum[0];
+            restart = false;
+            fresh = true;
+        }
+
+        loc[0] = 0.0;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            q[c] = apply_at(ctx, pv, k);
+            loc[0] += pv[c] * q[c];
+        }
+        reduce(p, ctx, tid, loc, 1);
+        if (ctx->sum[0] <= 0.0) {
+            if (breakdown(p, ctx, tid, from, to, it, fresh, &restart)) break;
+            continue;
+        }
+        double alpha = rz / ctx->sum[0];
+
+        double rmax = 0.0;
+        loc[0] = 0.0;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            x[c] += alpha * pv[c];
+            r[c] -= alpha * q[c];
+            z[c] = r[c] * ctx->invDiag[c];
+            loc[0] += r[c] * z[c];
+            if (fabs(r[c]) > rmax) rmax = fabs(r[c]);
+        }
+        reduce(p, ctx, tid, loc, 1);
+        double rzNew = ctx->sum[0];
+        reduce_max(p, ctx, tid, rmax);
+        if (check_done(p, ctx, tid, from, to, it, ctx->sum[0], &restart)) break;
+        if (restart) continue;
+        fresh = false;
+
+        double beta = rzNew / rz;
+        rz = rzNew;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            pv[c] = z[c] + beta * pv[c];
+        }
+        pool_barrier(p);
+    }
+}
+
+static void bicgstab_worker(Pool *p, int tid, void *arg) {
+    SolveCtx *ctx = (SolveCtx*)arg;
+    size_t from, to;
+    slice_of(ctx->count, tid, pool_size(p), &from, &to);
+    const uint32_t *cells = ctx->cells;
+    double *x = ctx->x, *r = ctx->r, *rh = ctx->rh, *pv = ctx->p, *v = ctx->v;
+    double *y = ctx->y, *z = ctx->z, *t = ctx->t;
+    double loc[2];
+
+    bool restart = true, fresh = false;
+    double rho = 1.0, alpha = 1.0, omega = 1.0;
+    for (int it = 1; ; it++) {
+        if (restart) {
+            // r = 1 - A x, tieňové reziduum = r (aj po strate presnosti / rozpade)
+            pool_barrier(p);
+            for (size_t k = from; k < to; k++) {
+                uint32_t c = cells[k];
+                r[c] = 1.0 - apply_at(ctx, x, k);
+                rh[c] = r[c];
+                pv[c] = 0.0;
+                v[c] = 0.0;
+            }
+            rho = alpha = omega = 1.0;
+            restart = false;
+            fresh = true;
+        }
+
+        loc[0] = 0.0;
+        for (size_t k = from; k < to; k++) loc[0] += rh[cells[k]] * r[cells[k]];
+        reduce(p, ctx, tid, loc, 1);
+        double rhoNew = ctx->sum[0];
+        if (rhoNew == 0.0 || omega == 0.0) {
+            if (breakdown(p, ctx, tid, from, to, it, fresh, &restart)) break;
+            continue;
+        }
+
+        double beta = (rhoNew / rho) * (alpha / omega);
+        rho = rhoNew;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            pv[c] = r[c] + beta * (pv[c] - omega * v[c]);
+            y[c] = pv[c] * ctx->invDiag[c];
+        }
+        pool_barrier(p);
+
+        loc[0] = 0.0;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            v[c] = apply_at(ctx, y, k);
+            loc[0] += rh[c] * v[c];
+        }
+        reduce(p, ctx, tid, loc, 1);
+        if (ctx->sum[0] == 0.0) {
+            if (breakdown(p, ctx, tid, from, to, it, fresh, &restart)) break;
+            continue;
+        }
+        alpha = rho / ctx->sum[0];
+
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            x[c] += alpha * y[c];
+            r[c] -= alpha * v[c];               // r je teraz s
+            z[c] = r[c] * ctx->invDiag[c];
+        }
+        pool_barrier(p);
+
+        loc[0] = loc[1] = 0.0;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            t[c] = apply_at(ctx, z, k);
+            loc[0] += t[c] * r[c];
+            loc[1] += t[c] * t[c];
+        }
+        reduce(p, ctx, tid, loc, 2);
+        omega = ctx->sum[1] > 0.0 ? ctx->sum[0] / ctx->sum[1] : 0.0;
+
+        double rmax = 0.0;
+        for (size_t k = from; k < to; k++) {
+            uint32_t c = cells[k];
+            x[c] += omega * z[c];
+            r[c] -= omega * t[c];
+            if (fabs(r[c]) > rmax) rmax = fabs(r[c]);
+        }
+        reduce_max(p, ctx, tid, rmax);
+        if (check_done(p, ctx, tid, from, to, it, ctx->sum[0], &restart)) break;
+        fresh = false;
+    }
+}
+
+bool sim_solve_expected(Sim *s, double tol, int maxIter, SimSolveInfo *info) {
+    if (!s || !s->moves) return false;
+    if (tol <= 0.0) tol = 1e-8;
+    if (maxIter <= 0) maxIter = 100000;
+
+    int H = s->WorldHeight, W = s->WorldWidth;
+    size_t n = (size_t)H * (size_t)W;
+    uint32_t center = (uint32_t)((H/2) * W + W/2);
+
+    if (!s->exact_avg) s->exact_avg = (double*)malloc(n * sizeof(double));
+    bool *finite = finite_cells(s);
+
+    SolveCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.s = s;
+    ctx.tol = tol;
+    ctx.maxIter = maxIter;
+    ctx.x = s->exact_avg;
+    ctx.symmetric = s->MoveProbs[0] == s->MoveProbs[1] && s->MoveProbs[2] == s->MoveProbs[3];
+    double **vecs[] = {&ctx.r, &ctx.rh, &ctx.p, &ctx.v, &ctx.y, &ctx.z, &ctx.t, &ctx.invDiag};
+    bool ok = ctx.x && finite;
+    for (size_t k = 0; k < sizeof(vecs) / sizeof(vecs[0]); k++) {
+        *vecs[k] = (double*)calloc(n, sizeof(double));
+        if (!*vecs[k]) ok = false;
+    }
+    ctx.cells = (uint32_t*)malloc(n * sizeof(uint32_t));
+    ctx.nbr = (uint32_t*)malloc(s->FreeCells * 4 * sizeof(uint32_t));
+    if (!ctx.cells || !ctx.nbr) ok = false;
+
+    if (ok) {
+        for (size_t i = 0; i < n; i++) {
+            // mimo neznámych (stred, prekážky, nekonečné bunky) je všetko 0
+            ctx.x[i] = 0.0;
+            if (i == center || !is_free(s, i) || !finite[i]) continue;
+            double sp = 0.0;
+            for (int d = 0; d < 4; d++) {
+                size_t v = sim_cell_step(s, i, d);
+                ctx.nbr[ctx.count * 4 + (size_t)d] = (uint32_t)v;
+                if (v == i) sp += s->MoveProbs[d];
+            }
+            ctx.invDiag[i] = 1.0 / (1.0 - sp);
+            ctx.cells[ctx.count++] = (uint32_t)i;
+        }
+
+        int nthreads = pool_threads(s->Threads, (int)(ctx.count / SOLVE_CELLS_PER_THREAD) + 1);
+        ctx.part = (double*)calloc((size_t)nthreads * 3, sizeof(double));
+        if (ctx.count > 0) {
+            PoolFn fn = ctx.symmetric ? cg_worker : bicgstab_worker;
+            if (!ctx.part || pool_run(nthreads, fn, &ctx) == 0) ok = false;
+        } else {
+            ctx.info.converged = true;
+        }
+        free(ctx.part);
+        for (size_t i = 0; i < n; i++) if (is_free(s, i) && !finite[i]) ctx.x[i] = INFINITY;
+    }
+
+    free(finite);
+    for (size_t k = 0; k < sizeof(vecs) / sizeof(vecs[0]); k++) free(*vecs[k]);
+    free(ctx.cells);
+    free(ctx.nbr);
+    if (info) *info = ctx.info;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// P(zásah do K krokov): P_0 = [v == stred], P_k(v) = sum p_d*P_{k-1}(next_d(v)), P_k(stred) = 1.
+// Zablokovaný krok znamená ostať na mieste, takže s maskou voľných buniek m (1.0/0.0) je
+//   P_k(v) = m(v) * (x + sum p_d*m(sused_d)*(P_{k-1}(sused_d) - x)),  x = P_{k-1}(v)
+// čo je čistý 5-bodový stencil bez vetvenia -> vnútro riadku kompilátor vektorizuje.
+// Veľké svety idú po dlaždiciach riadkov s okrajom T riadkov: T krokov sa spraví v lokálnom
+// buffri (zmestí sa do L2) a späť sa zapíše len jadro dlaždice, teda T-krát menej prenosov z RAM.
+#define HITPROB_TILE_BYTES (1024 * 1024) // dva lokálne buffre dlaždice na vlákno (~L2)
+#define HITPROB_MAX_STEPS 8             // T - viac krokov na kolo = viac prepočítaných okrajov
+#define HITPROB_DIRECT_BYTES (4u << 20) // menšie svety sa zmestia do cache celé, dlaždice netreba
+
+typedef struct HitProbCtx {
+    int H, W, K;
+    double p[4];                    // U, D, L, R
+    int cRow, cCol;
+    double *mask;                   // 1.0 voľná bunka, 0.0 prekážka
+    double *buf[2];                 // dvojitý buffer H*W, P_k je v buf[k & 1] (priamy režim)
+    int T, B, tiles;                // T = 0 -> priame ťahy po pásoch riadkov
+    double *local;                  // 2*(B+2T)*W na vlákno
+} HitProbCtx;
+
+typedef void (*HitProbRowFn)(const double *p, int W, const double *up, const double *cur,
+                             const double *dn, const double *mu, const double *mc,
+                             const double *md, double *out);
+
+#define HITPROB_CELL(j, jl, jr) do {                                                    \
+        double x = cur[j];                                                              \
+        out[j] = mc[j] * (x + pU * mu[j] * (up[j] - x) + pD * md[j] * (dn[j] - x)      \
+                            + pL * mc[jl] * (cur[jl] - x) + pR * mc[jr] * (cur[jr] - x)); \
+    } while (0)
+
+#define HITPROB_ROW_BODY do {                                                           \
+        double pU = p[0], pD = p[1], pL = p[2], pR = p[3];                              \
+        for (int j = 1; j < W - 1; j++) HITPROB_CELL(j, j - 1, j + 1);                  \
+        HITPROB_CELL(0, W - 1, W > 1 ? 1 : 0);                                          \
+        if (W > 1) HITPROB_CELL(W - 1, W - 2, 0);                                       \
+    } while (0)
+
+static void hp_row(const double *p, int W, const double *restrict up, const double *restrict cur,
+                   const double *restrict dn, const double *restrict mu, const double *restrict mc,
+                   const double *restrict md, double *restrict out) {
+    HITPROB_ROW_BODY;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// ten istý kód so 4 double v registri; bez FMA, aby výsledok nezávisel od CPU
+__attribute__((target("avx2")))
+static void hp_row_avx2(const double *p, int W, const double *restrict up, const double *restrict cur,
+                        const double *restrict dn, const double *restrict mu, const double *restrict mc,
+                        const double *restrict md, double *restrict out) {
+    HITPROB_ROW_BODY;
+}
+#endif
+
+static HitProbRowFn hp_row_pick(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return hp_row_avx2;
+#endif
+    return hp_row;
+}
+
+static inline int wrap_row(int r, int H) {
+    r %= H;
+    return r < 0 ? r + H : r;
+}
+
+// jeden riadok g z src (riadky up/cur/dn) do out; stred sa drží na 1
+static inline void hp_step_row(const HitProbCtx *c, HitProbRowFn row, int g, const double *up,
+                               const double *cur, const double *dn, double *out) {
+    int W = c->W;
+    const double *m = c->mask;
+    row(c->p, W, up, cur, dn, m + (size_t)wrap_row(g - 1, c->H) * W, m + (size_t)g * W,
+        m + (size_t)wrap_row(g + 1, c->H) * W, out);
+    if (g == c->cRow) out[c->cCol] = 1.0;
+}
+
+static void hitprob_direct_worker(Pool *p, int tid, void *arg) {
+    HitProbCtx *c = (HitProbCtx*)arg;
+    HitProbRowFn row = hp_row_pick();
+    int H = c->H, W = c->W, n = pool_size(p);
+    int r0 = (int)((long long)H * tid / n), r1 = (int)((long long)H * (tid + 1) / n);
+
+    for (int k = 1; k <= c->K; k++) {
+        const double *src = c->buf[(k - 1) & 1];
+        double *dst = c->buf[k & 1];
+        for (int r = r0; r < r1; r++) {
+            hp_step_row(c, row, r, src + (size_t)wrap_row(r - 1, H) * W, src + (size_t)r * W,
+                        src + (size_t)wrap_row(r + 1, H) * W, dst + (size_t)r * W);
+        }
+        pool_barrier(p);
+    }
+}
+
+// dlaždice sú pridelené staticky (t = tid, tid+n, ...), jedna bariéra na kolo T krokov
+static void hitprob_tiled_worker(Pool *p, int tid, void *arg) {
+    HitProbCtx *c = (HitProbCtx*)arg;
+    HitProbRowFn row = hp_row_pick();
+    int H = c->H, W = c->W, n = pool_size(p);
+    size_t span = (size_t)(c->B + 2 * c->T) * W;
+    double *a0 = c->local + (size_t)tid * 2 * span;
+    double *a1 = a0 + span;
+    int round = 0;
+
+    for (int done = 0; done < c->K; done += c->T, round++) {
+        int T = c->K - done < c->T ? c->K - done : c->T;
+        const double *src = c->buf[round & 1];
+        double *dst = c->buf[(round + 1) & 1];
+
+        for (int t = tid; t < c->tiles; t += n) {
+            int r0 = t * c->B;
+            int b = H - r0 < c->B ? H - r0 : c->B;
+            int L = b + 2 * T;
+            double *a = a0, *z = a1;
+            for (int i = 0; i < L; i++) {
+                memcpy(a + (size_t)i * W, src + (size_t)wrap_row(r0 - T + i, H) * W, (size_t)W * sizeof(double));
+            }
+            // po kroku s sú platné lokálne riadky s..L-1-s
+            for (int s = 1; s <= T; s++) {
+                for (int i = s; i < L - s; i++) {
+                    hp_step_row(c, row, wrap_row(r0 - T + i, H), a + (size_t)(i - 1) * W,
+                                a + (size_t)i * W, a + (size_t)(i + 1) * W, z + (size_t)i * W);
+                }
+                double *tmp = a; a = z; z = tmp;
+            }
+            memcpy(dst + (size_t)r0 * W, a + (size_t)T * W, (size_t)b * W * sizeof(double));
+        }
+        pool_barrier(p);
+    }
+}
+
+bool sim_solve_hit_prob(Sim *s) {
+    if (!s || !s->obstacle) return false;
+    int H = s->WorldHeight, W = s->WorldWidth;
+    size_t n = (size_t)H * (size_t)W;
+
+    HitProbCtx c;
+    memset(&c, 0, sizeof(c));
+    c.H = H;
+    c.W = W;
+    c.K = s->K > 0 ? s->K : 0;
+    memcpy(c.p, s->MoveProbs, sizeof(c.p));
+    c.cRow = H / 2;
+    c.cCol = W / 2;
+
+    // dlaždice len ak sa svet nezmestí do cache; jadro má aspoň 8*T riadkov (okraje <= 25 %)
+    int rowsFit = (int)(HITPROB_TILE_BYTES / (2 * (size_t)W * sizeof(double)));
+    if (n * 3 * sizeof(double) > HITPROB_DIRECT_BYTES && rowsFit >= 20) {
+        c.T = rowsFit / 10 < HITPROB_MAX_STEPS ? rowsFit / 10 : HITPROB_MAX_STEPS;
+        c.B = rowsFit - 2 * c.T;
+        if (c.B + 2 * c.T >= H) c.T = 0;
+    }
+    if (c.T > 0) c.tiles = (H + c.B - 1) / c.B;
+
+    int maxUseful = c.T > 0 ? c.tiles : (int)(n / SOLVE_CELLS_PER_THREAD) + 1;
+    if (maxUseful > H) maxUseful = H;
+    int nthreads = pool_threads(s->Threads, maxUseful);
+
+    if (!s->exact_prob) s->exact_prob = (double*)malloc(n * sizeof(double));
+    c.mask = (double*)malloc(n * sizeof(double));
+    c.buf[0] = s->exact_prob;
+    c.buf[1] = (double*)malloc(n * sizeof(double));
+    if (c.T > 0) c.local = (double*)malloc((size_t)nthreads * 2 * (size_t)(c.B + 2 * c.T) * W * sizeof(double));
+    bool ok = s->exact_prob && c.mask && c.buf[1] && (c.T == 0 || c.local);
+
+    if (ok) {
+        for (int r = 0; r < H; r++) {
+            for (int col = 0; col < W; col++) c.mask[(size_t)r * W + col] = sim_blocked(s, sim_pos(s, r, col)) ? 0.0 : 1.0;
+        }
+        memset(c.buf[0], 0, n * sizeof(double));
+        c.buf[0][(size_t)c.cRow * W + c.cCol] = 1.0;
+        if (c.K > 0 && pool_run(nthreads, c.T > 0 ? hitprob_tiled_worker : hitprob_direct_worker, &c) == 0) ok = false;
+    }
+
+    // výsledok skončil v buf[1], ak bol počet ťahov (krokov alebo kôl) nepárny
+    int swaps = c.T > 0 ? (c.K + c.T - 1) / c.T : c.K;
+    if (ok && (swaps & 1)) memcpy(c.buf[0], c.buf[1], n * sizeof(double));
+
+    free(c.mask);
+    free(c.buf[1]);
+    free(c.local);
+    return ok;
+}
@@ -0,0 +1,393 @@
+// state.c - binárny formát stavu DWALK2 (mmap pri načítaní, kontrolný súčet) a kompaktný DWALKZ
+#include "state.h"
+#include "codec.h"
+#include "hash64.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DWALK2_MAGIC "DWALK2\0\0"
+#define DWALKZ_MAGIC "DWALKZ\0\0"
+#define DWALK2_VERSION 2             // 2: pridané m2 (Welford) a varValid; 1 sa ešte načíta
+#define DWALK2_ALIGN 64             // začiatok každého poľa (aj pre SIMD čítanie priamo z mapy)
+
+// polia sa zapisujú tak, ako sú v pamäti -> formát je definovaný ako little-endian
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#define DWALK2_NATIVE 0
+#else
+#define DWALK2_NATIVE 1
+#endif
+
+enum {
+    DW2_OBSTACLE = 0,               // uint8 0/1
+    DW2_STEPS,                      // uint64
+    DW2_HITS,
+    DW2_SAMPLES,
+    DW2_CENSORED,
+    DW2_M2,                         // double, od verzie 2
+    DW2_SECTIONS
+};
+
+// verzia 1 mala len prvých päť sekcií
+static int section_count(uint32_t version) {
+    return version >= 2 ? DW2_SECTIONS : DW2_M2;
+}
+
+typedef struct Dwalk2Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint64_t checksum;              // cez celý súbor, toto pole sa počíta ako 0
+    int32_t height, width;
+    int32_t worldType, k;
+    double moveProbs[4];
+    int32_t maxReps, actRep;
+    uint64_t seed;
+    int32_t mode, estimator;
+    uint32_t maxSteps, probOnly;
+    uint64_t cells;
+    uint64_t offset[DW2_SECTIONS];  // vo verzii 1 je offset[DW2_M2] ešte z nulovej rezervy
+    uint32_t varValid, pad;
+    uint8_t reserved[80];
+} Dwalk2Header;
+
+_Static_assert(sizeof(Dwalk2Header) == 256, "DWALK2 header must stay 256 bytes");
+
+static size_t align_up(size_t x) {
+    return (x + DWALK2_ALIGN - 1) & ~(size_t)(DWALK2_ALIGN - 1);
+}
+
+static size_t section_bytes(int k, size_t cells) {
+    return k == DW2_OBSTACLE ? cells : cells * sizeof(uint64_t);
+}
+
+static void header_fill(Dwalk2Header *hd, const Sim *s, const char *magic) {
+    memset(hd, 0, sizeof(*hd));
+    memcpy(hd->magic, magic, 8);
+    hd->version = DWALK2_VERSION;
+    hd->headerSize = sizeof(*hd);
+    hd->height = s->WorldHeight;
+    hd->width = s->WorldWidth;
+    hd->worldType = s->WorldType;
+    hd->k = s->K;
+    memcpy(hd->moveProbs, s->MoveProbs, sizeof(hd->moveProbs));
+    hd->maxReps = s->MaxReps;
+    hd->actRep = s->ActRep;
+    hd->seed = s->Seed;
+    hd->mode = s->Mode;
+    hd->estimator = s->Estimator;
+    hd->maxSteps = s->MaxSteps;
+    hd->probOnly = s->ProbOnly;
+    hd->varValid = s->VarValid;
+    hd->cells = (uint64_t)s->WorldHeight * (uint64_t)s->WorldWidth;
+}
+
+// skalárne polia z hlavičky (Sim už musí byť alokovaný na rozmery hlavičky)
+static void header_apply(const Dwalk2Header *hd, Sim *s) {
+    s->K = hd->k;
+    memcpy(s->MoveProbs, hd->moveProbs, sizeof(s->MoveProbs));
+    s->MaxReps = hd->maxReps;
+    s->ActRep = hd->actRep;
+    s->Seed = hd->seed;
+    s->Mode = hd->mode;
+    s->Estimator = hd->estimator;
+    s->MaxSteps = hd->maxSteps;
+    s->ProbOnly = hd->probOnly != 0;
+    // bez m2 je rozptyl známy len kým ešte nie sú vzorky
+    s->VarValid = hd->version >= 2 ? hd->varValid != 0 : hd->actRep == 0;
+}
+
+static bool has_magic(const char *path, const char *magic) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[8];
+    bool ok = fread(buf, 1, sizeof(buf), f) == sizeof(buf) && memcmp(buf, magic, 8) == 0;
+    fclose(f);
+    return ok;
+}
+
+bool state_is_dwalk2(const char *path) {
+    return has_magic(path, DWALK2_MAGIC);
+}
+
+static bool put(FILE *f, Hash64 *h, const void *p, size_t len) {
+    h64_update(h, p, len);
+    return fwrite(p, 1, len, f) == len;
+}
+
+static bool put_zeros(FILE *f, Hash64 *h, size_t len) {
+    static const unsigned char zeros[4096];
+    bool ok = true;
+    while (len > 0 && ok) {
+        size_t part = len < sizeof(zeros) ? len : sizeof(zeros);
+        ok = put(f, h, zeros, part);
+        len -= part;
+    }
+    return ok;
+}
+
+#define STATE_CHUNK 4096            // bunky jedného kúsku pri prevode z/do Sim (násobok 8 kvôli bitom prekážok)
+
+// sekcia k po kúskoch cez sim_fill (Sim má počítadlá len pre voľné bunky, sim.h);
+// bool je 0/1 v jednom bajte, prekážky sa zapíšu priamo
+static bool put_section(FILE *f, Hash64 *h, const Sim *s, int k, size_t n) {
+    uint64_t buf[STATE_CHUNK];
+    bool ok = true;
+    for (size_t lo = 0; lo < n && ok; lo += STATE_CHUNK) {
+        size_t hi = n - lo < STATE_CHUNK ? n : lo + STATE_CHUNK;
+        if (k == DW2_OBSTACLE) {
+            sim_fill_obstacle(s, (bool*)buf, lo, hi);
+            ok = put(f, h, buf, hi - lo);
+        } else {
+            sim_fill(s, SIM_STEPS + k - DW2_STEPS, buf, lo, hi);
+            ok = put(f, h, buf, (hi - lo) * sizeof(uint64_t));
+        }
+    }
+    return ok;
+}
+
+bool state_save_dwalk2(const Sim *s, const char *path) {
+    if (!DWALK2_NATIVE || !s || !path) return false;
+    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+
+    Dwalk2Header hd;
+    header_fill(&hd, s, DWALK2_MAGIC);
+    size_t off = sizeof(hd);
+    for (int k = 0; k < DW2_SECTIONS; k++) {
+        hd.offset[k] = off;
+        off = align_up(off + section_bytes(k, n));
+    }
+    hd.fileSize = off;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    Hash64 h;
+    h64_init(&h);
+    bool ok = put(f, &h, &hd, sizeof(hd));
+    for (int k = 0; k < DW2_SECTIONS && ok; k++) {
+        size_t len = section_bytes(k, n);
+        // nealokované samples, censored a m2 vyplní sim_fill implicitnými hodnotami
+        ok = put_section(f, &h, s, k, n) && put_zeros(f, &h, align_up(len) - len);
+    }
+
+    // kontrolný súčet sa doplní do hlavičky na koniec
+    hd.checksum = h64_final(&h);
+    if (ok) ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&hd, sizeof(hd), 1, f) == 1;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+static bool header_ok(const Dwalk2Header *hd, size_t size) {
+    if (memcmp(hd->magic, DWALK2_MAGIC, 8) != 0) return false;
+    if (hd->version < 1 || hd->version > DWALK2_VERSION || hd->headerSize != sizeof(*hd)) return false;
+    if (hd->fileSize != size || hd->height <= 0 || hd->width <= 0) return false;
+    if (hd->cells != (uint64_t)hd->height * (uint64_t)hd->width) return false;
+    for (int k = 0; k < section_count(hd->version); k++) {
+        uint64_t end = hd->offset[k] + section_bytes(k, (size_t)hd->cells);
+        if (hd->offset[k] % DWALK2_ALIGN || hd->offset[k] < sizeof(*hd) || end > size) return false;
+        if (k > 0 && hd->offset[k] < align_up(hd->offset[k - 1] + section_bytes(k - 1, (size_t)hd->cells))) return false;
+    }
+    return true;
+}
+
+bool state_peek_dwalk2(const char *path, Sim *hdr) {
+    if (!DWALK2_NATIVE || !path || !hdr) return false;
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    Dwalk2Header hd;
+    bool ok = fread(&hd, sizeof(hd), 1, f) == 1 && memcmp(hd.magic, DWALK2_MAGIC, 8) == 0 &&
+              hd.version >= 1 && hd.version <= DWALK2_VERSION;
+    fclose(f);
+    if (!ok) return false;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->WorldHeight = hd.height;
+    hdr->WorldWidth = hd.width;
+    hdr->WorldType = hd.worldType != 0;
+    hdr->K = hd.k;
+    hdr->MaxReps = hd.maxReps;
+    hdr->ActRep = hd.actRep;
+    hdr->Seed = hd.seed;
+    return true;
+}
+
+// prekážky po kúskoch; v súbore je bajt na bunku, nenulový = prekážka
+static void load_obstacles(Sim *s, const uint8_t *obst, size_t n) {
+    bool buf[STATE_CHUNK];
+    for (size_t lo = 0; lo < n; lo += STATE_CHUNK) {
+        size_t hi = n - lo < STATE_CHUNK ? n : lo + STATE_CHUNK;
+        for (size_t i = lo; i < hi; i++) buf[i - lo] = obst[i] != 0;
+        sim_store_obstacle(s, buf, lo, hi);
+    }
+}
+
+bool state_load_dwalk2(Sim *s, const char *path) {
+    if (!DWALK2_NATIVE || !s || !path) return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Dwalk2Header)) { close(fd); return false; }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *map = (const unsigned char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    madvise((void*)map, size, MADV_SEQUENTIAL);
+
+    Dwalk2Header hd;
+    memcpy(&hd, map, sizeof(hd));
+    bool ok = header_ok(&hd, size);
+    if (ok) {
+        Hash64 h;
+        h64_init(&h);
+        uint64_t expect = hd.checksum;
+        hd.checksum = 0;
+        h64_update(&h, &hd, sizeof(hd));
+        h64_update(&h, map + sizeof(hd), size - sizeof(hd));
+        ok = h64_final(&h) == expect;
+    }
+
+    if (ok) {
+        sim_free(s);
+        ok = sim_init_alloc(s, hd.height, hd.width, hd.worldType != 0);
+    }
+    if (ok) {
+        size_t n = (size_t)hd.cells;
+        header_apply(&hd, s);
+
+        load_obstacles(s, map + hd.offset[DW2_OBSTACLE], n);
+        ok = sim_build_transitions(s);
+        // samples, censored a m2 zhodné s implicitnými hodnotami (sim.h) sa nealokujú;
+        // m2 sa načíta len ak sa rozptyl vedie
+        for (int k = DW2_STEPS; k < DW2_SECTIONS && ok; k++) {
+            if (k == DW2_M2 && (hd.version < 2 || !s->VarValid)) continue;
+            ok = sim_store(s, SIM_STEPS + k - DW2_STEPS, (const uint64_t*)(map + hd.offset[k]), 0, n);
+        }
+    }
+
+    munmap((void*)map, size);
+    return ok;
+}
+
+// --- DWALKZ: rovnaká hlavička, za ňou prúd codec (prekážky po bitoch, polia po riadkoch) ---
+
+bool state_is_dwalkz(const char *path) {
+    return has_magic(path, DWALKZ_MAGIC);
+}
+
+// kontrolný súčet hlavičky; prúd za ňou má vlastný
+static uint64_t header_hash(Dwalk2Header hd) {
+    Hash64 h;
+    h64_init(&h);
+    hd.checksum = 0;
+    h64_update(&h, &hd, sizeof(hd));
+    return h64_final(&h);
+}
+
+bool state_put_arrays(CodecWriter *w, const Sim *s, bool withM2) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    size_t n = (size_t)H * (size_t)W;
+    bool *bits = (bool*)malloc(STATE_CHUNK * sizeof(bool));
+    uint64_t *buf = (uint64_t*)malloc(2 * (size_t)W * sizeof(uint64_t));
+    if (!bits || !buf) {
+        free(bits);
+        free(buf);
+        return false;
+    }
+    // kúsky majú násobok 8 buniek, takže bajty bitov sú rovnaké ako pri zápise naraz
+    for (size_t lo = 0; lo < n; lo += STATE_CHUNK) {
+        size_t hi = n - lo < STATE_CHUNK ? n : lo + STATE_CHUNK;
+        sim_fill_obstacle(s, bits, lo, hi);
+        codec_put_bits(w, bits, hi - lo);
+    }
+    for (int arr = SIM_STEPS; arr <= (withM2 ? SIM_M2 : SIM_CENSORED); arr++) {
+        for (int r = 0; r < H; r++) {
+            uint64_t *row = buf + (size_t)(r & 1) * W;
+            sim_fill(s, arr, row, (size_t)r * W, (size_t)(r + 1) * W);
+            codec_put_row(w, row, r > 0 ? buf + (size_t)((r - 1) & 1) * W : NULL, W);
+        }
+    }
+    free(bits);
+    free(buf);
+    return true;
+}
+
+bool state_save_dwalkz(const Sim *s, const char *path) {
+    if (!DWALK2_NATIVE || !s || !path) return false;
+
+    Dwalk2Header hd;
+    header_fill(&hd, s, DWALKZ_MAGIC);
+    hd.checksum = header_hash(hd);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1;
+    CodecWriter w;
+    if (ok && codec_writer_init(&w, codec_file_sink, f)) {
+        // m2 ako bity double (bez straty); nealokované m2 sú nulové riadky
+        ok = state_put_arrays(&w, s, true);
+        ok = codec_writer_finish(&w) && ok;
+    } else {
+        ok = false;
+    }
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// Opak state_put_arrays do Sim alokovaného na rozmery hlavičky: po prekážkach zostaví
+// index voľných buniek, riadky polí idú cez sim_store (implicitné hodnoty sa nealokujú).
+// m2 sa uloží len ak sa rozptyl vedie, inak sa prúd len prečíta.
+static bool get_arrays(CodecReader *r, Sim *s, bool withM2) {
+    int H = s->WorldHeight, W = s->WorldWidth;
+    size_t n = (size_t)H * (size_t)W;
+    bool *bits = (bool*)malloc(STATE_CHUNK * sizeof(bool));
+    uint64_t *buf = (uint64_t*)malloc(2 * (size_t)W * sizeof(uint64_t));
+    bool ok = bits && buf;
+    for (size_t lo = 0; lo < n && ok && r->ok; lo += STATE_CHUNK) {
+        size_t hi = n - lo < STATE_CHUNK ? n : lo + STATE_CHUNK;
+        codec_get_bits(r, bits, hi - lo);
+        sim_store_obstacle(s, bits, lo, hi);
+    }
+    ok = ok && sim_build_transitions(s);
+    for (int arr = SIM_STEPS; arr <= (withM2 ? SIM_M2 : SIM_CENSORED) && ok; arr++) {
+        for (int row = 0; row < H && ok && r->ok; row++) {
+            uint64_t *cur = buf + (size_t)(row & 1) * W;
+            codec_get_row(r, cur, row > 0 ? buf + (size_t)((row - 1) & 1) * W : NULL, W);
+            if (arr < SIM_M2 || s->VarValid) ok = sim_store(s, arr, cur, (size_t)row * W, (size_t)(row + 1) * W);
+        }
+    }
+    free(bits);
+    free(buf);
+    return ok;
+}
+
+bool state_load_dwalkz(Sim *s, const char *path) {
+    if (!DWALK2_NATIVE || !s || !path) return false;
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    Dwalk2Header hd;
+    bool ok = fread(&hd, sizeof(hd), 1, f) == 1 && memcmp(hd.magic, DWALKZ_MAGIC, 8) == 0 &&
+              hd.version >= 1 && hd.version <= DWALK2_VERSION && hd.headerSize == sizeof(hd) && hd.height > 0 && hd.width > 0 &&
+              hd.cells == (uint64_t)hd.height * (uint64_t)hd.width && hd.checksum == header_hash(hd);
+    if (ok) {
+        sim_free(s);
+        ok = sim_init_alloc(s, hd.height, hd.width, hd.worldType != 0);
+    }
+    CodecReader r;
+    if (ok && codec_reader_init(&r, codec_file_source, f)) {
+        header_apply(&hd, s);
+        ok = get_arrays(&r, s, hd.version >= 2);
+        ok = codec_reader_finish(&r) && ok;
+    } else {
+        ok = false;
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <stdbool.h>
+
+#include "codec.h"
+#include "sim.h"
+
+// Binárny stav DWALK2: pevná hlavička a zarovnané little-endian polia, ktoré sa
+// po mmap len skopírujú (bez parsovania). sim_save_state/sim_load_state volajú tieto
+// funkcie podľa StateFormat, resp. podľa magic na začiatku súboru.
+bool state_is_dwalk2(const char *path);
+bool state_save_dwalk2(const Sim *s, const char *path);
+bool state_load_dwalk2(Sim *s, const char *path);
+// len hlavička (rozmery, seed, ActRep...) bez polí a bez kontroly súčtu
+bool state_peek_dwalk2(const char *path, Sim *hdr);
+
+// Kompaktný DWALKZ: hlavička ako DWALK2, polia cez codec (delta po riadkoch + varint
+// + rANS). Rádovo menší súbor na prenos/archiváciu, načítanie je prúdové (bez mmap).
+bool state_is_dwalkz(const char *path);
+bool state_save_dwalkz(const Sim *s, const char *path);
+bool state_load_dwalkz(Sim *s, const char *path);
+// polia DWALKZ (prekážky po bitoch, potom steps, hits, samples, censored a pri withM2 aj
+// bity m2, po riadkoch sveta) do w; aj pre sumáre a export cez socket (server).
+// false = nedostatok pamäte.
+bool state_put_arrays(CodecWriter *w, const Sim *s, bool withM2);
+
+#endif
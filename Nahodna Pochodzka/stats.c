@@ -0,0 +1,159 @@
+// stats.c - počítadlá po vláknach, sčítané pri čítaní
+#include "stats.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct StatsSlot {
+    StatsTotals t;
+    int owned;                      // 1 = patrí živému vláknu (atomicky)
+    struct StatsSlot *next;         // po zaradení sa nemení, sloty sa neuvoľňujú
+} StatsSlot;
+
+static StatsSlot *g_slots;          // zoznam (hlava atomicky)
+static pthread_mutex_t g_slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_key;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static __thread StatsSlot *t_slot;
+
+// jediný zapisovateľ: načítanie + zápis stačí, atomické sú kvôli čitateľom (bez roztrhnutia)
+static inline void bump(uint64_t *p, uint64_t v) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t peek(const uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static void hist_add(StatsHist *h, uint64_t v) {
+    bump(&h->count, 1);
+    bump(&h->sum, v);
+    if (v > peek(&h->max)) __atomic_store_n(&h->max, v, __ATOMIC_RELAXED);
+    bump(&h->bucket[stats_bucket(v)], 1);
+}
+
+// koniec vlákna: slot môže prevziať ďalšie
+static void slot_release(void *arg) {
+    __atomic_store_n(&((StatsSlot*)arg)->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void key_init(void) {
+    pthread_key_create(&g_key, slot_release);
+}
+
+// slot volajúceho vlákna; NULL len ak chýba pamäť (počítadlo sa potom vynechá)
+static StatsSlot *slot(void) {
+    if (t_slot) return t_slot;
+    pthread_once(&g_once, key_init);
+    StatsSlot *s = __atomic_load_n(&g_slots, __ATOMIC_ACQUIRE);
+    for (; s; s = s->next) {
+        int idle = 0;
+        if (__atomic_compare_exchange_n(&s->owned, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if (!s) {
+        s = (StatsSlot*)calloc(1, sizeof(StatsSlot));
+        if (!s) return NULL;
+        s->owned = 1;
+        pthread_mutex_lock(&g_slots_lock);
+        s->next = g_slots;
+        __atomic_store_n(&g_slots, s, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&g_slots_lock);
+    }
+    pthread_setspecific(g_key, s);
+    t_slot = s;
+    return s;
+}
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void stats_command(int cmd, uint64_t ns, uint64_t bytes) {
+    StatsSlot *s = slot();
+    if (!s || cmd < 0 || cmd >= STATS_COMMANDS) return;
+    hist_add(&s->t.command[cmd], ns);
+    bump(&s->t.commandBytes[cmd], bytes);
+}
+
+void stats_lock_wait(uint64_t ns) {
+    StatsSlot *s = slot();
+    if (s) hist_add(&s->t.lockWait, ns);
+}
+
+void stats_lock_hold(uint64_t ns) {
+    StatsSlot *s = slot();
+    if (s) hist_add(&s->t.lockHold, ns);
+}
+
+void stats_walks(StatsHist *lengths) {
+    StatsSlot *s = slot();
+    if (s && lengths->count) {
+        StatsHist *h = &s->t.walkLen;
+        bump(&h->count, lengths->count);
+        bump(&h->sum, lengths->sum);
+        if (lengths->max > peek(&h->max)) __atomic_store_n(&h->max, lengths->max, __ATOMIC_RELAXED);
+        for (int b = 0; b < STATS_BUCKETS; b++) {
+            if (lengths->bucket[b]) bump(&h->bucket[b], lengths->bucket[b]);
+        }
+    }
+    memset(lengths, 0, sizeof(*lengths));
+}
+
+void stats_sent(uint64_t bytes) {
+    StatsSlot *s = slot();
+    if (s) bump(&s->t.sent, bytes);
+}
+
+uint64_t stats_sent_mine(void) {
+    StatsSlot *s = slot();
+    return s ? s->t.sent : 0;
+}
+
+void stats_connection(bool open) {
+    StatsSlot *s = slot();
+    if (s) bump(open ? &s->t.opened : &s->t.closed, 1);
+}
+
+static void hist_merge(StatsHist *dst, const StatsHist *src) {
+    dst->count += peek(&src->count);
+    dst->sum += peek(&src->sum);
+    uint64_t m = peek(&src->max);
+    if (m > dst->max) dst->max = m;
+    for (int b = 0; b < STATS_BUCKETS; b++) dst->bucket[b] += peek(&src->bucket[b]);
+}
+
+void stats_read(StatsTotals *out) {
+    memset(out, 0, sizeof(*out));
+    for (StatsSlot *s = __atomic_load_n(&g_slots, __ATOMIC_ACQUIRE); s; s = s->next) {
+        const StatsTotals *t = &s->t;
+        for (int c = 0; c < STATS_COMMANDS; c++) {
+            hist_merge(&out->command[c], &t->command[c]);
+            out->commandBytes[c] += peek(&t->commandBytes[c]);
+        }
+        hist_merge(&out->lockWait, &t->lockWait);
+        hist_merge(&out->lockHold, &t->lockHold);
+        hist_merge(&out->walkLen, &t->walkLen);
+        out->sent += peek(&t->sent);
+        out->opened += peek(&t->opened);
+        out->closed += peek(&t->closed);
+    }
+}
+
+uint64_t stats_quantile(const StatsHist *h, double q) {
+    if (h->count == 0) return 0;
+    uint64_t want = (uint64_t)(q * (double)h->count + 0.5);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= want) {
+            uint64_t top = b == 0 ? 0 : (1ull << b) - 1;
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
@@ -0,0 +1,64 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Prevádzkové počítadlá servera (príkaz STATS a periodický výpis). Každé vlákno píše do
+// vlastného slotu obyčajnými zápismi bez zámku aj bez lock prefixu (len ono ho mení),
+// čítanie sčíta všetky sloty. Sloty skončených vlákien (pool sim_run, joby) prevezmú
+// nové vlákna a pokračujú v ich súčtoch, takže sa nič nestratí ani nehromadí.
+
+#define STATS_BUCKETS 40            // log2 koše: 0 = hodnota 0, b = [2^(b-1), 2^b)
+#define STATS_COMMANDS 32           // indexy príkazov určuje server
+
+typedef struct StatsHist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t bucket[STATS_BUCKETS];
+} StatsHist;
+
+typedef struct StatsTotals {
+    StatsHist command[STATS_COMMANDS]; // trvanie príkazu v ns (s wait=1 aj beh)
+    uint64_t commandBytes[STATS_COMMANDS]; // odoslané odpoveďami príkazu
+    StatsHist lockWait;             // ns čakania na zámok relácie
+    StatsHist lockHold;             // ns držania zámku relácie
+    StatsHist walkLen;              // kroky prechádzky (count = prechádzky, sum = kroky)
+    uint64_t sent;                  // všetky odoslané bajty
+    uint64_t opened;                // prijaté spojenia
+    uint64_t closed;
+} StatsTotals;
+
+static inline int stats_bucket(uint64_t v) {
+    int b = v ? 64 - __builtin_clzll(v) : 0;
+    return b < STATS_BUCKETS ? b : STATS_BUCKETS - 1;
+}
+
+// súkromný histogram (napr. riadok prechádzok), do slotu ide cez stats_walks
+static inline void stats_hist_add(StatsHist *h, uint64_t v) {
+    h->count++;
+    h->sum += v;
+    if (v > h->max) h->max = v;
+    h->bucket[stats_bucket(v)]++;
+}
+
+uint64_t stats_now_ns(void);
+
+void stats_command(int cmd, uint64_t ns, uint64_t bytes);
+void stats_lock_wait(uint64_t ns);
+void stats_lock_hold(uint64_t ns);
+// pripočíta súkromný histogram dĺžok prechádzok a vynuluje ho
+void stats_walks(StatsHist *lengths);
+void stats_sent(uint64_t bytes);
+// odoslané bajty volajúceho vlákna (rozdiel okolo príkazu = jeho odpoveď)
+uint64_t stats_sent_mine(void);
+void stats_connection(bool open);
+
+// súčet všetkých vlákien
+void stats_read(StatsTotals *out);
+// horná hranica koša, v ktorom leží kvantil q (0..1), najviac max
+uint64_t stats_quantile(const StatsHist *h, double q);
+
+#endif
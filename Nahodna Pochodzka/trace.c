@@ -0,0 +1,125 @@
+// trace.c - schránka prehraných prechádzok a zábery pre pozorovateľov
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// stav schránky; záznam patrí simulácii len v TRACE_BUSY, inak pozorovateľom
+enum {
+    TRACE_IDLE = 0,                 // nikto nežiada
+    TRACE_ARMED,                    // pozorovateľ čaká, simulácia si ho vezme (CAS)
+    TRACE_BUSY,                     // simulácia prehráva prechádzku
+    TRACE_FILLED                    // záznam je hotový
+};
+
+struct Trace {
+    atomic_int state;               // TRACE_*
+    TraceRec rec;
+
+    pthread_mutex_t lock;           // len pozorovatelia
+    int watchers;
+    double due;                     // kedy najskôr môže ísť ďalší záber
+    uint64_t seq;                   // poradie posledného záberu (0 = ešte žiadny)
+    size_t frameLen;
+    char frame[TRACE_FRAME_MAX];
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+Trace *trace_create(void) {
+    Trace *t = (Trace*)calloc(1, sizeof(Trace));
+    if (!t) return NULL;
+    atomic_init(&t->state, TRACE_IDLE);
+    pthread_mutex_init(&t->lock, NULL);
+    return t;
+}
+
+void trace_destroy(Trace *t) {
+    if (!t) return;
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+}
+
+TraceRec *trace_claim(Trace *t) {
+    if (atomic_load_explicit(&t->state, memory_order_relaxed) != TRACE_ARMED) return NULL;
+    int armed = TRACE_ARMED;
+    if (!atomic_compare_exchange_strong_explicit(&t->state, &armed, TRACE_BUSY,
+                                                 memory_order_acquire, memory_order_relaxed)) return NULL;
+    return &t->rec;
+}
+
+void trace_commit(Trace *t) {
+    atomic_store_explicit(&t->state, TRACE_FILLED, memory_order_release);
+}
+
+uint64_t trace_watch(Trace *t) {
+    pthread_mutex_lock(&t->lock);
+    if (t->watchers++ == 0) {
+        // záznam, ktorý ostal z obdobia bez pozorovateľov, je starý
+        int filled = TRACE_FILLED;
+        atomic_compare_exchange_strong(&t->state, &filled, TRACE_IDLE);
+    }
+    uint64_t seq = t->seq;
+    pthread_mutex_unlock(&t->lock);
+    return seq;
+}
+
+void trace_unwatch(Trace *t) {
+    pthread_mutex_lock(&t->lock);
+    if (--t->watchers == 0) {
+        // nik už nežiada; rozbehnutú prehrávku (BUSY) simulácia dokončí, záznam sa zahodí
+        int armed = TRACE_ARMED;
+        atomic_compare_exchange_strong(&t->state, &armed, TRACE_IDLE);
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+// pod zámkom: záznam -> záber
+static void frame_encode(Trace *t) {
+    const TraceRec *r = &t->rec;
+    size_t bytes = ((size_t)r->moves + 3) / 4;
+    int n = snprintf(t->frame, sizeof(t->frame),
+                     "FRAME Seq=%llu Rep=%llu From=%d,%d To=%d,%d Steps=%u Moves=%u Hit=%d Bytes=%zu\n",
+                     (unsigned long long)r->seq, (unsigned long long)r->rep,
+                     (int)(r->start / (uint32_t)r->W), (int)(r->start % (uint32_t)r->W),
+                     (int)(r->end / (uint32_t)r->W), (int)(r->end % (uint32_t)r->W),
+                     r->steps, r->moves, r->hit ? 1 : 0, bytes);
+    memcpy(t->frame + n, r->code, bytes);
+    t->frameLen = (size_t)n + bytes;
+    t->seq = r->seq;
+}
+
+size_t trace_poll(Trace *t, uint64_t *seq, char *buf) {
+    pthread_mutex_lock(&t->lock);
+    double now = now_sec();
+    int st = atomic_load_explicit(&t->state, memory_order_acquire);
+    if (st == TRACE_FILLED && now >= t->due) {
+        frame_encode(t);
+        // termíny idú v pevnom rytme, aby ich oneskorené prebudenie pozorovateľa nestratilo;
+        // po dlhšej prestávke sa nedobiehajú
+        t->due += 1.0 / TRACE_FPS;
+        if (t->due < now - 1.0 / TRACE_FPS) t->due = now;
+        st = TRACE_IDLE;
+        atomic_store_explicit(&t->state, TRACE_IDLE, memory_order_relaxed);
+    }
+    if (st == TRACE_IDLE && t->watchers > 0) {
+        t->rec.seq = t->seq + 1;
+        atomic_store_explicit(&t->state, TRACE_ARMED, memory_order_release);
+    }
+    size_t len = 0;
+    if (t->seq > *seq) {
+        memcpy(buf, t->frame, t->frameLen);
+        len = t->frameLen;
+        *seq = t->seq;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return len;
+}
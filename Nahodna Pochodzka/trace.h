@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Interaktívny mód: pozorovatelia behu dostávajú zábery živej prechádzky. Kým niekto
+// pozoruje, simulácia si z času na čas (keď pozorovateľ požiada o ďalší záber) prehrá
+// jednu z práve odbehnutých prechádzok rovnakým prúdom náhodných čísel a zapíše jej
+// pohyby do schránky. Schránka má jedného zapisovateľa a výmenu cez atomické príznaky,
+// simulácia nikdy nečaká na zámok ani na pozorovateľa; ak o záber nik nežiada, stojí ju
+// to jedno atomické čítanie na riadok sveta. Pozorovatelia záznam zakódujú do záberu
+// najviac TRACE_FPS-krát za sekundu.
+//
+// Záber: textová hlavička a Bytes bajtov pohybov, 4 pohyby na bajt od najnižších bitov,
+// kód 0=U 1=D 2=L 3=R (poradie MoveProbs). Svet je torus, pohyb cez okraj pokračuje na
+// druhej strane; krok do prekážky sa nezapisuje (ostáva na mieste), počíta sa len v Steps.
+//
+//   FRAME Seq=<n> Rep=<r> From=<row>,<col> To=<row>,<col> Steps=<s> Moves=<m> Hit=<0|1> Bytes=<b>\n<b bajtov>
+//
+// Prehrávka sa zastaví po TRACE_MOVES_MAX pohyboch; potom je To poloha v tej chvíli a Hit=0.
+
+#define TRACE_FPS 30
+#define TRACE_MOVES_MAX 8192                        // 2 KB pohybov na záber
+#define TRACE_FRAME_MAX (256 + TRACE_MOVES_MAX / 4) // hlavička + pohyby
+
+typedef struct Trace Trace;
+
+// záznam jednej prehranej prechádzky (vypĺňa simulácia)
+typedef struct TraceRec {
+    uint64_t seq;                   // poradie záberu (nastaví pozorovateľ pred žiadosťou)
+    uint64_t rep;                   // replikácia
+    int H, W;
+    uint32_t start, end;            // bunky r*W+c
+    uint32_t steps;                 // kroky vrátane tých do prekážky
+    uint32_t moves;                 // zapísané pohyby
+    bool hit;                       // došla do stredu
+    uint8_t code[TRACE_MOVES_MAX / 4];
+} TraceRec;
+
+Trace *trace_create(void);
+void trace_destroy(Trace *t);
+
+// --- simulácia (ľubovoľné vlákno sim_run, bez zámku) ---
+
+// záznam na vyplnenie, ak oň pozorovateľ požiadal (inak NULL); dostane ho najviac jedno vlákno
+TraceRec *trace_claim(Trace *t);
+// vyplnený záznam odovzdá pozorovateľom
+void trace_commit(Trace *t);
+
+// --- pozorovatelia ---
+
+// prihlási pozorovateľa; vráti poradie posledného záberu (novší sa mu pošle)
+uint64_t trace_watch(Trace *t);
+void trace_unwatch(Trace *t);
+// Ak je hotový nový záznam a od posledného záberu uplynul interval, zakóduje ho a požiada
+// o ďalší. Ak je posledný záber novší než *seq, skopíruje ho do buf (TRACE_FRAME_MAX),
+// nastaví *seq a vráti jeho dĺžku; inak 0.
+size_t trace_poll(Trace *t, uint64_t *seq, char *buf);
+
+#endif
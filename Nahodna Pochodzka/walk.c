@@ -0,0 +1,392 @@
+#include "walk.h"
+#include "rng.h"
+#include "sim.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WALK_HAVE_AVX2 1
+#endif
+
+// stav jednej rozbehnutej prechádzky
+typedef struct WalkLane {
+    Rng rng;
+    DirBits bits;
+    uint32_t pos;
+    uint32_t steps;
+} WalkLane;
+
+static inline void lane_start(WalkLane *l, const WalkJob *job, const WalkStart *st) {
+    rng_seed_walk(&l->rng, job->seed, job->rep, st->cell);
+    l->bits.word = 0;
+    l->bits.left = 0;
+    l->pos = st->pos;
+    l->steps = 0;
+}
+
+// jeden krok z polohy v smerom d
+static inline uint32_t walk_step(const WalkJob *job, uint32_t v, uint32_t d) {
+    return v + (uint32_t)job->delta[(uint32_t)job->moves[v] * 4 + d];
+}
+
+// dokončí prechádzku (alebo ju utne po cap krokoch); torus aj prekážky sú v druhu
+// kroku bunky, krok sú dve malé načítania
+static inline uint32_t lane_finish(WalkLane *l, const WalkJob *job) {
+    uint32_t v = l->pos, steps = l->steps;
+    while (v != job->center && steps < job->cap) {
+        v = walk_step(job, v, dir_sample(job->ds, &l->bits, &l->rng));
+        steps++;
+    }
+    l->pos = v;
+    l->steps = steps;
+    return steps;
+}
+
+static inline void lane_credit(const WalkJob *job, uint32_t slot, uint32_t pos, uint32_t steps,
+                               uint64_t *steps_sum, uint64_t *hits_sum, uint64_t *censored) {
+    if (pos != job->center) {
+        if (censored) censored[slot]++;
+        return;
+    }
+    steps_sum[slot] += steps;
+    hits_sum[slot] += steps <= job->K;
+}
+
+void walk_batch_scalar(const WalkJob *job, const WalkStart *starts, int count,
+                       uint64_t *steps_sum, uint64_t *hits_sum, uint64_t *censored) {
+    for (int k = 0; k < count; k++) {
+        WalkLane l;
+        lane_start(&l, job, &starts[k]);
+        uint32_t steps = lane_finish(&l, job);
+        lane_credit(job, starts[k].slot, l.pos, steps, steps_sum, hits_sum, censored);
+    }
+}
+
+uint32_t walk_trace(const WalkJob *job, const WalkStart *start, uint8_t *code, uint32_t maxMoves,
+                    uint32_t *moves, uint32_t *end) {
+    WalkLane l;
+    lane_start(&l, job, start);
+    uint32_t v = l.pos, steps = 0, n = 0;
+    memset(code, 0, ((size_t)maxMoves + 3) / 4);
+    while (v != job->center && steps < job->cap && n < maxMoves) {
+        uint32_t d = dir_sample(job->ds, &l.bits, &l.rng);
+        uint32_t nv = walk_step(job, v, d);
+        steps++;
+        if (nv == v) continue;
+        code[n >> 2] |= (uint8_t)(d << ((n & 3) * 2));
+        n++;
+        v = nv;
+    }
+    *moves = n;
+    *end = v;
+    return steps;
+}
+
+bool walk_path_init(WalkPath *path, size_t positions) {
+    path->stamp = (uint32_t*)calloc(positions, sizeof(uint32_t));
+    path->cells = (uint32_t*)malloc(positions * sizeof(uint32_t));
+    path->at = (uint32_t*)malloc(positions * sizeof(uint32_t));
+    path->lengths = (uint32_t*)malloc(positions * sizeof(uint32_t));
+    path->mark = 0;
+    path->size = positions;
+    return path->stamp && path->cells && path->at && path->lengths;
+}
+
+void walk_path_free(WalkPath *path) {
+    free(path->stamp); path->stamp = NULL;
+    free(path->cells); path->cells = NULL;
+    free(path->at);    path->at = NULL;
+    free(path->lengths); path->lengths = NULL;
+}
+
+bool walk_acc_init(WalkAcc *acc, uint64_t *const sums[WALK_SUMS], size_t cells, bool narrow) {
+    memset(acc, 0, sizeof(*acc));
+    acc->size = cells;
+    bool ok = true;
+    for (int a = 0; a < WALK_SUMS; a++) {
+        acc->sums[a] = sums[a];
+        if (!narrow) continue;
+        acc->narrow[a] = (uint32_t*)calloc(cells, sizeof(uint32_t));
+        if (!acc->narrow[a]) ok = false;
+    }
+    return ok;
+}
+
+void walk_acc_free(WalkAcc *acc) {
+    for (int a = 0; a < WALK_SUMS; a++) {
+        free(acc->narrow[a]);
+        acc->narrow[a] = NULL;
+    }
+}
+
+void walk_acc_flush(WalkAcc *acc, bool atomic) {
+    for (int a = 0; a < WALK_SUMS && acc->narrow[0]; a++) {
+        uint32_t *src = acc->narrow[a];
+        uint64_t *dst = acc->sums[a];
+        for (size_t i = 0; i < acc->size; i++) {
+            if (!src[i]) continue;
+            if (atomic) __atomic_fetch_add(&dst[i], src[i], __ATOMIC_RELAXED);
+            else dst[i] += src[i];
+            src[i] = 0;
+        }
+    }
+    acc->load = 0;
+    acc->walks = 0;
+}
+
+void walk_batch_recycle(const WalkJob *job, const WalkStart *starts, int count, WalkPath *path, WalkAcc *acc) {
+    const Sim *s = job->sim;
+    // posledný krok prvej návštevy, od ktorého je ešte vidieť celé okno K krokov
+    uint32_t lastAt = job->cap == UINT32_MAX ? UINT32_MAX : job->cap > job->K ? job->cap - job->K : 0;
+    for (int k = 0; k < count; k++) {
+        // nová značka cesty; po pretečení treba stamp raz vynulovať
+        if (++path->mark == 0) {
+            memset(path->stamp, 0, path->size * sizeof(uint32_t));
+            path->mark = 1;
+        }
+        WalkLane l;
+        lane_start(&l, job, &starts[k]);
+        uint32_t v = l.pos, steps = 0, visited = 0;
+        // rovnaký prúd a rovnaké kroky ako lane_finish, navyše sa zapisujú prvé návštevy
+        while (v != job->center && steps < job->cap) {
+            if (path->stamp[v] != path->mark && (steps <= lastAt || steps == 0)) {
+                path->stamp[v] = path->mark;
+                path->cells[visited] = v;
+                path->at[visited] = steps;
+                visited++;
+            }
+            v = walk_step(job, v, dir_sample(job->ds, &l.bits, &l.rng));
+            steps++;
+        }
+        path->lengths[k] = steps;
+        if (!acc->narrow[0]) {
+            for (uint32_t j = 0; j < visited; j++) {
+                uint32_t cell = sim_slot(s, path->cells[j]);
+                lane_credit(job, cell, v, steps - path->at[j], acc->sums[WALK_STEPS], acc->sums[WALK_HITS],
+                            acc->sums[WALK_CENSORED]);
+                acc->sums[WALK_SAMPLES][cell]++;
+            }
+            continue;
+        }
+        if (acc->load + steps > UINT32_MAX || acc->walks >= UINT32_MAX) walk_acc_flush(acc, true);
+        acc->load += steps;
+        acc->walks++;
+        uint32_t *const *nw = acc->narrow;
+        for (uint32_t j = 0; j < visited; j++) {
+            uint32_t cell = sim_slot(s, path->cells[j]);
+            nw[WALK_SAMPLES][cell]++;
+            if (v != job->center) {
+                nw[WALK_CENSORED][cell]++;
+                continue;
+            }
+            uint32_t left = steps - path->at[j];
+            nw[WALK_STEPS][cell] += left;
+            nw[WALK_HITS][cell] += left <= job->K;
+        }
+    }
+}
+
+#ifdef WALK_HAVE_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+#define LANES 8
+
+#define ROTL64(x, k) _mm256_or_si256(_mm256_slli_epi64((x), (k)), _mm256_srli_epi64((x), 64 - (k)))
+
+// Krok xoshiro256** pre 4 prúdy naraz; nový stav sa zapíše len v pruhoch s maskou m.
+// Násobenia 5 a 9 sú posuny so sčítaním, AVX2 nemá 64-bitové násobenie.
+#define XOSHIRO_MASKED(s0, s1, s2, s3, w, m) do {                                   \
+        __m256i x5_ = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);               \
+        __m256i r7_ = ROTL64(x5_, 7);                                               \
+        __m256i res_ = _mm256_add_epi64(_mm256_slli_epi64(r7_, 3), r7_);            \
+        __m256i t_ = _mm256_slli_epi64(s1, 17);                                     \
+        __m256i n2_ = _mm256_xor_si256(s2, s0);                                     \
+        __m256i n3_ = _mm256_xor_si256(s3, s1);                                     \
+        __m256i n1_ = _mm256_xor_si256(s1, n2_);                                    \
+        __m256i n0_ = _mm256_xor_si256(s0, n3_);                                    \
+        n2_ = _mm256_xor_si256(n2_, t_);                                            \
+        n3_ = ROTL64(n3_, 45);                                                      \
+        s0 = _mm256_blendv_epi8(s0, n0_, m);                                        \
+        s1 = _mm256_blendv_epi8(s1, n1_, m);                                        \
+        s2 = _mm256_blendv_epi8(s2, n2_, m);                                        \
+        s3 = _mm256_blendv_epi8(s3, n3_, m);                                        \
+        w = _mm256_blendv_epi8(w, res_, m);                                         \
+    } while (0)
+
+// stav pruhov v pamäti (SoA) - pri dokončení prechádzky sa vektory uložia sem
+typedef struct LaneBank {
+    uint64_t s[4][LANES];
+    uint64_t word[LANES];
+    uint32_t left[LANES];
+    uint32_t pos[LANES];
+    uint32_t steps[LANES];
+    int start[LANES];               // index štartu prechádzky v pruhu, -1 = voľný
+} LaneBank;
+
+static void bank_start(LaneBank *b, int l, const WalkJob *job, const WalkStart *starts, int k) {
+    WalkLane w;
+    lane_start(&w, job, &starts[k]);
+    for (int i = 0; i < 4; i++) b->s[i][l] = w.rng.s[i];
+    b->word[l] = w.bits.word;
+    b->left[l] = (uint32_t)w.bits.left;
+    b->pos[l] = w.pos;
+    b->steps[l] = w.steps;
+    b->start[l] = k;
+}
+
+static uint32_t bank_finish(const LaneBank *b, int l, const WalkJob *job, WalkLane *w) {
+    for (int i = 0; i < 4; i++) w->rng.s[i] = b->s[i][l];
+    w->bits.word = b->word[l];
+    w->bits.left = (int)b->left[l];
+    w->pos = b->pos[l];
+    w->steps = b->steps[l];
+    return lane_finish(w, job);
+}
+
+// Osem prechádzok naraz, jeden pruh = jedna prechádzka. Skončený pruh sa hneď naplní
+// ďalšou čakajúcou bunkou, takže pruhy bežia aj pri veľmi rozdielnych dĺžkach prechádzok.
+AVX2 static void walk_batch_avx2(const WalkJob *job, const WalkStart *starts, int count,
+                                 uint64_t *steps_sum, uint64_t *hits_sum, uint64_t *censored) {
+    if (count < LANES) {
+        walk_batch_scalar(job, starts, count, steps_sum, hits_sum, censored);
+        return;
+    }
+
+    const DirSampler *ds = job->ds;
+    const bool dyadic = ds->bits <= DIR_SAMPLER_MAX_BITS;
+    int table32[1 << DIR_SAMPLER_MAX_BITS];
+    for (int i = 0; i < (1 << DIR_SAMPLER_MAX_BITS); i++) table32[i] = ds->table[i];
+
+    const __m256i bitsV = _mm256_set1_epi32(ds->bits);
+    const __m128i bitsCnt = _mm_cvtsi32_si128(ds->bits);
+    const __m256i maskV = _mm256_set1_epi32((int)ds->mask);
+    const __m256i full = _mm256_set1_epi32(64);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i centerV = _mm256_set1_epi32((int)job->center);
+    const __m256i capV = _mm256_set1_epi32((int)job->cap);
+    const __m256i low30 = _mm256_set1_epi32(0x3FFFFFFF);
+    const __m256i threshV = _mm256_setr_epi32((int)ds->thresh[0], (int)ds->thresh[1],
+                                              (int)ds->thresh[2], (int)ds->thresh[3], 0, 0, 0, 0);
+    const __m256i aliasV = _mm256_setr_epi32(ds->alias[0], ds->alias[1], ds->alias[2], ds->alias[3], 0, 0, 0, 0);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i evenIdx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    LaneBank b;
+    int pending = 0;
+    for (int l = 0; l < LANES; l++) bank_start(&b, l, job, starts, pending++);
+
+    for (;;) {
+        __m256i s0lo = _mm256_loadu_si256((const __m256i*)&b.s[0][0]), s0hi = _mm256_loadu_si256((const __m256i*)&b.s[0][4]);
+        __m256i s1lo = _mm256_loadu_si256((const __m256i*)&b.s[1][0]), s1hi = _mm256_loadu_si256((const __m256i*)&b.s[1][4]);
+        __m256i s2lo = _mm256_loadu_si256((const __m256i*)&b.s[2][0]), s2hi = _mm256_loadu_si256((const __m256i*)&b.s[2][4]);
+        __m256i s3lo = _mm256_loadu_si256((const __m256i*)&b.s[3][0]), s3hi = _mm256_loadu_si256((const __m256i*)&b.s[3][4]);
+        __m256i wlo = _mm256_loadu_si256((const __m256i*)&b.word[0]), whi = _mm256_loadu_si256((const __m256i*)&b.word[4]);
+        __m256i left = _mm256_loadu_si256((const __m256i*)b.left);
+        __m256i pos = _mm256_loadu_si256((const __m256i*)b.pos);
+        __m256i steps = _mm256_loadu_si256((const __m256i*)b.steps);
+        __m256i done;
+
+        for (;;) {
+            // doplnenie zásobníka bitov v pruhoch, kde už nestačí na krok
+            __m256i need = _mm256_cmpgt_epi32(bitsV, left);
+            if (!_mm256_testz_si256(need, need)) {
+                __m256i mlo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(need));
+                __m256i mhi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(need, 1));
+                XOSHIRO_MASKED(s0lo, s1lo, s2lo, s3lo, wlo, mlo);
+                XOSHIRO_MASKED(s0hi, s1hi, s2hi, s3hi, whi, mhi);
+                left = _mm256_blendv_epi8(left, full, need);
+            }
+
+            // dolných 32 bitov každého slova -> jeden vektor 8x32
+            __m256i u = _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(wlo, evenIdx),
+                                                  _mm256_permutevar8x32_epi32(whi, evenIdx), 0x20);
+            u = _mm256_and_si256(u, maskV);
+            wlo = _mm256_srl_epi64(wlo, bitsCnt);
+            whi = _mm256_srl_epi64(whi, bitsCnt);
+            left = _mm256_sub_epi32(left, bitsV);
+
+            __m256i dir;
+            if (dyadic) {
+                dir = _mm256_i32gather_epi32(table32, u, 4);
+            } else {
+                __m256i col = _mm256_srli_epi32(u, 30);
+                __m256i frac = _mm256_and_si256(u, low30);
+                __m256i thr = _mm256_permutevar8x32_epi32(threshV, col);
+                __m256i ali = _mm256_permutevar8x32_epi32(aliasV, col);
+                dir = _mm256_blendv_epi8(ali, col, _mm256_cmpgt_epi32(thr, frac));
+            }
+
+            // druh kroku je bajt; gather číta 4 bajty, preto má Sim.moves 3 bajty navyše
+            __m256i kind = _mm256_and_si256(_mm256_i32gather_epi32((const int*)job->moves, pos, 1), byteMask);
+            __m256i at = _mm256_add_epi32(_mm256_slli_epi32(kind, 2), dir);
+            pos = _mm256_add_epi32(pos, _mm256_i32gather_epi32(job->delta, at, 4));
+            steps = _mm256_add_epi32(steps, one);
+
+            done = _mm256_or_si256(_mm256_cmpeq_epi32(pos, centerV), _mm256_cmpeq_epi32(steps, capV));
+            if (!_mm256_testz_si256(done, done)) break;
+        }
+
+        _mm256_storeu_si256((__m256i*)&b.s[0][0], s0lo); _mm256_storeu_si256((__m256i*)&b.s[0][4], s0hi);
+        _mm256_storeu_si256((__m256i*)&b.s[1][0], s1lo); _mm256_storeu_si256((__m256i*)&b.s[1][4], s1hi);
+        _mm256_storeu_si256((__m256i*)&b.s[2][0], s2lo); _mm256_storeu_si256((__m256i*)&b.s[2][4], s2hi);
+        _mm256_storeu_si256((__m256i*)&b.s[3][0], s3lo); _mm256_storeu_si256((__m256i*)&b.s[3][4], s3hi);
+        _mm256_storeu_si256((__m256i*)&b.word[0], wlo); _mm256_storeu_si256((__m256i*)&b.word[4], whi);
+        _mm256_storeu_si256((__m256i*)b.left, left);
+        _mm256_storeu_si256((__m256i*)b.pos, pos);
+        _mm256_storeu_si256((__m256i*)b.steps, steps);
+
+        int doneMask = _mm256_movemask_ps(_mm256_castsi256_ps(done));
+        bool drained = false;
+        for (int l = 0; l < LANES; l++) {
+            if (!(doneMask & (1 << l))) continue;
+            lane_credit(job, starts[b.start[l]].slot, b.pos[l], b.steps[l], steps_sum, hits_sum, censored);
+            if (pending < count) {
+                bank_start(&b, l, job, starts, pending++);
+            } else {
+                b.start[l] = -1;
+                drained = true;
+            }
+        }
+        if (!drained) continue;
+
+        // už niet čím plniť pruhy: zvyšné prechádzky dokončí skalárny kód
+        for (int l = 0; l < LANES; l++) {
+            if (b.start[l] < 0) continue;
+            WalkLane w;
+            uint32_t st = bank_finish(&b, l, job, &w);
+            lane_credit(job, starts[b.start[l]].slot, w.pos, st, steps_sum, hits_sum, censored);
+        }
+        return;
+    }
+}
+
+static bool cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+WalkBatchFn walk_kernel_pick(int kernel, size_t positions) {
+#ifdef WALK_HAVE_AVX2
+    // gather používa 32-bitové indexy so znamienkom -> poloha musí byť < 2^31
+    bool avx2Ok = cpu_has_avx2() && positions <= (size_t)INT32_MAX;
+    if (kernel == SIM_KERNEL_AVX2 && avx2Ok) return walk_batch_avx2;
+    if (kernel == SIM_KERNEL_AUTO && avx2Ok) return walk_batch_avx2;
+#else
+    (void)kernel;
+    (void)positions;
+#endif
+    return walk_batch_scalar;
+}
+
+const char *walk_kernel_name(WalkBatchFn fn) {
+#ifdef WALK_HAVE_AVX2
+    if (fn == walk_batch_avx2) return "avx2";
+#endif
+    return fn == walk_batch_scalar ? "scalar" : "?";
+}
@@ -0,0 +1,104 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sampler.h"
+
+struct Sim;
+
+// Jadro prechádzok: dostane zoznam štartov jednej replikácie a pripočíta
+// počet krokov a zásahy do K priamo do súm Sim (štart patrí riadku vlákna, nikto iný ho nemení). Prechádzka, ktorá do cap
+// krokov nedošla do stredu, je cenzurovaná: zvýši sa len censored (NULL = volajúci ju spozná podľa nezmeneného
+// steps_sum), kroky ani zásah nie. Každá prechádzka má vlastný
+// prúd (seed, rep, bunka), preto skalárne aj SIMD jadro dávajú bitovo rovnaký výsledok.
+// Prechádzka ide po polohách (sim_pos): krok je p += delta[moves[p] * 4 + smer], torus aj
+// prekážky sú zapečené v druhu kroku bunky (Sim.moves, bajt na bunku).
+typedef struct WalkJob {
+    const uint8_t *moves;           // Sim.moves
+    const int32_t *delta;           // sim_move_deltas
+    const struct Sim *sim;          // mapa prekážok a index počítadiel (recyklácia)
+    const DirSampler *ds;
+    uint32_t center;                // poloha stredu
+    uint32_t K;
+    uint32_t cap;                   // max krokov jednej prechádzky (UINT32_MAX = bez limitu)
+    uint64_t seed;
+    uint64_t rep;
+} WalkJob;
+
+typedef struct WalkStart {
+    uint32_t pos;                   // poloha (sim_pos)
+    uint32_t cell;                  // index r*W + c, určuje prúd náhodných čísel
+    uint32_t slot;                  // počítadlá bunky (sim_slot)
+} WalkStart;
+
+typedef void (*WalkBatchFn)(const WalkJob *job, const WalkStart *starts, int count,
+                            uint64_t *steps_sum, uint64_t *hits_sum, uint64_t *censored);
+
+void walk_batch_scalar(const WalkJob *job, const WalkStart *starts, int count,
+                       uint64_t *steps_sum, uint64_t *hits_sum, uint64_t *censored);
+
+// Recyklácia trajektórií: zvyšok cesty od prvej návštevy bunky je platná vzorka doby
+// zásahu z tej bunky, takže jedna prechádzka pripočíta vzorku každej navštívenej bunke
+// (aj do samples). Pri limite krokov sa berú len bunky, ktorých okno K krokov je celé
+// pozorované (prvá návšteva v kroku t, t + K <= cap) a štart, aby výber nezávisel od
+// výsledku prechádzky a P(do K) ostala nestranná. Pracovné polia vlákna majú prvok na polohu a nenulujú sa pri každej prechádzke.
+typedef struct WalkPath {
+    uint32_t *stamp;                // stamp[poloha] == mark -> na tejto ceste už navštívená
+    uint32_t mark;
+    size_t size;                    // počet polôh
+    uint32_t *cells;                // polohy prvých návštev v poradí
+    uint32_t *at;                   // krok prvej návštevy
+    uint32_t *lengths;              // kroky k-tej prechádzky poslednej dávky (štatistiky)
+} WalkPath;
+
+// Kam idú vzorky recyklácie (indexy sim_slot, bunky dlaždice ležia pri sebe). Cesta zasiahne bunky všetkých riadkov, preto pri viacerých
+// vláknach má každé súkromné 32-bit akumulátory (polovica pamäte 64-bit kópie) a do 64-bit
+// súm ich vyprázdni samo skôr, než by pretiekli: bunka dostane za prechádzku najviac jej
+// dĺžku krokov a 1 do ostatných, stačí teda strážiť súčet dĺžok a počet prechádzok.
+enum { WALK_STEPS = 0, WALK_HITS, WALK_SAMPLES, WALK_CENSORED, WALK_SUMS };
+
+typedef struct WalkAcc {
+    uint64_t *sums[WALK_SUMS];      // 64-bit sumy (Sim)
+    uint32_t *narrow[WALK_SUMS];    // súkromné; NULL = píše sa rovno do sums (jedno vlákno)
+    uint64_t load;                  // súčet dĺžok prechádzok od vyprázdnenia
+    uint64_t walks;                 // počet prechádzok od vyprázdnenia
+    size_t size;                    // počet voľných buniek
+} WalkAcc;
+
+// narrow = false: len odkaz na sums
+bool walk_acc_init(WalkAcc *acc, uint64_t *const sums[WALK_SUMS], size_t cells, bool narrow);
+void walk_acc_free(WalkAcc *acc);
+// pripočíta súkromné akumulátory do sums a vynuluje ich; atomic, ak súčasne vyprázdňujú aj iné vlákna
+void walk_acc_flush(WalkAcc *acc, bool atomic);
+
+// vzorka štartu v strede (cell = jeho slot): 0 krokov, zásah
+static inline void walk_acc_center(WalkAcc *acc, uint32_t cell) {
+    if (acc->narrow[0]) {
+        if (acc->walks >= UINT32_MAX) walk_acc_flush(acc, true);
+        acc->narrow[WALK_HITS][cell]++;
+        acc->narrow[WALK_SAMPLES][cell]++;
+        acc->walks++;
+        return;
+    }
+    acc->sums[WALK_HITS][cell]++;
+    if (acc->sums[WALK_SAMPLES]) acc->sums[WALK_SAMPLES][cell]++; // NULL = implicitné (sim.h)
+}
+
+bool walk_path_init(WalkPath *path, size_t positions);
+void walk_path_free(WalkPath *path);
+void walk_batch_recycle(const WalkJob *job, const WalkStart *starts, int count, WalkPath *path, WalkAcc *acc);
+
+// Prehrá prechádzku zo start rovnakým prúdom ako jadrá (nič nepripočíta) a zapíše jej
+// pohyby po 2 bitoch do code (kód smeru 0..3, 4 na bajt); krok do prekážky sa nezapíše.
+// Skončí v strede, po cap krokoch alebo po maxMoves pohyboch (*end = poloha). Vráti počet krokov.
+uint32_t walk_trace(const WalkJob *job, const WalkStart *start, uint8_t *code, uint32_t maxMoves,
+                    uint32_t *moves, uint32_t *end);
+
+// kernel: SIM_KERNEL_* zo sim.h; AUTO vyberie podľa CPU a počtu polôh sveta
+WalkBatchFn walk_kernel_pick(int kernel, size_t positions);
+const char *walk_kernel_name(WalkBatchFn fn);
+
+#endif
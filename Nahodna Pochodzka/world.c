@@ -0,0 +1,377 @@
+// world.c - svet zo súboru (mmap, paralelné parsovanie riadkov) a paralelná kontrola súvislosti
+#include "world.h"
+#include "pool.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WORLD_INDEX_CHUNK (1 << 20) // menej bajtov na vlákno sa pri hľadaní riadkov neoplatí
+
+enum { FMT_TEXT = 0, FMT_PGM };
+
+typedef struct WorldCtx {
+    Sim *s;
+    const unsigned char *data;      // namapovaný súbor
+    size_t size;
+    int format;                     // FMT_*
+    // text: začiatky riadkov (rows+1 položiek, posledná = koniec súboru + 1)
+    size_t *rowStart;
+    size_t *counts;                 // počet '\n' v úseku každého vlákna
+    size_t lines;                   // počet '\n' spolu
+    // PGM
+    size_t pixels;                  // offset prvého pixelu
+    unsigned maxval;
+    uint32_t *parent;               // union-find po bunkách
+    bool *rows;                     // dva riadky prekážok na vlákno (parsovanie, susedia zhora)
+    uint32_t centerRoot;
+    bool centerFree;
+    atomic_bool bad;                // zlý znak / dĺžka riadku
+    atomic_size_t unreachable;
+} WorldCtx;
+
+const char *world_error_name(int err) {
+    switch (err) {
+    case WORLD_OK: return "ok";
+    case WORLD_ERR_IO: return "io";
+    case WORLD_ERR_FORMAT: return "format";
+    case WORLD_ERR_MEMORY: return "memory";
+    case WORLD_ERR_CENTER: return "center";
+    case WORLD_ERR_UNREACHABLE: return "unreachable";
+    default: return "unknown";
+    }
+}
+
+// --- union-find: koreň je najmenší index komponentu ---
+
+static inline uint32_t uf_find(uint32_t *p, uint32_t x) {
+    while (p[x] != x) {
+        p[x] = p[p[x]];             // polovičné skracovanie cesty
+        x = p[x];
+    }
+    return x;
+}
+
+// bez zápisu, keď súčasne hľadajú všetky vlákna
+static inline uint32_t uf_root(const uint32_t *p, uint32_t x) {
+    while (p[x] != x) x = p[x];
+    return x;
+}
+
+static inline void uf_union(uint32_t *p, uint32_t a, uint32_t b) {
+    a = uf_find(p, a);
+    b = uf_find(p, b);
+    if (a < b) p[b] = a;
+    else if (b < a) p[a] = b;
+}
+
+// --- text: hranice riadkov ---
+
+// každé vlákno spočíta '\n' vo svojom úseku, potom zapíše začiatky riadkov za nimi
+static void index_worker(Pool *p, int tid, void *arg) {
+    WorldCtx *ctx = (WorldCtx*)arg;
+    int T = pool_size(p);
+    size_t lo = ctx->size * (size_t)tid / (size_t)T, hi = ctx->size * (size_t)(tid + 1) / (size_t)T;
+    const unsigned char *d = ctx->data;
+
+    size_t count = 0;
+    for (const unsigned char *q = d + lo; (q = memchr(q, '\n', (size_t)(d + hi - q))) != NULL; q++) count++;
+    ctx->counts[tid] = count;
+
+    if (pool_barrier(p)) {
+        size_t total = 0;
+        for (int t = 0; t < T; t++) {
+            size_t c = ctx->counts[t];
+            ctx->counts[t] = total;
+            total += c;
+        }
+        ctx->lines = total;
+        ctx->rowStart = (size_t*)malloc((total + 2) * sizeof(size_t));
+        if (ctx->rowStart) {
+            ctx->rowStart[0] = 0;
+            ctx->rowStart[total + 1] = ctx->size + 1;
+        }
+    }
+    pool_barrier(p);
+    if (!ctx->rowStart) return;
+    size_t k = ctx->counts[tid];
+    for (const unsigned char *q = d + lo; (q = memchr(q, '\n', (size_t)(d + hi - q))) != NULL; q++) {
+        ctx->rowStart[++k] = (size_t)(q - d) + 1;
+    }
+}
+
+// dĺžka riadku r bez \n a \r
+static inline size_t text_row_len(const WorldCtx *ctx, size_t r) {
+    size_t a = ctx->rowStart[r], b = ctx->rowStart[r + 1] - 1;
+    if (b > a && ctx->data[b - 1] == '\r') b--;
+    return b - a;
+}
+
+static bool parse_text_row(WorldCtx *ctx, int r, bool *dst) {
+    Sim *s = ctx->s;
+    int W = s->WorldWidth;
+    if (text_row_len(ctx, (size_t)r) != (size_t)W) return false;
+    const unsigned char *src = ctx->data + ctx->rowStart[r];
+    for (int c = 0; c < W; c++) {
+        switch (src[c]) {
+        case '#': case 'X': case '1': case '@': dst[c] = true; break;
+        case '.': case '0': case ' ': dst[c] = false; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+static void parse_pgm_row(WorldCtx *ctx, int r, bool *dst) {
+    Sim *s = ctx->s;
+    int W = s->WorldWidth;
+    unsigned half = (ctx->maxval + 1) / 2;
+    if (ctx->maxval < 256) {
+        const unsigned char *src = ctx->data + ctx->pixels + (size_t)r * (size_t)W;
+        for (int c = 0; c < W; c++) dst[c] = src[c] < half;
+    } else {
+        const unsigned char *src = ctx->data + ctx->pixels + (size_t)r * (size_t)W * 2;
+        for (int c = 0; c < W; c++) dst[c] = ((unsigned)src[2*c] << 8 | src[2*c + 1]) < half; // big-endian
+    }
+}
+
+// --- komponenty po pásoch riadkov ---
+
+// Pás vlákna t z T: celé riadky dlaždíc (SIM_TILE riadkov), aby dve vlákna nezapisovali
+// do toho istého slova mapy prekážok.
+static void band_rows(int H, int t, int T, int *r0, int *r1) {
+    int64_t bands = (H + SIM_TILE - 1) >> SIM_TILE_SHIFT;
+    *r0 = (int)(bands * t / T) << SIM_TILE_SHIFT;
+    *r1 = (int)(bands * (t + 1) / T) << SIM_TILE_SHIFT;
+    if (*r1 > H) *r1 = H;
+}
+
+// riadok r mapy prekážok do dst (W prvkov)
+static const bool *obstacle_row(const Sim *s, int r, bool *dst) {
+    size_t W = (size_t)s->WorldWidth;
+    sim_fill_obstacle(s, dst, (size_t)r * W, (size_t)(r + 1) * W);
+    return dst;
+}
+
+static void world_worker(Pool *p, int tid, void *arg) {
+    WorldCtx *ctx = (WorldCtx*)arg;
+    Sim *s = ctx->s;
+    int H = s->WorldHeight, W = s->WorldWidth, T = pool_size(p);
+    int r0, r1;
+    band_rows(H, tid, T, &r0, &r1);
+    bool *rows = ctx->rows + (size_t)tid * 2 * (size_t)W;
+    uint32_t *par = ctx->parent;
+
+    // Pás: parsovanie a spojenie s ľavým a horným susedom (všetko vo vnútri pásu). Úsek
+    // voľných buniek v riadku ukazuje priamo na svoju prvú bunku; s horným riadkom sa
+    // spája len tam, kde styk začína (inak už je spojený cez ľavého suseda).
+    for (int r = r0; r < r1; r++) {
+        bool *ob = rows + (size_t)(r & 1) * W;
+        const bool *up = rows + (size_t)((r - 1) & 1) * W;
+        if (ctx->format == FMT_TEXT) {
+            if (!parse_text_row(ctx, r, ob)) atomic_store(&ctx->bad, true);
+        } else {
+            parse_pgm_row(ctx, r, ob);
+        }
+        sim_store_obstacle(s, ob, (size_t)r * (size_t)W, (size_t)(r + 1) * (size_t)W);
+        uint32_t row = (uint32_t)r * (uint32_t)W, head = row;
+        bool prevFree = false, prevUp = false;
+        for (int c = 0; c < W; c++) {
+            uint32_t i = row + (uint32_t)c;
+            if (ob[c]) {
+                prevFree = prevUp = false;
+                continue;
+            }
+            if (!prevFree) head = i;
+            par[i] = head;
+            bool upFree = r > r0 && !up[c];
+            if (upFree && !(prevFree && prevUp)) uf_union(par, i, i - (uint32_t)W);
+            prevFree = true;
+            prevUp = upFree;
+        }
+        if (W > 1 && !ob[0] && !ob[W - 1]) uf_union(par, row, row + (uint32_t)W - 1); // torus
+    }
+    // hranice pásov (aj posledný riadok s prvým, torus) spojí jedno vlákno
+    if (pool_barrier(p)) {
+        if (!atomic_load(&ctx->bad)) {
+            for (int t = 0; t < T; t++) {
+                int b0, b1;
+                band_rows(H, t, T, &b0, &b1);
+                int last = b1 - 1;
+                if (last < b0) continue; // prázdny pás
+                uint32_t a = (uint32_t)last * (uint32_t)W, b = (uint32_t)((last + 1) % H) * (uint32_t)W;
+                const bool *oa = obstacle_row(s, last, rows), *obb = obstacle_row(s, (last + 1) % H, rows + W);
+                for (int c = 0; c < W; c++) {
+                    if (!oa[c] && !obb[c]) uf_union(par, a + (uint32_t)c, b + (uint32_t)c);
+                }
+            }
+            uint32_t center = (uint32_t)((H/2) * W + W/2);
+            ctx->centerFree = !sim_blocked(s, sim_pos(s, H/2, W/2));
+            if (ctx->centerFree) ctx->centerRoot = uf_find(par, center);
+        }
+    }
+    pool_barrier(p);
+    if (atomic_load(&ctx->bad)) return;
+
+    // koreň stačí hľadať raz pre každý úsek voľných buniek
+    size_t lost = 0;
+    for (int r = r0; r < r1; r++) {
+        uint32_t row = (uint32_t)r * (uint32_t)W;
+        const bool *ob = obstacle_row(s, r, rows);
+        bool keep = false;
+        for (int c = 0; c < W; c++) {
+            uint32_t i = row + (uint32_t)c;
+            if (ob[c]) continue;
+            if (c == 0 || ob[c - 1]) keep = ctx->centerFree && uf_root(par, i) == ctx->centerRoot;
+            lost += !keep;
+        }
+    }
+    atomic_fetch_add(&ctx->unreachable, lost);
+}
+
+static bool run_components(WorldCtx *ctx, int threads) {
+    const Sim *s = ctx->s;
+    size_t n = (size_t)s->WorldHeight * (size_t)s->WorldWidth;
+    int T = pool_threads(threads, (s->WorldHeight + SIM_TILE - 1) >> SIM_TILE_SHIFT);
+    ctx->parent = (uint32_t*)malloc(n * sizeof(uint32_t));
+    ctx->rows = (bool*)malloc((size_t)T * 2 * (size_t)s->WorldWidth * sizeof(bool));
+    bool ok = ctx->parent && ctx->rows;
+    atomic_init(&ctx->bad, false);
+    atomic_init(&ctx->unreachable, 0);
+    if (ok) ok = pool_run(T, world_worker, ctx) > 0;
+    free(ctx->parent);
+    free(ctx->rows);
+    ctx->parent = NULL;
+    ctx->rows = NULL;
+    return ok;
+}
+
+// --- hlavičky ---
+
+// ďalšie číslo hlavičky PGM (medzery a komentáre # preskočí)
+static bool pgm_number(const unsigned char *d, size_t size, size_t *pos, unsigned long *out) {
+    size_t i = *pos;
+    for (;;) {
+        while (i < size && (d[i] == ' ' || d[i] == '\t' || d[i] == '\r' || d[i] == '\n')) i++;
+        if (i < size && d[i] == '#') {
+            while (i < size && d[i] != '\n') i++;
+            continue;
+        }
+        break;
+    }
+    if (i >= size || d[i] < '0' || d[i] > '9') return false;
+    unsigned long v = 0;
+    while (i < size && d[i] >= '0' && d[i] <= '9') {
+        v = v * 10 + (unsigned long)(d[i] - '0');
+        if (v > UINT32_MAX) return false;
+        i++;
+    }
+    *pos = i;
+    *out = v;
+    return true;
+}
+
+static int pgm_header(WorldCtx *ctx, int *H, int *W) {
+    size_t pos = 2;
+    unsigned long w, h, maxval;
+    if (!pgm_number(ctx->data, ctx->size, &pos, &w) || !pgm_number(ctx->data, ctx->size, &pos, &h) ||
+        !pgm_number(ctx->data, ctx->size, &pos, &maxval)) return WORLD_ERR_FORMAT;
+    if (w == 0 || h == 0 || w > INT32_MAX || h > INT32_MAX || maxval == 0 || maxval > 65535) return WORLD_ERR_FORMAT;
+    pos++;                          // jedna medzera pred dátami
+    size_t bytes = (size_t)w * (size_t)h * (maxval < 256 ? 1 : 2);
+    if (pos > ctx->size || ctx->size - pos < bytes) return WORLD_ERR_FORMAT;
+    ctx->format = FMT_PGM;
+    ctx->pixels = pos;
+    ctx->maxval = (unsigned)maxval;
+    *H = (int)h;
+    *W = (int)w;
+    return WORLD_OK;
+}
+
+static int text_header(WorldCtx *ctx, int threads, int *H, int *W) {
+    ctx->format = FMT_TEXT;
+    int T = pool_threads(threads, (int)(ctx->size / WORLD_INDEX_CHUNK) + 1);
+    ctx->counts = (size_t*)calloc((size_t)T, sizeof(size_t));
+    if (!ctx->counts) return WORLD_ERR_MEMORY;
+    bool ran = pool_run(T, index_worker, ctx) > 0;
+    free(ctx->counts);
+    ctx->counts = NULL;
+    if (!ran || !ctx->rowStart) return WORLD_ERR_MEMORY;
+
+    size_t rows = ctx->lines + 1;   // posledný riadok nemusí mať \n
+    while (rows > 0 && text_row_len(ctx, rows - 1) == 0) rows--;
+    if (rows == 0 || rows > INT32_MAX) return WORLD_ERR_FORMAT;
+    size_t w = text_row_len(ctx, 0);
+    if (w == 0 || w > INT32_MAX) return WORLD_ERR_FORMAT;
+    *H = (int)rows;
+    *W = (int)w;
+    return WORLD_OK;
+}
+
+int world_load(Sim *s, const char *path, int threads, size_t *unreachable) {
+    if (unreachable) *unreachable = 0;
+    if (!s || !path) return WORLD_ERR_IO;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return WORLD_ERR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return WORLD_ERR_IO; }
+    if (st.st_size <= 0) { close(fd); return WORLD_ERR_FORMAT; }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *map = (const unsigned char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return WORLD_ERR_IO;
+
+    WorldCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.data = map;
+    ctx.size = size;
+    int H = 0, W = 0;
+    int err;
+    if (size >= 2 && map[0] == 'P' && map[1] == '5') err = pgm_header(&ctx, &H, &W);
+    else if (size >= 2 && map[0] == 'P' && map[1] >= '1' && map[1] <= '6') err = WORLD_ERR_FORMAT; // iné PNM
+    else err = text_header(&ctx, threads, &H, &W);
+
+    if (err == WORLD_OK) {
+        sim_free(s);
+        if (!sim_init_alloc(s, H, W, true)) err = WORLD_ERR_MEMORY; // prechody až po prekážkach
+    }
+    if (err == WORLD_OK) {
+        ctx.s = s;
+        snprintf(s->WorldFilePath, sizeof(s->WorldFilePath), "%s", path);
+        if (!run_components(&ctx, threads)) err = WORLD_ERR_MEMORY;
+        else if (atomic_load(&ctx.bad)) err = WORLD_ERR_FORMAT;
+        else if (!ctx.centerFree) err = WORLD_ERR_CENTER;
+        else if (atomic_load(&ctx.unreachable) > 0) err = WORLD_ERR_UNREACHABLE;
+        if (unreachable) *unreachable = atomic_load(&ctx.unreachable);
+    }
+    if (err == WORLD_OK && !sim_build_transitions(s)) err = WORLD_ERR_MEMORY;
+
+    free(ctx.rowStart);
+    munmap((void*)map, size);
+    return err;
+}
+
+bool world_save(const Sim *s, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    int W = s->WorldWidth;
+    char *row = (char*)malloc((size_t)W + 1);
+    bool *o = (bool*)malloc((size_t)W * sizeof(bool));
+    bool ok = row && o;
+    for (int r = 0; ok && r < s->WorldHeight; r++) {
+        obstacle_row(s, r, o);
+        for (int c = 0; c < W; c++) row[c] = s->WorldType && o[c] ? '#' : '.';
+        row[W] = '\n';
+        ok = fwrite(row, 1, (size_t)W + 1, f) == (size_t)W + 1;
+    }
+    free(row);
+    free(o);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
@@ -0,0 +1,36 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sim.h"
+
+// Svet zo súboru (NEW_SIM world=<path>). Súbor sa namapuje (mmap) a riadky sa parsujú
+// paralelne do mapy prekážok Sim (po pásoch riadkov dlaždíc); rozmery určuje súbor. Formáty podľa začiatku súboru:
+//
+//   PGM P5   binárny obrázok (maxval < 65536), pixel tmavší než polovica maxval = prekážka
+//   text     riadky rovnakej dĺžky, '#' 'X' '1' '@' = prekážka, '.' '0' ' ' = voľno
+//            (\r\n aj \n, prázdne riadky na konci sa ignorujú)
+//
+// Stred (H/2, W/2) musí byť voľný a každá voľná bunka spojená so stredom; to overí
+// paralelné hľadanie komponentov (union-find po pásoch riadkov, potom spojenie hraníc).
+
+enum {
+    WORLD_OK = 0,
+    WORLD_ERR_IO,                   // súbor sa nedá otvoriť/namapovať
+    WORLD_ERR_FORMAT,               // neznámy formát, nerovnaké riadky, zlý znak
+    WORLD_ERR_MEMORY,
+    WORLD_ERR_CENTER,               // stred je prekážka
+    WORLD_ERR_UNREACHABLE           // niektoré voľné bunky sa do stredu nedostanú
+};
+
+// s sa inicializuje (sim_init_empty s rozmermi súboru, WorldType, WorldFilePath);
+// threads 0 = počet CPU; *unreachable (ak nie je NULL) dostane počet odrezaných buniek
+int world_load(Sim *s, const char *path, int threads, size_t *unreachable);
+const char *world_error_name(int err);
+// zapíše prekážky s ako text ('#' a '.'), ktorý world_load načíta späť (koordinátor
+// tak posiela pracovným serverom svet, ktorý nemá recept, napr. po RESUME_SIM)
+bool world_save(const Sim *s, const char *path);
+
+#endif